@@ -1,4 +1,5 @@
 #include "omsim.h"
+#include "memory.h"
 
 QCircuit test() {
     // test circuit
@@ -34,5 +35,7 @@ int main() {
     cout << "The final state vector: " << endl;
     sv.print();
 
+    memoryStats().print();
+
     return 0;
 }
\ No newline at end of file
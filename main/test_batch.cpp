@@ -0,0 +1,76 @@
+#include "testutil.h"
+#include "batch.h"
+
+int main() {
+    int failed = 0;
+
+    // circuits of different sizes, some with a repeated block, and states of 1 to 3 columns
+    vector<QCircuit> circuits;
+    vector<Matrix<DTYPE>> svs;
+    for (int k = 0; k < 24; ++ k) {
+        int n = 1 + k % 6;
+        QCircuit qc = randomCircuit(n, 3 * n + k, 400 + k);
+        if (k % 3 == 0) {
+            QCircuit body = randomCircuit(n, 2 * n, 430 + k);
+            qc.repeat(body, 1 + k % 4);
+            addRandomGates(qc, n, 460 + k);
+        }
+        circuits.push_back(qc);
+        Matrix<DTYPE> sv(1LL << n, 1 + k % 3);
+        for (ll j = 0; j < sv.col; ++ j) {
+            Matrix<DTYPE> column = randomState(n, k * 3 + j);
+            for (ll i = 0; i < sv.row; ++ i) {
+                sv.data[i][j] = column.data[i][0];
+            }
+        }
+        svs.push_back(sv);
+    }
+    vector<Matrix<DTYPE>> expectedStates, expectedOpmats;
+    for (size_t k = 0; k < circuits.size(); ++ k) {
+        Matrix<DTYPE> sv = svs[k];
+        SVSim(sv, circuits[k]);
+        expectedStates.push_back(sv);
+        expectedOpmats.push_back(referenceMatrix(circuits[k]));
+    }
+
+    for (int numThreads : {1, 3, 0}) {
+        string name = "threads: [" + to_string(numThreads) + "]";
+        vector<Matrix<DTYPE>> states = svs;
+        BatchStats stats;
+        batchSVSim(circuits, states, numThreads, &stats);
+        check(stats.numJobs == (ll)circuits.size(), "batchSVSim jobs " + name, failed);
+        for (size_t k = 0; k < circuits.size(); ++ k) {
+            check(maxDiff(states[k], expectedStates[k]) < 1e-12, "batchSVSim circuit: [" + to_string(k) + "] " + name, failed);
+        }
+
+        states = svs;
+        vector<Matrix<DTYPE>> opmats = batchOMSim(circuits, states, numThreads, &stats);
+        check(opmats.size() == circuits.size() && stats.numJobs == (ll)circuits.size(), "batchOMSim jobs " + name, failed);
+        for (size_t k = 0; k < opmats.size(); ++ k) {
+            string circuit = "circuit: [" + to_string(k) + "] " + name;
+            check(maxDiff(opmats[k], expectedOpmats[k]) < 1e-12, "batchOMSim " + circuit, failed);
+            check(maxDiff(states[k], expectedStates[k]) < 1e-12, "batchOMSim state " + circuit, failed);
+        }
+    }
+
+    // the contiguous kernel on its own
+    for (size_t k = 0; k < circuits.size(); ++ k) {
+        Matrix<DTYPE>& sv = svs[k];
+        vector<DTYPE> buf(sv.row * sv.col);
+        for (ll i = 0; i < sv.row; ++ i) {
+            for (ll j = 0; j < sv.col; ++ j) {
+                buf[i * sv.col + j] = sv.data[i][j];
+            }
+        }
+        applyCircuitContiguous(circuits[k], buf.data(), sv.col);
+        Matrix<DTYPE> out(sv.row, sv.col);
+        for (ll i = 0; i < sv.row; ++ i) {
+            for (ll j = 0; j < sv.col; ++ j) {
+                out.data[i][j] = buf[i * sv.col + j];
+            }
+        }
+        check(maxDiff(out, expectedStates[k]) < 1e-12, "applyCircuitContiguous circuit: [" + to_string(k) + "]", failed);
+    }
+    cout << "[INFO] [test_batch] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
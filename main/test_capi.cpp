@@ -0,0 +1,163 @@
+#include "testutil.h"
+#include "observable.h"
+#include "capi.h"
+
+// Build the same random circuit through the C API and the builder methods
+static qsim_circuit* randomCircuitPair(QCircuit& qc, int numGates, unsigned seed) {
+    qsim_circuit* h = qsim_circuit_new(qc.numQubits);
+    mt19937 rng(seed);
+    int n = qc.numQubits;
+    for (int k = 0; k < numGates; ++ k) {
+        int kind = rng() % 11;
+        int a = rng() % n;
+        int b = (a + 1 + rng() % max(n - 1, 1)) % n;
+        double theta = (rng() % 10000) / 1000.0 - 5.0;
+        if (n == 1 && kind >= 7) {
+            kind = 6;
+        }
+        switch (kind) {
+            case 0: qc.h(a); qsim_h(h, a); break;
+            case 1: qc.x(a); qsim_x(h, a); break;
+            case 2: qc.y(a); qsim_y(h, a); break;
+            case 3: qc.z(a); qsim_z(h, a); break;
+            case 4: qc.rx(theta, a); qsim_rx(h, theta, a); break;
+            case 5: qc.ry(theta, a); qsim_ry(h, theta, a); break;
+            case 6: qc.rz(theta, a); qsim_rz(h, theta, a); break;
+            case 7: qc.cx(a, b); qsim_cx(h, a, b); break;
+            case 8: qc.cy(a, b); qsim_cy(h, a, b); break;
+            case 9: qc.cz(a, b); qsim_cz(h, a, b); break;
+            default: qc.swap(a, b); qsim_swap(h, a, b); break;
+        }
+    }
+    return h;
+}
+
+// Copy a matrix into an interleaved row-major buffer, and back
+static vector<double> toBuffer(const Matrix<DTYPE>& mat) {
+    vector<double> buf(2 * mat.row * mat.col);
+    for (ll i = 0; i < mat.row; ++ i) {
+        for (ll j = 0; j < mat.col; ++ j) {
+            buf[2 * (i * mat.col + j)] = mat.data[i][j].real();
+            buf[2 * (i * mat.col + j) + 1] = mat.data[i][j].imag();
+        }
+    }
+    return buf;
+}
+
+static Matrix<DTYPE> fromBuffer(const vector<double>& buf, ll row, ll col) {
+    Matrix<DTYPE> mat(row, col);
+    for (ll i = 0; i < row; ++ i) {
+        for (ll j = 0; j < col; ++ j) {
+            mat.data[i][j] = DTYPE(buf[2 * (i * col + j)], buf[2 * (i * col + j) + 1]);
+        }
+    }
+    return mat;
+}
+
+int main() {
+    int failed = 0;
+    check(qsim_api_version() == QSIM_API_VERSION, "API version", failed);
+    mt19937 rng(44);
+    for (int n = 1; n <= 6; ++ n) {
+        string name = "n: [" + to_string(n) + "]";
+        QCircuit qc(n, "capi");
+        qsim_circuit* h = randomCircuitPair(qc, 6 * n, 440 + n);
+        QCircuit body(n, "body");
+        qsim_circuit* hbody = randomCircuitPair(body, 2 * n, 450 + n);
+        qc.repeat(body, 3);
+        check(qsim_repeat(h, hbody, 3) == QSIM_OK, "qsim_repeat " + name, failed);
+        qsim_circuit_free(hbody);
+        check(qsim_circuit_num_qubits(h) == n, "qsim_circuit_num_qubits " + name, failed);
+        Matrix<DTYPE> expected = referenceMatrix(qc);
+        ll dim = 1LL << n;
+
+        // states in a caller-owned buffer
+        Matrix<DTYPE> states(dim, 3);
+        for (ll j = 0; j < states.col; ++ j) {
+            Matrix<DTYPE> column = randomState(n, n * 3 + j);
+            for (ll i = 0; i < dim; ++ i) {
+                states.data[i][j] = column.data[i][0];
+            }
+        }
+        vector<double> buf = toBuffer(states);
+        check(qsim_apply(h, buf.data(), dim, states.col) == QSIM_OK, "qsim_apply status " + name, failed);
+        check(maxDiff(fromBuffer(buf, dim, states.col), expected * states) < 1e-12, "qsim_apply " + name, failed);
+
+        vector<double> opmat(2 * dim * dim);
+        check(qsim_operation_matrix(h, opmat.data(), dim) == QSIM_OK, "qsim_operation_matrix status " + name, failed);
+        check(maxDiff(fromBuffer(opmat, dim, dim), expected) < 1e-12, "qsim_operation_matrix " + name, failed);
+
+        // amplitudes <x|U|0>, i.e., column 0 of U
+        vector<int64_t> bitstrings;
+        for (ll x = 0; x < dim; x += 1 + x / 2) {
+            bitstrings.push_back(x);
+        }
+        vector<double> amps(2 * bitstrings.size());
+        check(qsim_amplitudes(h, bitstrings.data(), bitstrings.size(), amps.data(), 1LL << 20, 2) == QSIM_OK, "qsim_amplitudes status " + name, failed);
+        double diff = 0;
+        for (size_t k = 0; k < bitstrings.size(); ++ k) {
+            diff = max(diff, abs(DTYPE(amps[2 * k], amps[2 * k + 1]) - expected.data[bitstrings[k]][0]));
+        }
+        check(diff < 1e-12, "qsim_amplitudes " + name, failed);
+
+        // the expectation of random Pauli strings in the final state
+        Matrix<DTYPE> sv = randomState(n, n);
+        SVSim(sv, qc);
+        vector<double> state = toBuffer(sv);
+        Observable obs(n);
+        vector<string> paulis;
+        vector<double> coeffs;
+        for (int t = 0; t < 2 * n; ++ t) {
+            string p;
+            for (int q = 0; q < n; ++ q) {
+                p += "IXYZ"[rng() % 4];
+            }
+            paulis.push_back(p);
+            coeffs.push_back((rng() % 2000) / 1000.0 - 1.0);
+            obs.add(coeffs.back(), p);
+        }
+        vector<const char*> cpaulis;
+        for (auto& p : paulis) {
+            cpaulis.push_back(p.c_str());
+        }
+        double e = 0;
+        check(qsim_expectation(state.data(), n, cpaulis.data(), coeffs.data(), coeffs.size(), &e, 2) == QSIM_OK, "qsim_expectation status " + name, failed);
+        check(fabs(e - obs.expectation(sv)) < 1e-12, "qsim_expectation " + name, failed);
+
+        // sampled frequencies within 6 sigma of |amplitude|^2
+        ll shots = 100000;
+        vector<int64_t> indices(dim), counts(dim);
+        int64_t numOutcomes = 0;
+        check(qsim_sample(state.data(), n, shots, 7, indices.data(), counts.data(), dim, &numOutcomes, 2) == QSIM_OK, "qsim_sample status " + name, failed);
+        ll total = 0;
+        vector<double> freq(dim, 0);
+        for (ll k = 0; k < numOutcomes; ++ k) {
+            freq[indices[k]] = (double)counts[k] / shots;
+            total += counts[k];
+            check(k == 0 || indices[k] > indices[k - 1], "qsim_sample order " + name, failed);
+        }
+        check(total == shots, "qsim_sample total " + name, failed);
+        for (ll i = 0; i < dim; ++ i) {
+            double p = norm(sv.data[i][0]);
+            check(fabs(freq[i] - p) <= 6 * sqrt(p * (1 - p) / shots) + 1e-12, "qsim_sample frequency " + name, failed);
+        }
+
+        // states without a finite, nonzero norm are rejected instead of exiting
+        vector<double> zero(2 * dim, 0.0);
+        check(qsim_sample(zero.data(), n, shots, 7, indices.data(), counts.data(), dim, &numOutcomes, 2) == QSIM_ERR_ARGUMENT && strlen(qsim_last_error()) > 0, "qsim_sample zero state " + name, failed);
+        state[0] = NAN;
+        check(qsim_sample(state.data(), n, shots, 7, indices.data(), counts.data(), dim, &numOutcomes, 2) == QSIM_ERR_ARGUMENT, "qsim_sample NaN state " + name, failed);
+
+        // arguments out of range and mismatched buffers
+        check(qsim_h(h, n) == QSIM_ERR_ARGUMENT && qsim_cx(h, 0, 0) == QSIM_ERR_ARGUMENT, "qubits out of range " + name, failed);
+        check(qsim_apply(h, buf.data(), dim / 2, 1) == QSIM_ERR_SIZE, "qsim_apply size " + name, failed);
+        check(qsim_operation_matrix(h, opmat.data(), 2 * dim) == QSIM_ERR_SIZE, "qsim_operation_matrix size " + name, failed);
+        check(qsim_expectation(state.data(), n, cpaulis.data(), coeffs.data(), 0, nullptr, 1) == QSIM_ERR_ARGUMENT, "qsim_expectation null output " + name, failed);
+        qsim_circuit_free(h);
+    }
+    check(qsim_circuit_new(0) == nullptr && qsim_circuit_new(-1) == nullptr, "qsim_circuit_new range", failed);
+    check(qsim_circuit_load_qasm("test_capi.missing") == nullptr && strlen(qsim_last_error()) > 0, "qsim_circuit_load_qasm missing file", failed);
+    check(qsim_apply(nullptr, nullptr, 2, 1) == QSIM_ERR_ARGUMENT, "null handle", failed);
+    cout << "[INFO] [test_capi] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
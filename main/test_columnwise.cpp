@@ -0,0 +1,63 @@
+#include "testutil.h"
+
+// The dense 2^n * 2^n matrix of one gate, built entry by entry from gmat
+static Matrix<DTYPE> denseGate(QGate& gate, int n) {
+    ll dim = 1LL << n;
+    Matrix<DTYPE> mat(dim, dim);
+    for (ll c = 0; c < dim; ++ c) {
+        if (gate.isIDE() || gate.isMARK()) {
+            mat.data[c][c] = 1;
+        } else if (gate.gname == "SWAP") {
+            int a = gate.targetQubits[0], b = gate.targetQubits[1];
+            ll r = c & ~(1LL << a) & ~(1LL << b);
+            r |= ((c >> a) & 1LL) << b;
+            r |= ((c >> b) & 1LL) << a;
+            mat.data[r][c] = 1;
+        } else if (! gate.controlQubits.empty() && ((c >> gate.controlQubits[0]) & 1LL) == 0) {
+            mat.data[c][c] = 1;
+        } else {
+            int t = gate.targetQubits[0];
+            ll bit = (c >> t) & 1LL;
+            ll base = c & ~(1LL << t);
+            mat.data[base][c] += gate.gmat->data[0][bit];
+            mat.data[base | (1LL << t)][c] += gate.gmat->data[1][bit];
+        }
+    }
+    return mat;
+}
+
+// The operation matrix as the product of the dense gate matrices
+static Matrix<DTYPE> denseCircuit(QCircuit& qc) {
+    Matrix<DTYPE> opmat;
+    opmat.identity(1LL << qc.numQubits);
+    for (int j = 0; j < qc.numDepths; ++ j) {
+        for (auto& gate : qc.gates[j]) {
+            opmat = denseGate(gate, qc.numQubits) * opmat;
+        }
+    }
+    return opmat;
+}
+
+int main() {
+    int failed = 0;
+    for (int n = 1; n <= 5; ++ n) {
+        for (unsigned seed = 1; seed <= 4; ++ seed) {
+            QCircuit qc = randomCircuit(n, 6 * n, 100 * n + seed);
+            Matrix<DTYPE> expected = denseCircuit(qc);
+            string name = "n: [" + to_string(n) + "] seed: [" + to_string(seed) + "]";
+
+            // SVSim, the reference of the other tests, against the dense product
+            check(maxDiff(referenceMatrix(qc), expected) < 1e-12, "SVSim " + name, failed);
+
+            for (int numThreads : {1, 3, 0}) {
+                Matrix<DTYPE> sv = randomState(n, seed);
+                Matrix<DTYPE> svExpected = expected * sv;
+                Matrix<DTYPE> opmat = OMSimColumnwise(sv, qc, numThreads);
+                check(maxDiff(opmat, expected) < 1e-12, "OMSimColumnwise " + name + " threads: [" + to_string(numThreads) + "]", failed);
+                check(maxDiff(sv, svExpected) < 1e-12, "OMSimColumnwise state " + name, failed);
+            }
+        }
+    }
+    cout << "[INFO] [test_columnwise] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+#include "testutil.h"
+#include "equivalence.h"
+
+// Return U2 = phase * U1 from the SVSim operation matrices, or 0 if there is no such phase
+static DTYPE referencePhase(QCircuit& qc1, QCircuit& qc2) {
+    Matrix<DTYPE> u1 = referenceMatrix(qc1), u2 = referenceMatrix(qc2);
+    ll k = 0;
+    while (abs(u1.data[k][0]) < 1e-6) {
+        ++ k;
+    }
+    DTYPE phase = u2.data[k][0] / u1.data[k][0];
+    for (ll i = 0; i < u1.row; ++ i) {
+        for (ll j = 0; j < u1.col; ++ j) {
+            if (abs(u2.data[i][j] - phase * u1.data[i][j]) > 1e-9) {
+                return 0;
+            }
+        }
+    }
+    return phase;
+}
+
+int main() {
+    int failed = 0;
+    for (int n = 2; n <= 6; ++ n) {
+        unsigned seed = 340 + n;
+        QCircuit base = randomCircuit(n, 10 * n, seed);
+
+        // rewrites that keep the operation matrix: inverse pairs, CX = H CZ H, and RZ(2 pi) = -I
+        QCircuit same = randomCircuit(n, 10 * n, seed);
+        same.h(0);
+        same.h(0);
+        same.cx(1, 0);
+        same.cx(1, 0);
+        QCircuit phased = randomCircuit(n, 10 * n, seed);
+        phased.rz(2 * M_PI, n - 1);
+        QCircuit withCx = randomCircuit(n, 10 * n, seed);
+        withCx.cx(0, n - 1);
+        QCircuit withCz = randomCircuit(n, 10 * n, seed);
+        withCz.h(n - 1);
+        withCz.cz(0, n - 1);
+        withCz.h(n - 1);
+
+        // and ones that change it
+        QCircuit shifted = randomCircuit(n, 10 * n, seed);
+        shifted.rz(1e-3, 0);
+        QCircuit flipped = randomCircuit(n, 10 * n, seed);
+        flipped.x(n - 1);
+
+        vector<pair<QCircuit*, QCircuit*>> pairs = {{&base, &same}, {&base, &phased}, {&withCx, &withCz}, {&base, &shifted}, {&base, &flipped}};
+        for (size_t k = 0; k < pairs.size(); ++ k) {
+            QCircuit& qc1 = *pairs[k].first;
+            QCircuit& qc2 = *pairs[k].second;
+            DTYPE phase = referencePhase(qc1, qc2);
+            bool equivalent = phase != DTYPE(0);
+            string name = "n: [" + to_string(n) + "] pair: [" + to_string(k) + "]";
+
+            EquivalenceResult random = checkEquivalence(qc1, qc2, 8, {0, 1}, 1e-8, 0.99, seed);
+            check(random.equivalent == equivalent, "checkEquivalence " + name, failed);
+            EquivalenceResult exact = checkEquivalenceExact(qc1, qc2);
+            check(exact.equivalent == equivalent, "checkEquivalenceExact " + name, failed);
+            if (equivalent) {
+                check(abs(random.globalPhase - phase) < 1e-9 && abs(exact.globalPhase - phase) < 1e-9, "global phase " + name, failed);
+            }
+        }
+    }
+    cout << "[INFO] [test_equivalence] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+#include "testutil.h"
+#include "fusion.h"
+
+int main() {
+    int failed = 0;
+    for (int n = 1; n <= 8; ++ n) {
+        for (bool monomial : {false, true}) {
+            QCircuit qc = randomCircuit(n, 8 * n, 470 + n, monomial);
+            QCircuit body = randomCircuit(n, 2 * n, 480 + n, monomial);
+            qc.repeat(body, 3);
+            addRandomGates(qc, 4 * n, 490 + n, monomial);
+            Matrix<DTYPE> sv0 = randomState(n, n);
+            Matrix<DTYPE> expected = sv0;
+            SVSim(expected, qc);
+
+            for (int maxQubits = 1; maxQubits <= FUSED_MAX_QUBITS; ++ maxQubits) {
+                string name = "n: [" + to_string(n) + "] monomial: [" + to_string(monomial) + "] maxQubits: [" + to_string(maxQubits) + "]";
+                for (int numThreads : {1, 3}) {
+                    Matrix<DTYPE> sv = sv0;
+                    FusionStats stats;
+                    SVSimFused(sv, qc, maxQubits, numThreads, &stats);
+                    check(maxDiff(sv, expected) < 1e-12, "SVSimFused " + name + " threads: [" + to_string(numThreads) + "]", failed);
+                    ll wider = 0; // a 2-qubit gate forms a block of its own even if maxQubits = 1
+                    for (int k = max(maxQubits, 2) + 1; k <= FUSED_MAX_QUBITS; ++ k) {
+                        wider += stats.opsByQubits[k];
+                    }
+                    check(wider == 0 && stats.numOps <= stats.numGates, "fusion stats " + name, failed);
+                }
+
+                // the fused ops on some columns of an identity give those columns of the operation matrix
+                if (n <= 6) {
+                    vector<FusedOp> ops = fuseCircuit(qc, maxQubits);
+                    Matrix<DTYPE> mat;
+                    mat.identity(1LL << n);
+                    ll cbegin = mat.col / 4, cend = mat.col - cbegin;
+                    applyFused(mat, ops, cbegin, cend, 2);
+                    Matrix<DTYPE> opmat = referenceMatrix(qc);
+                    double diff = 0;
+                    for (ll i = 0; i < mat.row; ++ i) {
+                        for (ll j = 0; j < mat.col; ++ j) {
+                            DTYPE want = (j >= cbegin && j < cend) ? opmat.data[i][j] : DTYPE(i == j ? 1 : 0);
+                            diff = max(diff, abs(mat.data[i][j] - want));
+                        }
+                    }
+                    check(diff < 1e-12, "applyFused columns " + name, failed);
+                }
+            }
+        }
+    }
+    cout << "[INFO] [test_fusion] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
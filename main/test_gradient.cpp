@@ -0,0 +1,66 @@
+#include "testutil.h"
+#include "gradient.h"
+
+// <H> after SVSim of a circuit
+static double simulatedExpectation(QCircuit& qc, Matrix<DTYPE>& sv0, Observable& obs) {
+    Matrix<DTYPE> sv = sv0;
+    SVSim(sv, qc);
+    return obs.expectation(sv);
+}
+
+// <H> with the rotation at (level, qubit) of an unrolled circuit shifted by shift,
+// i.e., followed by a rotation of the same axis, since R(theta) R(shift) = R(theta + shift)
+static double shiftedExpectation(QCircuit& unrolled, ParamGradient& p, double shift, Matrix<DTYPE>& sv0, Observable& obs) {
+    QCircuit shifted = unrolled;
+    vector<QGate> level;
+    for (int q = 0; q < shifted.numQubits; ++ q) {
+        level.push_back(q == p.qubit ? QGate(p.gname, {}, {q}, shift) : QGate("IDE", {}, {q}));
+    }
+    shifted.gates.insert(shifted.gates.begin() + p.level + 1, level);
+    ++ shifted.numDepths;
+    return simulatedExpectation(shifted, sv0, obs);
+}
+
+int main() {
+    int failed = 0;
+    mt19937 rng(38);
+    for (int n = 1; n <= 5; ++ n) {
+        QCircuit body = randomCircuit(n, 2 * n, 380 + n);
+        QCircuit qc = randomCircuit(n, 6 * n, 390 + n);
+        qc.repeat(body, 2);
+        addRandomGates(qc, 4 * n, 400 + n);
+        QCircuit unrolled = qc.unrolled();
+        Matrix<DTYPE> sv0 = randomState(n, n);
+        Observable obs(n);
+        for (int t = 0; t < 2 * n; ++ t) {
+            string p;
+            for (int q = 0; q < n; ++ q) {
+                p += "IXYZ"[rng() % 4];
+            }
+            obs.add((rng() % 2000) / 1000.0 - 1.0, p);
+        }
+        string name = "n: [" + to_string(n) + "]";
+
+        for (int numThreads : {1, 0}) {
+            GradientResult result = adjointGradient(qc, sv0, obs, numThreads);
+            check(fabs(result.expectation - simulatedExpectation(qc, sv0, obs)) < 1e-12, "expectation " + name, failed);
+
+            // one gradient per rotation of the unrolled circuit, checked by the parameter-shift rule
+            ll numRotations = 0;
+            for (auto& level : unrolled.gates) {
+                for (auto& gate : level) {
+                    numRotations += gate.gname == "RX" || gate.gname == "RY" || gate.gname == "RZ";
+                }
+            }
+            check((ll)result.params.size() == numRotations, "number of gradients " + name, failed);
+            for (auto& p : result.params) {
+                double shift = (shiftedExpectation(unrolled, p, M_PI / 2, sv0, obs) - shiftedExpectation(unrolled, p, - M_PI / 2, sv0, obs)) / 2;
+                string where = name + " level: [" + to_string(p.level) + "] qubit: [" + to_string(p.qubit) + "]";
+                check(unrolled.gates[p.level][p.qubit].gname == p.gname, "gate " + where, failed);
+                check(fabs(p.grad - shift) < 1e-10, "parameter shift " + where, failed);
+            }
+        }
+    }
+    cout << "[INFO] [test_gradient] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+#include "testutil.h"
+
+// The operation matrix of one level from SVSim
+static Matrix<DTYPE> levelReference(vector<QGate>& level) {
+    QCircuit single(level.size(), "level");
+    single.gates[0] = level;
+    return referenceMatrix(single);
+}
+
+int main() {
+    int failed = 0;
+    int n = 4;
+    QCircuit qc = randomCircuit(n, 40, 28);
+
+    // cached and uncached level operators against SVSim
+    LevelCache cache;
+    for (int round = 0; round < 2; ++ round) {
+        for (int j = 0; j < qc.numDepths; ++ j) {
+            shared_ptr<Matrix<DTYPE>> levelmat = getLevelMatrix(qc.gates[j], &cache);
+            check(maxDiff(*levelmat, levelReference(qc.gates[j])) < 1e-12, "level: [" + to_string(j) + "] round: [" + to_string(round) + "]", failed);
+        }
+    }
+    check(cache.hits >= qc.numDepths, "the second round is served from the cache", failed);
+    check(cache.size() <= qc.numDepths && cache.misses == cache.size(), "one miss per distinct level", failed);
+
+    // levels that differ only in a rotation angle get different operators
+    QCircuit a(2), b(2);
+    a.rz(0.1000001, 0);
+    b.rz(0.1000002, 0);
+    check(levelSignature(a.gates[0]) != levelSignature(b.gates[0]), "signatures of close angles", failed);
+    shared_ptr<Matrix<DTYPE>> ma = getLevelMatrix(a.gates[0], &cache);
+    shared_ptr<Matrix<DTYPE>> mb = getLevelMatrix(b.gates[0], &cache);
+    check(ma != mb && maxDiff(*mb, levelReference(b.gates[0])) < 1e-15, "operator of the second angle", failed);
+
+    // a cache that holds two operators evicts the least recently used ones
+    ll bytes = matrixBytes(*getLevelMatrix(qc.gates[0]));
+    LevelCache small(2 * bytes);
+    for (int j = 0; j < qc.numDepths; ++ j) {
+        shared_ptr<Matrix<DTYPE>> levelmat = getLevelMatrix(qc.gates[j], &small);
+        check(maxDiff(*levelmat, levelReference(qc.gates[j])) < 1e-12, "capped level: [" + to_string(j) + "]", failed);
+        check(small.bytesHeld <= small.capacity, "capped bytes: [" + to_string(small.bytesHeld) + "]", failed);
+    }
+    check(small.size() <= 2 && small.evictions > 0, "evictions under the cap", failed);
+
+    cout << "[INFO] [test_levelcache] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+#include "testutil.h"
+#include "memory.h"
+
+int main() {
+    int failed = 0;
+    AllocPolicy original = getAllocPolicy();
+
+    // results under the default policy, where these small matrices come from the heap
+    vector<QCircuit> circuits;
+    vector<Matrix<DTYPE>> states, opmats;
+    for (int n = 4; n <= 8; ++ n) {
+        circuits.push_back(randomCircuit(n, 6 * n, 450 + n));
+        Matrix<DTYPE> sv = randomState(n, n);
+        SVSim(sv, circuits.back());
+        states.push_back(sv);
+        opmats.push_back(referenceMatrix(circuits.back()));
+    }
+
+    // every policy, with a threshold low enough that the states and matrices are large blocks
+    for (HugePageMode hugePages : {HUGEPAGES_OFF, HUGEPAGES_TRANSPARENT, HUGEPAGES_EXPLICIT}) {
+        for (bool firstTouch : {false, true}) {
+            for (bool interleave : {false, true}) {
+                AllocPolicy policy;
+                policy.largeBytes = 1024;
+                policy.hugePages = hugePages;
+                policy.firstTouch = firstTouch;
+                policy.interleave = interleave;
+                policy.numThreads = 3;
+                setAllocPolicy(policy);
+                string name = "hugePages: [" + to_string(hugePages) + "] firstTouch: [" + to_string(firstTouch) + "] interleave: [" + to_string(interleave) + "]";
+
+                MemoryStats before = memoryStats(false);
+                for (size_t k = 0; k < circuits.size(); ++ k) {
+                    int n = circuits[k].numQubits;
+                    Matrix<DTYPE> sv = randomState(n, n);
+                    Matrix<DTYPE> copy = sv;
+                    SVSim(copy, circuits[k]);
+                    check(maxDiff(copy, states[k]) < 1e-12, "SVSim n: [" + to_string(n) + "] " + name, failed);
+                    check(maxDiff(referenceMatrix(circuits[k]), opmats[k]) < 1e-12, "operation matrix n: [" + to_string(n) + "] " + name, failed);
+                }
+                MemoryStats after = memoryStats(true);
+                check(after.numLarge > before.numLarge, "large blocks allocated " + name, failed);
+                check(after.liveBlocks == before.liveBlocks && after.liveBytes == before.liveBytes, "large blocks freed " + name, failed);
+            }
+        }
+    }
+    setAllocPolicy(original);
+    cout << "[INFO] [test_memory] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
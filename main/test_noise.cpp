@@ -0,0 +1,60 @@
+#include "testutil.h"
+#include "noise.h"
+
+int main() {
+    int failed = 0;
+
+    // without noise, every trajectory is the SVSim state
+    int n = 5;
+    QCircuit qc = randomCircuit(n, 25, 31);
+    Matrix<DTYPE> sv(1LL << n, 1);
+    sv.data[0][0] = 1;
+    Matrix<DTYPE> final = sv;
+    SVSim(final, qc);
+    Observable obs(n);
+    obs.add(0.7, "ZIZXI");
+    obs.add(-0.3, "IYYIZ");
+    NoiseModel clean;
+    double exact = obs.expectation(final);
+    for (int numThreads : {1, 0}) {
+        double e = trajectoryExpectation(qc, sv, clean, obs, 64, 3, numThreads);
+        check(fabs(e - exact) < 1e-12, "noiseless expectation, threads: [" + to_string(numThreads) + "]", failed);
+    }
+    ll shots = 100000;
+    map<string, ll> counts = trajectorySample(qc, sv, clean, shots, 1, 4);
+    ll total = 0;
+    for (ll i = 0; i < final.row; ++ i) {
+        double p = norm(final.data[i][0]);
+        string key = toBitstring(i, n);
+        double freq = counts.count(key) ? (double)counts[key] / shots : 0;
+        check(fabs(freq - p) <= 6 * sqrt(p * (1 - p) / shots) + 1e-12, "noiseless frequency of " + key, failed);
+        total += counts.count(key) ? counts[key] : 0;
+    }
+    check(total == shots, "noiseless shot total", failed);
+
+    // closed forms on one qubit after X: <Z> = -1 + 4p/3 under depolarizing, -1 + 2 gamma under damping
+    QCircuit flip(1, "flip");
+    flip.x(0);
+    Matrix<DTYPE> zero(2, 1);
+    zero.data[0][0] = 1;
+    Observable z(1);
+    z.add(1.0, "Z");
+    ll trajectories = 40000;
+    double tol = 6 / sqrt((double)trajectories);
+    NoiseModel depolarizing;
+    depolarizing.addDepolarizing(0.3);
+    check(fabs(trajectoryExpectation(flip, zero, depolarizing, z, trajectories, 5) - (-1 + 4 * 0.3 / 3)) < tol, "depolarizing <Z>", failed);
+    NoiseModel damping;
+    damping.addAmplitudeDamping(0.25, "X");
+    check(fabs(trajectoryExpectation(flip, zero, damping, z, trajectories, 6) - (-1 + 2 * 0.25)) < tol, "damping <Z>", failed);
+
+    // readout errors: P(read 0 | 1) = 0.2
+    NoiseModel readout;
+    readout.setReadoutError(0.0, 0.2);
+    map<string, ll> rcounts = trajectorySample(flip, zero, readout, trajectories, 1, 7);
+    double read0 = (double)rcounts["0"] / trajectories;
+    check(fabs(read0 - 0.2) < tol * sqrt(0.2 * 0.8), "readout error", failed);
+
+    cout << "[INFO] [test_noise] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
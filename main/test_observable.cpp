@@ -0,0 +1,66 @@
+#include "testutil.h"
+#include "observable.h"
+
+// H |sv> with every Pauli string applied as X, Y and Z gates by SVSim
+static Matrix<DTYPE> applyByGates(vector<pair<double, string>>& terms, Matrix<DTYPE>& sv, int n) {
+    Matrix<DTYPE> out(sv.row, 1);
+    for (auto& term : terms) {
+        QCircuit qc(n, "pauli");
+        for (int q = 0; q < n; ++ q) {
+            char p = term.second[n - 1 - q]; // the last character acts on q_0
+            if (p == 'X') qc.x(q);
+            if (p == 'Y') qc.y(q);
+            if (p == 'Z') qc.z(q);
+        }
+        Matrix<DTYPE> image = sv;
+        SVSim(image, qc);
+        for (ll i = 0; i < sv.row; ++ i) {
+            out.data[i][0] += term.first * image.data[i][0];
+        }
+    }
+    return out;
+}
+
+int main() {
+    int failed = 0;
+    mt19937 rng(30);
+    for (int n = 1; n <= 6; ++ n) {
+        QCircuit qc = randomCircuit(n, 5 * n, 300 + n);
+        Matrix<DTYPE> sv(1LL << n, 1);
+        sv.data[0][0] = 1;
+        SVSim(sv, qc);
+
+        // random terms, some sharing an X mask
+        Observable obs(n);
+        vector<pair<double, string>> terms;
+        for (int t = 0; t < 3 * n; ++ t) {
+            string p;
+            for (int q = 0; q < n; ++ q) {
+                p += "IXYZ"[rng() % 4];
+            }
+            double coeff = (rng() % 2000) / 1000.0 - 1.0;
+            obs.add(coeff, p);
+            terms.push_back(make_pair(coeff, p));
+        }
+        // a term on explicit qubits: Z on q_0 and X on q_(n-1)
+        if (n > 1) {
+            obs.add(0.25, "ZX", {0, n - 1});
+            string zx(n, 'I');
+            zx[n - 1] = 'Z';
+            zx[0] = 'X';
+            terms.push_back(make_pair(0.25, zx));
+        }
+
+        Matrix<DTYPE> expectedImage = applyByGates(terms, sv, n);
+        DTYPE expected = 0;
+        for (ll i = 0; i < sv.row; ++ i) {
+            expected += conj(sv.data[i][0]) * expectedImage.data[i][0];
+        }
+        string name = "n: [" + to_string(n) + "]";
+        check(fabs(obs.expectation(sv) - expected.real()) < 1e-12, "expectation " + name, failed);
+        check(fabs(obs.expectation(&sv.data[0][0], 1) - expected.real()) < 1e-12, "contiguous expectation " + name, failed);
+        check(maxDiff(obs.apply(sv), expectedImage) < 1e-12, "apply " + name, failed);
+    }
+    cout << "[INFO] [test_observable] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+#include "testutil.h"
+#include "optimize.h"
+
+// Append a random circuit with cancelling pairs, mergeable rotations and h.cz.h patterns planted in it
+static QCircuit plantedCircuit(int n, unsigned seed) {
+    QCircuit qc = randomCircuit(n, 4 * n, seed);
+    mt19937 rng(seed);
+    for (int k = 0; k < 2 * n; ++ k) {
+        int a = rng() % n;
+        int b = (a + 1) % n;
+        double theta = (rng() % 1000) / 100.0;
+        qc.cx(a, b);
+        qc.rz(theta, a); // commutes with the control
+        qc.x(b); // commutes with the target
+        qc.cx(a, b);
+        qc.swap(a, b);
+        qc.swap(b, a);
+        qc.rx(theta, b);
+        qc.rx(- 2 * theta, b);
+        qc.h(b);
+        qc.cz(a, b);
+        qc.h(b);
+        addRandomGates(qc, 2, seed + k);
+    }
+    return qc;
+}
+
+int main() {
+    int failed = 0;
+    for (int n = 2; n <= 5; ++ n) {
+        for (int window : {1, 4, 64}) {
+            QCircuit qc = plantedCircuit(n, 390 + n);
+            QCircuit body = plantedCircuit(n, 400 + n);
+            qc.repeat(body, 3);
+            addRandomGates(qc, 3 * n, 410 + n);
+            Matrix<DTYPE> expected = referenceMatrix(qc);
+            OptimizeStats stats = optimizeCircuit(qc, window);
+            string name = "n: [" + to_string(n) + "] window: [" + to_string(window) + "]";
+            check(maxDiff(referenceMatrix(qc), expected) < 1e-12, "operation matrix " + name, failed);
+            check(stats.gatesAfter < stats.gatesBefore, "fewer gates " + name, failed);
+            check(stats.levelsAfter == qc.numDepths && stats.levelsAfter <= stats.levelsBefore, "levels " + name, failed);
+            check(stats.cancelledPairs > 0 && stats.mergedRotations > 0 && stats.rewrittenPatterns > 0, "rules applied " + name, failed);
+
+            // a second pass keeps the operation matrix
+            optimizeCircuit(qc, window);
+            check(maxDiff(referenceMatrix(qc), expected) < 1e-12, "second pass " + name, failed);
+        }
+
+        // random circuits without planted patterns
+        QCircuit qc = randomCircuit(n, 20 * n, 420 + n);
+        Matrix<DTYPE> expected = referenceMatrix(qc);
+        OptimizeStats stats = optimizeCircuit(qc);
+        check(maxDiff(referenceMatrix(qc), expected) < 1e-12, "random circuit n: [" + to_string(n) + "]", failed);
+        check(stats.gatesAfter <= stats.gatesBefore, "no more gates n: [" + to_string(n) + "]", failed);
+    }
+    cout << "[INFO] [test_optimize] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
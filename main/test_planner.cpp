@@ -0,0 +1,52 @@
+#include "testutil.h"
+#include "planner.h"
+
+int main() {
+    int failed = 0;
+    set<string> methods;
+    for (int n = 1; n <= 9; ++ n) {
+        QCircuit qc = randomCircuit(n, 4 * n, 430 + n);
+        QCircuit body = randomCircuit(n, n, 440 + n);
+        qc.repeat(body, 3);
+        Matrix<DTYPE> sv0 = randomState(n, n);
+        Matrix<DTYPE> expected = sv0;
+        SVSim(expected, qc);
+        Matrix<DTYPE> zero(1LL << n, 1);
+        zero.data[0][0] = 1;
+        SVSim(zero, qc);
+        vector<ll> bitstrings = {0, (1LL << n) - 1, (1LL << n) / 3};
+
+        CircuitProfile profile = profileCircuit(qc);
+        QCircuit unrolled = qc.unrolled();
+        check(profile.numQubits == n && profile.numDepths == unrolled.numDepths, "profile n: [" + to_string(n) + "]", failed);
+
+        // the budget of the default, of a few states and of a few dense matrices
+        ll stateBytes = (1LL << n) * (ll)sizeof(DTYPE);
+        for (ll budget : {0LL, 8 * stateBytes, 8 * stateBytes << n}) {
+            string name = "n: [" + to_string(n) + "] budget: [" + to_string(budget) + "]";
+            Matrix<DTYPE> sv = sv0;
+            SimPlan plan = SVSimAuto(sv, qc, budget);
+            check(plan.chosen >= 0 && plan.estimates[plan.chosen].fits, "SVSimAuto plan " + name, failed);
+            check(maxDiff(sv, expected) < 1e-12, "SVSimAuto " + name, failed);
+            methods.insert(plan.estimates[plan.chosen].method);
+
+            vector<DTYPE> amps = amplitudesAuto(qc, bitstrings, budget, &plan);
+            double diff = 0;
+            for (size_t k = 0; k < bitstrings.size(); ++ k) {
+                diff = max(diff, abs(amps[k] - zero.data[bitstrings[k]][0]));
+            }
+            check(plan.chosen >= 0 && plan.output == OUTPUT_AMPLITUDES, "amplitudesAuto plan " + name, failed);
+            check(diff < 1e-12, "amplitudesAuto " + name, failed);
+            methods.insert(plan.estimates[plan.chosen].method);
+        }
+
+        // nothing fits in a budget below one state vector
+        for (SimOutput output : {OUTPUT_OPMAT, OUTPUT_STATE, OUTPUT_SAMPLES, OUTPUT_EXPECTATION}) {
+            SimPlan plan = planSimulation(qc, output, stateBytes / 2);
+            check(plan.chosen == -1 && ! plan.reason.empty(), "tiny budget n: [" + to_string(n) + "] output: [" + to_string(output) + "]", failed);
+        }
+    }
+    check(methods.size() > 1, "more than one method is chosen", failed);
+    cout << "[INFO] [test_planner] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include "testutil.h"
+#include "qasm.h"
+
+// SVSim of a parsed circuit on a random state
+static Matrix<DTYPE> simulateQASM(const string& src, int n, unsigned seed) {
+    QCircuit qc = parseQASM(src.c_str(), src.size());
+    Matrix<DTYPE> sv = randomState(n, seed);
+    SVSim(sv, qc);
+    return sv;
+}
+
+// SVSim of a hand-built circuit on the same random state
+static Matrix<DTYPE> simulateCircuit(QCircuit& qc, unsigned seed) {
+    Matrix<DTYPE> sv = randomState(qc.numQubits, seed);
+    SVSim(sv, qc);
+    return sv;
+}
+
+int main() {
+    int failed = 0;
+
+    // gate definitions, parameter expressions, broadcasting over two registers
+    string src =
+        "OPENQASM 2.0;\n"
+        "include \"qelib1.inc\";\n"
+        "qreg a[2];\n"
+        "qreg b[2];\n"
+        "creg c[2];\n"
+        "gate ent(t) p, q { h p; cx p, q; rz(t / 2) q; }\n"
+        "h a;\n"
+        "ent(pi / 3) a[0], b[1];\n"
+        "cx a, b;\n"
+        "barrier a, b;\n"
+        "ry(-2 * sin(0.5)) b[0];\n"
+        "rx(sqrt(2) ^ 2) a[1];\n"
+        "swap a[1], b[0];\n"
+        "cy b[1], a[0];\n"
+        "id a[1];\n"
+        "x b; y a[1]; z b[0];\n"
+        "cz a[0], b[0];\n"
+        "measure a -> c;\n";
+    QCircuit qc(4, "expected");
+    qc.h(0);
+    qc.h(1);
+    qc.h(0);
+    qc.cx(0, 3);
+    qc.rz(M_PI / 6, 3);
+    qc.cx(0, 2);
+    qc.cx(1, 3);
+    qc.barrier();
+    qc.ry(-2 * sin(0.5), 2);
+    qc.rx(2.0, 1);
+    qc.swap(1, 2);
+    qc.cy(3, 0);
+    qc.x(2);
+    qc.x(3);
+    qc.y(1);
+    qc.z(2);
+    qc.cz(0, 2);
+    check(maxDiff(simulateQASM(src, 4, 1), simulateCircuit(qc, 1)) < 1e-12, "gate definitions and broadcasting", failed);
+
+    // CH through its action on |1>|0>: H on the target
+    string chSrc = "OPENQASM 2.0;\nqreg q[2];\nx q[0];\nch q[0], q[1];\n";
+    QCircuit ch(2, "ch");
+    ch.x(0);
+    ch.h(1);
+    Matrix<DTYPE> zero(4, 1);
+    zero.data[0][0] = 1;
+    QCircuit chParsed = parseQASM(chSrc.c_str(), chSrc.size());
+    Matrix<DTYPE> chState = zero, chExpected = zero;
+    SVSim(chState, chParsed);
+    SVSim(chExpected, ch);
+    check(maxDiff(chState, chExpected) < 1e-12, "ch", failed);
+
+    // angles that differ after the 6th decimal must not share a cached matrix
+    string a1 = "OPENQASM 2.0;\nqreg q[1];\nh q[0];\nrz(0.1234561) q[0];\n";
+    string a2 = "OPENQASM 2.0;\nqreg q[1];\nh q[0];\nrz(0.1234562) q[0];\n";
+    Matrix<DTYPE> s1 = simulateQASM(a1, 1, 2), s2 = simulateQASM(a2, 1, 2);
+    QCircuit r1(1, "r1"), r2(1, "r2");
+    r1.h(0);
+    r1.rz(0.1234561, 0);
+    r2.h(0);
+    r2.rz(0.1234562, 0);
+    check(maxDiff(s1, simulateCircuit(r1, 2)) < 1e-15 && maxDiff(s2, simulateCircuit(r2, 2)) < 1e-15, "close angles", failed);
+    check(maxDiff(s1, s2) > 1e-9, "close angles differ", failed);
+
+    // malformed input is reported, and the circuit is left unchanged
+    vector<string> malformed = {
+        "OPENQASM 2.0;\nqreg q[2];\nh q[2];\n",
+        "OPENQASM 2.0;\nqreg q[2];\nfoo q[0];\n",
+        "OPENQASM 2.0;\nqreg q[2];\ncx q[0], q[0];\n",
+        "OPENQASM 2.0;\nqreg q[2];\nrx(pi q[0];\n",
+        "OPENQASM 2.0;\nqreg q[2];\nh r[0];\n",
+        "OPENQASM 2.0;\nqreg q[63];\n",
+        "OPENQASM 2.0;\nqreg q[2];\nh q[0]\n",
+    };
+    for (size_t k = 0; k < malformed.size(); ++ k) {
+        QCircuit out(1, "unchanged");
+        string error;
+        bool ok = tryParseQASM(malformed[k].c_str(), malformed[k].size(), out, error);
+        check(! ok && ! error.empty() && out.name == "unchanged", "malformed source: [" + to_string(k) + "]", failed);
+    }
+    string error;
+    QCircuit out(1, "unchanged");
+    check(! tryLoadQASM("test_qasm.missing", out, error) && ! error.empty(), "missing file", failed);
+
+    cout << "[INFO] [test_qasm] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+#include "testutil.h"
+#include "reorder.h"
+
+int main() {
+    int failed = 0;
+
+    // permuteQubits against a gather: amplitude i moves to the index whose bit perm[q] is bit q of i
+    mt19937 rng(33);
+    for (int n : {1, 2, 3, 7, 10}) {
+        for (int round = 0; round < 4; ++ round) {
+            vector<int> perm(n);
+            iota(perm.begin(), perm.end(), 0);
+            shuffle(perm.begin(), perm.end(), rng);
+            Matrix<DTYPE> sv = randomState(n, round);
+            Matrix<DTYPE> expected(sv.row, 1);
+            for (ll i = 0; i < sv.row; ++ i) {
+                ll j = 0;
+                for (int q = 0; q < n; ++ q) {
+                    j |= ((i >> q) & 1LL) << perm[q];
+                }
+                expected.data[j][0] = sv.data[i][0];
+            }
+            permuteQubits(sv, perm, round);
+            check(maxDiff(sv, expected) == 0, "permuteQubits n: [" + to_string(n) + "] round: [" + to_string(round) + "]", failed);
+        }
+    }
+
+    // SVSimReordered against SVSim, with blocks smaller than the state so both gate paths run
+    ll transposes = 0;
+    for (int n : {4, 8, 12}) {
+        QCircuit qc = randomCircuit(n, 12 * n, 330 + n);
+        Matrix<DTYPE> expected = randomState(n, n);
+        Matrix<DTYPE> sv0 = expected;
+        SVSim(expected, qc);
+        for (int blockQubits : {1, n / 2, n}) {
+            for (int window : {1, 8, 64}) {
+                Matrix<DTYPE> sv = sv0;
+                ReorderStats stats = SVSimReordered(sv, qc, blockQubits, window);
+                string name = "n: [" + to_string(n) + "] block: [" + to_string(blockQubits) + "] window: [" + to_string(window) + "]";
+                check(maxDiff(sv, expected) < 1e-12, "SVSimReordered " + name, failed);
+                transposes += stats.numTransposes;
+                check(stats.numBlockedGates + stats.numStridedGates == (ll)qc.flatGates().size(), "gate counts " + name, failed);
+            }
+        }
+    }
+    check(transposes > 0, "some runs transpose the state", failed);
+    cout << "[INFO] [test_reorder] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
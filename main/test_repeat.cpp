@@ -0,0 +1,53 @@
+#include "testutil.h"
+
+// A circuit of a prefix, count copies of body, and a suffix
+static QCircuit withRepeat(int n, QCircuit& body, ll count, unsigned seed) {
+    QCircuit qc = randomCircuit(n, 2 * n, seed);
+    qc.repeat(body, count);
+    addRandomGates(qc, 2 * n, seed + 1);
+    return qc;
+}
+
+int main() {
+    int failed = 0;
+
+    // power by squaring against repeated products
+    QCircuit small = randomCircuit(3, 10, 7);
+    Matrix<DTYPE> u = referenceMatrix(small);
+    Matrix<DTYPE> prod;
+    prod.identity(u.row);
+    for (ll k = 0; k <= 9; ++ k) {
+        check(maxDiff(u.power(k), prod) < 1e-12, "power: [" + to_string(k) + "]", failed);
+        prod = u * prod;
+    }
+
+    for (int n = 1; n <= 4; ++ n) {
+        for (ll count : {0LL, 1LL, 2LL, 5LL, 13LL}) {
+            string name = "n: [" + to_string(n) + "] count: [" + to_string(count) + "]";
+            QCircuit body = randomCircuit(n, 3 * n, 10 * n + count);
+
+            // the simulators see the repeat, the reference the unrolled circuit
+            QCircuit qc = withRepeat(n, body, count, n);
+            QCircuit flat = qc.unrolled();
+            Matrix<DTYPE> expected = referenceMatrix(flat);
+            check(qc.numGates() == (ll)flat.flatGates().size(), "numGates " + name, failed);
+
+            Matrix<DTYPE> sv = randomState(n, count);
+            Matrix<DTYPE> svExpected = expected * sv;
+            SVSim(sv, qc);
+            check(maxDiff(sv, svExpected) < 1e-10, "SVSim " + name, failed);
+
+            QCircuit fresh = withRepeat(n, body, count, n);
+            Matrix<DTYPE> sv2 = randomState(n, count);
+            check(maxDiff(OMSimColumnwise(sv2, fresh), expected) < 1e-10, "OMSimColumnwise " + name, failed);
+
+            // a repeat nested in a repeated body
+            QCircuit outer(n, "outer");
+            outer.repeat(qc, 3);
+            QCircuit outerFlat = outer.unrolled();
+            check(maxDiff(referenceMatrix(outer), referenceMatrix(outerFlat)) < 1e-9, "nested " + name, failed);
+        }
+    }
+    cout << "[INFO] [test_repeat] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
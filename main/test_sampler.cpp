@@ -0,0 +1,85 @@
+#include "testutil.h"
+#include "sampler.h"
+
+// Check the counts against the exact probabilities: the total, and each frequency within 6 sigma
+static bool matches(map<string, ll>& counts, map<string, double>& probs, ll shots) {
+    ll total = 0;
+    for (auto& c : counts) {
+        total += c.second;
+        if (probs.find(c.first) == probs.end() || probs[c.first] == 0) {
+            return false; // an impossible outcome
+        }
+    }
+    for (auto& p : probs) {
+        double freq = counts.count(p.first) ? (double)counts[p.first] / shots : 0;
+        if (fabs(freq - p.second) > 6 * sqrt(p.second * (1 - p.second) / shots) + 1e-12) {
+            return false;
+        }
+    }
+    return total == shots;
+}
+
+// The exact distribution of the measured qubits, qubits[k] is bit k of the outcome
+static map<string, double> marginal(Matrix<DTYPE>& sv, vector<int> qubits) {
+    map<string, double> probs;
+    for (ll i = 0; i < sv.row; ++ i) {
+        ll key = 0;
+        for (size_t k = 0; k < qubits.size(); ++ k) {
+            key |= ((i >> qubits[k]) & 1LL) << k;
+        }
+        probs[toBitstring(key, qubits.size())] += norm(sv.data[i][0]);
+    }
+    return probs;
+}
+
+int main() {
+    int failed = 0;
+    ll shots = 200000;
+
+    // all qubits and small marginals of a random 6-qubit state
+    int n = 6;
+    QCircuit qc = randomCircuit(n, 30, 29);
+    Matrix<DTYPE> sv(1LL << n, 1);
+    sv.data[0][0] = 1;
+    SVSim(sv, qc);
+    vector<int> all;
+    for (int q = 0; q < n; ++ q) {
+        all.push_back(q);
+    }
+    for (int numThreads : {1, 0}) {
+        string threads = " threads: [" + to_string(numThreads) + "]";
+        map<string, ll> counts = sampleCounts(sv, shots, 5, numThreads);
+        map<string, double> probs = marginal(sv, all);
+        check(matches(counts, probs, shots), "all qubits" + threads, failed);
+        check(counts == sampleCounts(sv, shots, 5, numThreads), "same seed, same counts" + threads, failed);
+        for (vector<int> qubits : {vector<int>{0}, vector<int>{4, 1}, vector<int>{5, 0, 3}}) {
+            map<string, ll> mcounts = sampleCounts(sv, shots, qubits, 6, numThreads);
+            map<string, double> mprobs = marginal(sv, qubits);
+            check(matches(mcounts, mprobs, shots), "marginal of " + to_string(qubits.size()) + " qubits" + threads, failed);
+        }
+    }
+
+    // a 17-qubit marginal goes through the shared histogram
+    int big = 18;
+    QCircuit wide(big, "wide");
+    wide.h(0);
+    wide.h(5);
+    wide.cx(5, 9);
+    wide.rx(0.7, 12);
+    wide.h(17);
+    Matrix<DTYPE> wsv(1LL << big, 1);
+    wsv.data[0][0] = 1;
+    SVSim(wsv, wide);
+    vector<int> qubits;
+    for (int q = big - 1; q >= 0; -- q) {
+        if (q != 3) {
+            qubits.push_back(q);
+        }
+    }
+    map<string, ll> wcounts = sampleCounts(wsv, shots, qubits, 7);
+    map<string, double> wprobs = marginal(wsv, qubits);
+    check(matches(wcounts, wprobs, shots), "marginal of 17 qubits", failed);
+
+    cout << "[INFO] [test_sampler] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include "testutil.h"
+#include "serialize.h"
+
+// Round-trip matrices through saveMatrix / loadMatrix and compare them bitwise
+static bool roundTrip(const Matrix<DTYPE>& mat, bool compress, const string& path) {
+    saveMatrix(path, mat, compress);
+    Matrix<DTYPE> loaded = loadMatrix(path);
+    remove(path.c_str());
+    if (loaded.row != mat.row || loaded.col != mat.col) {
+        return false;
+    }
+    for (ll i = 0; i < mat.row; ++ i) {
+        if (memcmp(loaded.data[i], mat.data[i], mat.col * sizeof(DTYPE)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The first numLevels levels of a circuit without repeats
+static QCircuit prefixCircuit(QCircuit& qc, int numLevels) {
+    QCircuit prefix = qc;
+    prefix.gates.resize(numLevels);
+    prefix.numDepths = numLevels;
+    return prefix;
+}
+
+// Write the checkpoint that SVSimCheckpointed or OMSimCheckpointed leaves after numLevels levels
+static void writeCheckpoint(const string& path, QCircuit& qc, const Matrix<DTYPE>& sv, int numLevels, bool operationMatrix) {
+    QCircuit prefix = prefixCircuit(qc, numLevels);
+    Matrix<DTYPE> mat;
+    Checksum64 cs;
+    if (operationMatrix) {
+        uint64_t key[2] = {2, circuitFingerprint(qc)};
+        cs.update(key, sizeof(key));
+        mat = referenceMatrix(prefix);
+    } else {
+        uint64_t key[3] = {1, circuitFingerprint(qc), matrixChecksum(sv)};
+        cs.update(key, sizeof(key));
+        mat = sv;
+        SVSim(mat, prefix);
+    }
+    saveCheckpoint(path, mat, numLevels, cs.value());
+}
+
+int main() {
+    // signed zeros, zero runs and literals
+    Matrix<DTYPE> mat(4, 4);
+    mat.data[0][1] = DTYPE(-0.0, 0.0);
+    mat.data[1][1] = DTYPE(0.5, -0.0);
+    mat.data[2][3] = DTYPE(-0.0, -0.0);
+    mat.data[3][0] = DTYPE(1.0, 2.0);
+
+    // RX(0) has -0.0 imaginary parts
+    Matrix<DTYPE> rx;
+    rx.rotationX(0);
+
+    int failed = 0;
+    for (bool compress : {false, true}) {
+        if (! roundTrip(mat, compress, "test_serialize.bin")) {
+            cout << "[ERROR] signed zeros, compress: [" << compress << "]" << endl;
+            ++ failed;
+        }
+        if (! roundTrip(rx, compress, "test_serialize.bin")) {
+            cout << "[ERROR] RX(0), compress: [" << compress << "]" << endl;
+            ++ failed;
+        }
+    }
+
+    // circuits with a repeated block round-trip to the same simulation
+    for (int n = 1; n <= 5; ++ n) {
+        QCircuit body = randomCircuit(n, 3 * n, 360 + n);
+        QCircuit qc = randomCircuit(n, 4 * n, 370 + n);
+        qc.repeat(body, 3);
+        addRandomGates(qc, 2 * n, 380 + n);
+        saveCircuit("test_serialize.qc", qc);
+        QCircuit loaded = loadCircuit("test_serialize.qc");
+        remove("test_serialize.qc");
+        check(circuitFingerprint(loaded) == circuitFingerprint(qc), "circuit fingerprint n: [" + to_string(n) + "]", failed);
+        check(maxDiff(referenceMatrix(loaded), referenceMatrix(qc)) == 0, "loaded circuit n: [" + to_string(n) + "]", failed);
+    }
+
+    // checkpointed simulation against SVSim, from scratch and resumed from a checkpoint
+    for (int n = 2; n <= 5; ++ n) {
+        QCircuit qc = randomCircuit(n, 10 * n, 390 + n);
+        Matrix<DTYPE> sv0 = randomState(n, n);
+        Matrix<DTYPE> expected = sv0;
+        SVSim(expected, qc);
+        Matrix<DTYPE> opmatExpected = referenceMatrix(qc);
+        for (bool compress : {false, true}) {
+            for (int interval : {1, 3, 100}) {
+                string name = "n: [" + to_string(n) + "] compress: [" + to_string(compress) + "] interval: [" + to_string(interval) + "]";
+                Matrix<DTYPE> sv = sv0;
+                SVSimCheckpointed(sv, qc, "test_serialize.ckpt", interval, compress);
+                check(maxDiff(sv, expected) < 1e-12, "SVSimCheckpointed " + name, failed);
+                sv = sv0;
+                Matrix<DTYPE> opmat = OMSimCheckpointed(sv, qc, "test_serialize.ckpt", interval, compress, 2);
+                check(maxDiff(opmat, opmatExpected) < 1e-12 && maxDiff(sv, expected) < 1e-12, "OMSimCheckpointed " + name, failed);
+            }
+        }
+        int half = qc.numDepths / 2;
+        Matrix<DTYPE> sv = sv0;
+        writeCheckpoint("test_serialize.ckpt", qc, sv0, half, false);
+        SVSimCheckpointed(sv, qc, "test_serialize.ckpt", 2);
+        check(maxDiff(sv, expected) < 1e-12, "SVSimCheckpointed resumed n: [" + to_string(n) + "]", failed);
+        sv = sv0;
+        writeCheckpoint("test_serialize.ckpt", qc, sv0, half, true);
+        Matrix<DTYPE> opmat = OMSimCheckpointed(sv, qc, "test_serialize.ckpt", 2);
+        check(maxDiff(opmat, opmatExpected) < 1e-12 && maxDiff(sv, expected) < 1e-12, "OMSimCheckpointed resumed n: [" + to_string(n) + "]", failed);
+
+        // a checkpoint of another input state is ignored
+        sv = sv0;
+        writeCheckpoint("test_serialize.ckpt", qc, randomState(n, n + 1), half, false);
+        SVSimCheckpointed(sv, qc, "test_serialize.ckpt", 2);
+        check(maxDiff(sv, expected) < 1e-12, "foreign checkpoint n: [" + to_string(n) + "]", failed);
+    }
+    cout << "[INFO] [test_serialize] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#include "testutil.h"
+#include "session.h"
+
+// A copy of the session circuit without the cached repeat matrices, for a from-scratch reference
+static QCircuit freshCopy(QCircuit& qc) {
+    QCircuit copy = qc;
+    for (auto& r : copy.repeats) {
+        r.second.powmat = nullptr;
+    }
+    return copy;
+}
+
+// A level of random single-qubit rotations, one per qubit as in QCircuit::gates
+static vector<QGate> rotationLevel(int n, mt19937& rng) {
+    vector<QGate> level;
+    for (int q = 0; q < n; ++ q) {
+        double theta = (rng() % 10000) / 1000.0 - 5.0;
+        level.push_back(QGate(rng() % 2 ? "RX" : "RY", {}, {q}, theta));
+    }
+    return level;
+}
+
+int main() {
+    int failed = 0;
+    mt19937 rng(37);
+    for (int n = 2; n <= 5; ++ n) {
+        for (bool operationMatrix : {false, true}) {
+            for (ll budget : {0LL, 1LL << 16, 1LL << 30}) {
+                QCircuit body = randomCircuit(n, 2 * n, 370 + n);
+                QCircuit qc = randomCircuit(n, 6 * n, 380 + n);
+                qc.repeat(body, 4);
+                addRandomGates(qc, 6 * n, 390 + n);
+                Matrix<DTYPE> sv0 = randomState(n, n);
+                SimSession session = operationMatrix ? SimSession(qc, budget, 2) : SimSession(qc, sv0, budget, 2);
+                string name = "n: [" + to_string(n) + "] operationMatrix: [" + to_string(operationMatrix) + "] budget: [" + to_string(budget) + "]";
+
+                // compare the session result with SVSim of the edited circuit, after every edit
+                auto verify = [&](const string& what) {
+                    QCircuit ref = freshCopy(session.qc);
+                    Matrix<DTYPE> expected;
+                    if (operationMatrix) {
+                        expected = referenceMatrix(ref);
+                    } else {
+                        expected = sv0;
+                        SVSim(expected, ref);
+                    }
+                    check(maxDiff(session.result(), expected) < 1e-10, what + " " + name, failed);
+                };
+                verify("initial");
+
+                // replace single-qubit gates at several depths, the last level first
+                for (int k = 0; k < 4; ++ k) {
+                    int level = session.qc.numDepths - 1 - (int)(rng() % session.qc.numDepths);
+                    int qid = rng() % n;
+                    QGate& old = session.qc.gates[level][qid];
+                    if (session.qc.isRepeat(level) || ! (old.isSingle() || old.isIDE())) {
+                        continue;
+                    }
+                    QGate gate("RZ", {}, {qid}, (rng() % 1000) / 100.0);
+                    session.replaceGate(level, gate);
+                    verify("replaceGate level: [" + to_string(level) + "]");
+                }
+
+                vector<QGate> level = rotationLevel(n, rng);
+                session.replaceLevel(session.qc.numDepths / 2, level);
+                verify("replaceLevel");
+
+                level = rotationLevel(n, rng);
+                session.insertLevel(1, level);
+                verify("insertLevel");
+                level = rotationLevel(n, rng);
+                session.insertLevel(session.qc.numDepths, level);
+                verify("insertLevel at the end");
+
+                session.removeLevel(0);
+                verify("removeLevel");
+
+                // edit the repeated block in place
+                for (auto& r : session.qc.repeats) {
+                    r.second.body->x(0);
+                    r.second.count = 3;
+                    session.touch(r.first);
+                    break;
+                }
+                verify("touch");
+            }
+        }
+    }
+    cout << "[INFO] [test_session] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+#include "testutil.h"
+#include "soa.h"
+
+int main() {
+    int failed = 0;
+    string detected = soaKernelName();
+    int numKernels = 0;
+    for (string kernels : {"scalar", "avx2", "avx512"}) {
+        if (! soaUseKernels(kernels)) {
+            cout << "[INFO] [test_soa] skipped kernels: [" << kernels << "]" << endl;
+            continue;
+        }
+        ++ numKernels;
+        check(soaKernelName() == kernels, "kernel name " + kernels, failed);
+
+        // every qubit count up to past the vector width, with 1, 2 and 5 columns
+        for (int n = 1; n <= 7; ++ n) {
+            QCircuit qc = randomCircuit(n, 6 * n, 410 + n);
+            QCircuit body = randomCircuit(n, 2 * n, 420 + n);
+            qc.repeat(body, 3);
+            addRandomGates(qc, 2 * n, 430 + n);
+            Matrix<DTYPE> expected = referenceMatrix(qc);
+            string name = kernels + " n: [" + to_string(n) + "]";
+            for (ll width : {1, 2, 5}) {
+                Matrix<DTYPE> sv(1LL << n, width);
+                for (ll j = 0; j < width; ++ j) {
+                    Matrix<DTYPE> column = randomState(n, n * 7 + j);
+                    for (ll i = 0; i < sv.row; ++ i) {
+                        sv.data[i][j] = column.data[i][0];
+                    }
+                }
+                Matrix<DTYPE> svExpected = expected * sv;
+                SVSimSoA(sv, qc);
+                check(maxDiff(sv, svExpected) < 1e-12, "SVSimSoA " + name + " width: [" + to_string(width) + "]", failed);
+            }
+            Matrix<DTYPE> sv = randomState(n, n);
+            Matrix<DTYPE> svExpected = expected * sv;
+            Matrix<DTYPE> opmat = OMSimSoA(sv, qc);
+            check(maxDiff(opmat, expected) < 1e-12, "OMSimSoA " + name, failed);
+            check(maxDiff(sv, svExpected) < 1e-12, "OMSimSoA state " + name, failed);
+
+            // products in the split layout
+            Matrix<DTYPE> other = referenceMatrix(body);
+            SoAMatrix a(expected), b(other);
+            check(maxDiff((a * b).toMatrix(), expected * other) < 1e-12, "SoA product " + name, failed);
+            if (n <= 3) {
+                check(maxDiff(a.tensorProduct(b).toMatrix(), expected.tensorProduct(other)) < 1e-12, "SoA tensor product " + name, failed);
+            }
+        }
+    }
+    check(numKernels > 0, "scalar kernels are always available", failed);
+    soaUseKernels(detected);
+    cout << "[INFO] [test_soa] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+#include "testutil.h"
+
+int main() {
+    int failed = 0;
+    for (int n = 1; n <= 5; ++ n) {
+        for (bool monomial : {true, false}) {
+            QCircuit qc = randomCircuit(n, 8 * n, 320 + n, monomial);
+            Matrix<DTYPE> expected = referenceMatrix(qc);
+            string name = "n: [" + to_string(n) + "] monomial: [" + to_string(monomial) + "]";
+
+            // the three accumulation formats
+            for (double threshold : {0.0, 0.1, 1.0}) {
+                Matrix<DTYPE> sv = randomState(n, n);
+                Matrix<DTYPE> svExpected = expected * sv;
+                SparseMatrix<DTYPE> opmat = OMSimSparse(sv, qc, threshold);
+                string t = name + " threshold: [" + to_string(threshold) + "]";
+                check(maxDiff(opmat.toDense(), expected) < 1e-12, "OMSimSparse " + t, failed);
+                check(maxDiff(sv, svExpected) < 1e-12, "OMSimSparse state " + t, failed);
+                if (monomial) {
+                    check(opmat.isMonomial() && opmat.nnz() == expected.row, "monomial nnz " + t, failed);
+                }
+            }
+
+            // sparse and monomial products against dense ones
+            QCircuit other = randomCircuit(n, 8 * n, 330 + n, monomial);
+            Matrix<DTYPE> otherExpected = referenceMatrix(other);
+            SparseMatrix<DTYPE> a(expected), b(otherExpected);
+            check(maxDiff((a * b).toDense(), expected * otherExpected) < 1e-12, "sparse product " + name, failed);
+            check(maxDiff(a * otherExpected, expected * otherExpected) < 1e-12, "sparse * dense " + name, failed);
+            check(maxDiff(a.tensorProduct(b).toDense(), expected.tensorProduct(otherExpected)) < 1e-12, "sparse tensor product " + name, failed);
+            if (monomial) {
+                MonomialMatrix<DTYPE> ma = a.toMonomial(), mb = b.toMonomial();
+                check(maxDiff((ma * mb).toDense(), expected * otherExpected) < 1e-12, "monomial product " + name, failed);
+                check(maxDiff(ma.tensorProduct(mb).toDense(), expected.tensorProduct(otherExpected)) < 1e-12, "monomial tensor product " + name, failed);
+            }
+        }
+    }
+    cout << "[INFO] [test_sparse] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+#include "testutil.h"
+#include "tensornet.h"
+
+int main() {
+    int failed = 0;
+    ll slicedPlans = 0;
+    for (int n = 1; n <= 10; ++ n) {
+        QCircuit qc = randomCircuit(n, 5 * n, 420 + n);
+        if (n % 2 == 0) {
+            QCircuit body = randomCircuit(n, n, 430 + n);
+            qc.repeat(body, 2);
+            addRandomGates(qc, n, 440 + n);
+        }
+        Matrix<DTYPE> sv(1LL << n, 1);
+        sv.data[0][0] = 1;
+        SVSim(sv, qc);
+        vector<ll> bitstrings;
+        for (ll x = 0; x < min(sv.row, 40LL); ++ x) {
+            bitstrings.push_back((x * 2654435761LL) % sv.row);
+        }
+
+        // a generous cap, and caps small enough to force slicing
+        for (ll memoryCap : {1LL << 30, 1LL << 12, 1LL << 9}) {
+            for (int numThreads : {1, 3}) {
+                string name = "n: [" + to_string(n) + "] cap: [" + to_string(memoryCap) + "] threads: [" + to_string(numThreads) + "]";
+                TNStats estimate;
+                shared_ptr<TNPlan> plan;
+                if (! tnEstimate(qc, memoryCap, numThreads, estimate, &plan)) {
+                    check(memoryCap < (1LL << 30), "generous cap fits " + name, failed);
+                    continue;
+                }
+                slicedPlans += estimate.numSlicedEdges > 0;
+                TNStats stats;
+                vector<DTYPE> amps = tnAmplitudes(qc, bitstrings, memoryCap, numThreads, &stats);
+                vector<DTYPE> reused = tnAmplitudes(*plan, bitstrings);
+                check(stats.numSlices == estimate.numSlices, "slices " + name, failed);
+                double diff = 0;
+                for (size_t k = 0; k < bitstrings.size(); ++ k) {
+                    diff = max(diff, abs(amps[k] - sv.data[bitstrings[k]][0]));
+                    diff = max(diff, abs(reused[k] - sv.data[bitstrings[k]][0]));
+                }
+                check(diff < 1e-12, "tnAmplitudes " + name, failed);
+                check(abs(tnAmplitude(qc, bitstrings.back(), memoryCap, numThreads) - sv.data[bitstrings.back()][0]) < 1e-12, "tnAmplitude " + name, failed);
+            }
+        }
+    }
+    check(slicedPlans > 0, "some plans slice edges", failed);
+    cout << "[INFO] [test_tensornet] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,38 @@
+#include "testutil.h"
+
+int main() {
+    int failed = 0;
+    for (int n = 1; n <= 6; ++ n) {
+        // repeated identical levels, so the cache has hits, and a repeated block as a leaf
+        QCircuit qc = randomCircuit(n, 8 * n, 460 + n);
+        QCircuit body = randomCircuit(n, 2 * n, 470 + n);
+        qc.repeat(body, 5);
+        for (int k = 0; k < 3; ++ k) {
+            for (int q = 0; q < n; ++ q) {
+                qc.h(q);
+            }
+        }
+        addRandomGates(qc, 4 * n, 480 + n);
+        Matrix<DTYPE> expected = referenceMatrix(qc);
+        Matrix<DTYPE> sv0 = randomState(n, n);
+        Matrix<DTYPE> svExpected = expected * sv0;
+
+        for (int numThreads : {1, 3, 0}) {
+            for (int maxLive : {0, 3, 4, 7}) {
+                for (bool cached : {false, true}) {
+                    string name = "n: [" + to_string(n) + "] threads: [" + to_string(numThreads) + "] maxLive: [" + to_string(maxLive) + "] cache: [" + to_string(cached) + "]";
+                    LevelCache cache;
+                    TreeStats stats;
+                    Matrix<DTYPE> sv = sv0;
+                    Matrix<DTYPE> opmat = OMSimTree(sv, qc, numThreads, maxLive, cached ? &cache : nullptr, &stats);
+                    check(maxDiff(opmat, expected) < 1e-12, "OMSimTree " + name, failed);
+                    check(maxDiff(sv, svExpected) < 1e-12, "OMSimTree state " + name, failed);
+                    check(stats.peakLive <= stats.maxLive && (maxLive == 0 || stats.maxLive == maxLive), "peakLive " + name, failed);
+                    check(stats.numLevels == qc.numDepths && stats.numProducts == stats.numLevels - 1, "tree shape " + name, failed);
+                }
+            }
+        }
+    }
+    cout << "[INFO] [test_tree] failed: [" << failed << "]" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "omsim.h"
+
+//
+// Shared helpers of the main/test_*.cpp programs
+//
+// The tests compare a simulation path against plain SVSim on small random
+// circuits. Each program prints "[INFO] [<name>] failed: [<count>]" and
+// returns nonzero if any check failed.
+//
+
+/**
+ * @brief Append random H, X, Y, Z, RX, RY, RZ, CX, CY, CZ and SWAP gates to a circuit
+ *
+ * @param qc the circuit
+ * @param numGates the number of gates
+ * @param seed the random seed
+ * @param monomial whether to draw only monomial gates, i.e., X, Y, Z, RZ, CX, CY, CZ and SWAP
+ */
+inline void addRandomGates(QCircuit& qc, int numGates, unsigned seed, bool monomial = false) {
+    mt19937 rng(seed);
+    int n = qc.numQubits;
+    for (int k = 0; k < numGates; ++ k) {
+        int kind = rng() % 11;
+        int a = rng() % n;
+        int b = (a + 1 + rng() % max(n - 1, 1)) % n;
+        double theta = (rng() % 10000) / 1000.0 - 5.0;
+        if (monomial && (kind == 0 || kind == 4 || kind == 5)) {
+            kind = 6; // H, RX and RY mix basis states
+        }
+        if (n == 1 && kind >= 7) {
+            kind = 6;
+        }
+        switch (kind) {
+            case 0: qc.h(a); break;
+            case 1: qc.x(a); break;
+            case 2: qc.y(a); break;
+            case 3: qc.z(a); break;
+            case 4: qc.rx(theta, a); break;
+            case 5: qc.ry(theta, a); break;
+            case 6: qc.rz(theta, a); break;
+            case 7: qc.cx(a, b); break;
+            case 8: qc.cy(a, b); break;
+            case 9: qc.cz(a, b); break;
+            default: qc.swap(a, b); break;
+        }
+    }
+}
+
+/**
+ * @brief Build a random circuit, see addRandomGates
+ */
+inline QCircuit randomCircuit(int numQubits, int numGates, unsigned seed, bool monomial = false) {
+    QCircuit qc(numQubits, "random");
+    addRandomGates(qc, numGates, seed, monomial);
+    return qc;
+}
+
+/**
+ * @brief Build a random normalized state vector
+ */
+inline Matrix<DTYPE> randomState(int numQubits, unsigned seed) {
+    mt19937 rng(seed);
+    normal_distribution<double> gauss(0.0, 1.0);
+    Matrix<DTYPE> sv(1LL << numQubits, 1);
+    double norm2 = 0;
+    for (ll i = 0; i < sv.row; ++ i) {
+        sv.data[i][0] = DTYPE(gauss(rng), gauss(rng));
+        norm2 += norm(sv.data[i][0]);
+    }
+    for (ll i = 0; i < sv.row; ++ i) {
+        sv.data[i][0] /= sqrt(norm2);
+    }
+    return sv;
+}
+
+/**
+ * @brief Compute the operation matrix of a circuit with SVSim: column j is the image of |j>
+ */
+inline Matrix<DTYPE> referenceMatrix(QCircuit& qc) {
+    Matrix<DTYPE> opmat;
+    opmat.identity(1LL << qc.numQubits);
+    SVSim(opmat, qc);
+    return opmat;
+}
+
+/**
+ * @brief Return max |a - b| over all entries, or infinity if the shapes differ
+ */
+inline double maxDiff(const Matrix<DTYPE>& a, const Matrix<DTYPE>& b) {
+    if (a.row != b.row || a.col != b.col) {
+        return numeric_limits<double>::infinity();
+    }
+    double diff = 0;
+    for (ll i = 0; i < a.row; ++ i) {
+        for (ll j = 0; j < a.col; ++ j) {
+            diff = max(diff, abs(a.data[i][j] - b.data[i][j]));
+        }
+    }
+    return diff;
+}
+
+/**
+ * @brief Count a failed check and print what failed
+ */
+inline void check(bool ok, const string& what, int& failed) {
+    if (! ok) {
+        cout << "[ERROR] " << what << endl;
+        ++ failed;
+    }
+}
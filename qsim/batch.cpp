@@ -0,0 +1,257 @@
+#include "batch.h"
+
+enum FlatKind { FLAT_2X2, FLAT_SWAP, FLAT_LOOP };
+
+// A compiled gate, or the head of a repeated block
+struct FlatOp {
+    FlatKind kind;
+    int q0; // the target of a 2x2 gate, or the first qubit of a SWAP
+    int q1; // the second qubit of a SWAP
+    ll cmask; // the control mask of a 2x2 gate
+    DTYPE u[4]; // the 2x2 matrix, row-major
+    ll count; // the repetitions of a loop
+    ll len; // the number of ops in the loop body, which follows the head
+};
+
+// The scratch memory of a worker, reused across jobs
+struct BatchArena {
+    vector<FlatOp> ops; // the compiled circuit
+    vector<DTYPE> buf; // the simulated state(s), row-major
+    vector<DTYPE> tmp; // the product U * sv
+};
+
+/**
+ * @brief Compile a quantum circuit into a flat gate list, skipping IDE and MARK gates
+ *
+ * @param qc the quantum circuit
+ * @param ops the gate list to append to
+ */
+static void compileCircuit(QCircuit& qc, vector<FlatOp>& ops) {
+    for (int j = 0; j < qc.numDepths; ++ j) {
+        if (qc.isRepeat(j)) {
+            QRepeat& rep = qc.repeats.find(j)->second;
+            size_t head = ops.size();
+            FlatOp loop;
+            loop.kind = FLAT_LOOP;
+            loop.count = rep.count;
+            ops.push_back(loop);
+            compileCircuit(*rep.body, ops);
+            ops[head].len = ops.size() - head - 1;
+            continue;
+        }
+        for (auto& gate : qc.gates[j]) {
+            if (gate.isIDE() || gate.isMARK()) {
+                continue;
+            }
+            FlatOp op;
+            if (gate.gname == "SWAP") {
+                op.kind = FLAT_SWAP;
+                op.q0 = gate.targetQubits[0];
+                op.q1 = gate.targetQubits[1];
+            } else if (gate.isSingle() || gate.is2QubitControlled()) {
+                op.kind = FLAT_2X2;
+                op.q0 = gate.targetQubits[0];
+                op.cmask = gate.controlQubits.empty() ? 0 : 1LL << gate.controlQubits[0];
+                Matrix<DTYPE>& m = *gate.gmat; // read only, no reference counting
+                op.u[0] = m.data[0][0];
+                op.u[1] = m.data[0][1];
+                op.u[2] = m.data[1][0];
+                op.u[3] = m.data[1][1];
+            } else {
+                cout << "[ERROR] compileCircuit: " << gate.gname << " not implemented" << endl;
+                exit(1);
+            }
+            ops.push_back(op);
+        }
+    }
+}
+
+/**
+ * @brief Apply a flat gate list in place to a row-major dim * width buffer
+ *
+ * @param ops the gate list
+ * @param nops the number of ops
+ * @param buf the buffer, row i holds amplitude i of every column
+ * @param dim the number of rows, 2^n
+ * @param width the number of columns
+ */
+static void runOps(const FlatOp* ops, ll nops, DTYPE* buf, ll dim, ll width) {
+    for (ll p = 0; p < nops; ) {
+        const FlatOp& op = ops[p];
+        if (op.kind == FLAT_LOOP) {
+            for (ll r = 0; r < op.count; ++ r) {
+                runOps(ops + p + 1, op.len, buf, dim, width);
+            }
+            p += 1 + op.len;
+            continue;
+        }
+        if (op.kind == FLAT_2X2) {
+            // local copies, buf may alias op.u as far as the compiler knows
+            DTYPE u00 = op.u[0], u01 = op.u[1];
+            DTYPE u10 = op.u[2], u11 = op.u[3];
+            ll tmask = 1LL << op.q0;
+            for (ll k = 0; k < (dim >> 1); ++ k) {
+                ll i0 = insertZeroBit(k, op.q0);
+                if ((i0 & op.cmask) != op.cmask) {
+                    continue;
+                }
+                DTYPE* r0 = buf + i0 * width;
+                DTYPE* r1 = buf + (i0 | tmask) * width;
+                for (ll c = 0; c < width; ++ c) {
+                    DTYPE a = r0[c];
+                    DTYPE b = r1[c];
+                    r0[c] = u00 * a + u01 * b;
+                    r1[c] = u10 * a + u11 * b;
+                }
+            }
+        } else {
+            ll mask0 = 1LL << op.q0;
+            ll mask1 = 1LL << op.q1;
+            for (ll i = 0; i < dim; ++ i) {
+                if ((i & mask0) && ! (i & mask1)) {
+                    swap_ranges(buf + i * width, buf + (i + 1) * width, buf + (i ^ mask0 ^ mask1) * width);
+                }
+            }
+        }
+        ++ p;
+    }
+}
+
+/**
+ * @brief Check the inputs and schedule the jobs on the work-stealing pool
+ *
+ * @param circuits the quantum circuits
+ * @param svs the state vectors
+ * @param opWidth whether each job simulates the 2^n columns of the operation matrix
+ * @param numThreads the number of threads
+ * @param stats optional scheduling statistics
+ * @param job the job function job(arena, i)
+ */
+static void runBatch(vector<QCircuit>& circuits, vector<Matrix<DTYPE>>& svs, bool opWidth, int numThreads, BatchStats* stats,
+                     const function<void(BatchArena&, ll)>& job) {
+    if (circuits.size() != svs.size()) {
+        cout << "[ERROR] runBatch: circuits.size() != svs.size(). " << endl;
+        exit(1);
+    }
+    vector<pair<double, ll>> costs;
+    for (size_t i = 0; i < circuits.size(); ++ i) {
+        if (svs[i].row != (1LL << circuits[i].numQubits)) {
+            cout << "[ERROR] runBatch: svs[" << i << "].row != 2^numQubits. " << endl;
+            exit(1);
+        }
+        // the cost of one level is about numQubits gates over all rows and columns
+        double width = opWidth ? svs[i].row : svs[i].col;
+        costs.push_back(make_pair(-(double)circuits[i].numDepths * circuits[i].numQubits * svs[i].row * width, (ll)i));
+    }
+    sort(costs.begin(), costs.end());
+    vector<ll> order;
+    for (auto& c : costs) {
+        order.push_back(c.second);
+    }
+
+    int workers = (int)min((ll)numWorkers(numThreads), max((ll)circuits.size(), 1LL));
+    vector<BatchArena> arenas(workers);
+    auto start = chrono::steady_clock::now();
+    ll steals = parallelForStealing(order, workers, [&](int w, ll i) {
+        job(arenas[w], i);
+    });
+    if (stats != nullptr) {
+        stats->numJobs = circuits.size();
+        stats->numSteals = steals;
+        stats->numWorkers = workers;
+        stats->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+}
+
+/**
+ * @brief Conduct operation matrix simulation of many independent circuits concurrently
+ *
+ * @param circuits the quantum circuits
+ * @param svs the state vectors, svs[i] is updated to U_i * svs[i]
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param stats optional scheduling statistics
+ * @return vector<Matrix<DTYPE>> the operation matrices, in the order of circuits
+ */
+vector<Matrix<DTYPE>> batchOMSim(vector<QCircuit>& circuits, vector<Matrix<DTYPE>>& svs, int numThreads, BatchStats* stats) {
+    vector<Matrix<DTYPE>> results(circuits.size());
+    runBatch(circuits, svs, true, numThreads, stats, [&](BatchArena& arena, ll i) {
+        ll dim = svs[i].row;
+        arena.ops.clear();
+        compileCircuit(circuits[i], arena.ops);
+
+        // column j of the row-major buffer is the image of the basis vector |j>
+        arena.buf.assign(dim * dim, DTYPE(0));
+        for (ll r = 0; r < dim; ++ r) {
+            arena.buf[r * dim + r] = 1;
+        }
+        runOps(arena.ops.data(), arena.ops.size(), arena.buf.data(), dim, dim);
+
+        Matrix<DTYPE> opmat(dim, dim);
+        for (ll r = 0; r < dim; ++ r) {
+            memcpy(opmat.data[r], &arena.buf[r * dim], dim * sizeof(DTYPE));
+        }
+
+        // update the state vector(s) sv
+        Matrix<DTYPE>& sv = svs[i];
+        arena.tmp.resize(dim);
+        for (ll c = 0; c < sv.col; ++ c) {
+            for (ll r = 0; r < dim; ++ r) {
+                const DTYPE* row = &arena.buf[r * dim];
+                DTYPE acc = 0;
+                for (ll k = 0; k < dim; ++ k) {
+                    acc += row[k] * sv.data[k][c];
+                }
+                arena.tmp[r] = acc;
+            }
+            for (ll r = 0; r < dim; ++ r) {
+                sv.data[r][c] = arena.tmp[r];
+            }
+        }
+        results[i] = move(opmat);
+    });
+    return results;
+}
+
+/**
+ * @brief Conduct state vector simulation of many independent circuits concurrently
+ *
+ * @param circuits the quantum circuits
+ * @param svs the state vector(s) of each circuit, updated in place
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param stats optional scheduling statistics
+ */
+void batchSVSim(vector<QCircuit>& circuits, vector<Matrix<DTYPE>>& svs, int numThreads, BatchStats* stats) {
+    runBatch(circuits, svs, false, numThreads, stats, [&](BatchArena& arena, ll i) {
+        Matrix<DTYPE>& sv = svs[i];
+        arena.ops.clear();
+        compileCircuit(circuits[i], arena.ops);
+
+        // gather the state vector(s) into the contiguous buffer and scatter them back
+        arena.buf.resize(sv.row * sv.col);
+        for (ll r = 0; r < sv.row; ++ r) {
+            memcpy(&arena.buf[r * sv.col], sv.data[r], sv.col * sizeof(DTYPE));
+        }
+        runOps(arena.ops.data(), arena.ops.size(), arena.buf.data(), sv.row, sv.col);
+        for (ll r = 0; r < sv.row; ++ r) {
+            memcpy(sv.data[r], &arena.buf[r * sv.col], sv.col * sizeof(DTYPE));
+        }
+    });
+}
+
+/**
+ * @brief Apply a quantum circuit in place to a contiguous buffer of state vectors
+ *
+ * @param qc the quantum circuit
+ * @param buf the 2^numQubits * width entries, row-major, row i holds amplitude i of every column
+ * @param width the number of columns
+ */
+void applyCircuitContiguous(QCircuit& qc, DTYPE* buf, ll width) {
+    vector<FlatOp> ops;
+    compileCircuit(qc, ops);
+    runOps(ops.data(), ops.size(), buf, 1LL << qc.numQubits, width);
+}
+
+void BatchStats::print() {
+    cout << "[INFO] [Batch] jobs: [" << numJobs << "] workers: [" << numWorkers << "] steals: [" << numSteals
+         << "] time: [" << seconds << "s] throughput: [" << numJobs / max(seconds, 1e-9) << " circuits/s]" << endl;
+}
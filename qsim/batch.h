@@ -0,0 +1,55 @@
+#pragma once
+
+#include "omsim.h"
+
+//
+// Throughput mode
+//
+// Many small independent circuits are simulated concurrently, one circuit per
+// worker at a time, instead of splitting each circuit across threads. The jobs
+// are scheduled on a work-stealing pool (parallelForStealing) in decreasing order
+// of estimated cost. Each worker compiles its circuit into a flat gate list and
+// simulates it in a contiguous row-major buffer. Both live in a per-worker scratch
+// arena that is reused across jobs. The workers never touch MatrixDict. They only
+// read the gate matrices the circuits already point to, which are shared
+// read-only by all circuits. Repeated blocks run as loops over their bodies.
+//
+
+struct BatchStats {
+    ll numJobs;
+    ll numSteals; // the number of jobs run by a worker other than the one they were dealt to
+    int numWorkers;
+    double seconds;
+
+    void print();
+};
+
+/**
+ * @brief Conduct operation matrix simulation of many independent circuits concurrently
+ *
+ * @param circuits the quantum circuits
+ * @param svs the state vectors, svs[i] is updated to U_i * svs[i]
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param stats optional scheduling statistics
+ * @return vector<Matrix<DTYPE>> the operation matrices, in the order of circuits
+ */
+vector<Matrix<DTYPE>> batchOMSim(vector<QCircuit>& circuits, vector<Matrix<DTYPE>>& svs, int numThreads = 0, BatchStats* stats = nullptr);
+
+/**
+ * @brief Conduct state vector simulation of many independent circuits concurrently
+ *
+ * @param circuits the quantum circuits
+ * @param svs the state vector(s) of each circuit, updated in place
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param stats optional scheduling statistics
+ */
+void batchSVSim(vector<QCircuit>& circuits, vector<Matrix<DTYPE>>& svs, int numThreads = 0, BatchStats* stats = nullptr);
+
+/**
+ * @brief Apply a quantum circuit in place to a contiguous buffer of state vectors
+ *
+ * @param qc the quantum circuit
+ * @param buf the 2^numQubits * width entries, row-major, row i holds amplitude i of every column
+ * @param width the number of columns
+ */
+void applyCircuitContiguous(QCircuit& qc, DTYPE* buf, ll width);
@@ -0,0 +1,256 @@
+#include "capi.h"
+#include "batch.h"
+#include "observable.h"
+#include "qasm.h"
+#include "sampler.h"
+#include "tensornet.h"
+
+#define CAPI_MAX_QUBITS 62
+
+struct qsim_circuit {
+    QCircuit qc;
+};
+
+static thread_local string LastError;
+
+// Record the error of the calling thread and return its code
+static int fail(int code, const string& message) {
+    LastError = message;
+    return code;
+}
+
+static bool validQubit(qsim_circuit* qc, int qid) {
+    return qc != nullptr && qid >= 0 && qid < qc->qc.numQubits;
+}
+
+int qsim_api_version(void) {
+    return QSIM_API_VERSION;
+}
+
+const char* qsim_last_error(void) {
+    return LastError.c_str();
+}
+
+//
+// Circuits
+//
+
+qsim_circuit* qsim_circuit_new(int num_qubits) {
+    if (num_qubits <= 0 || num_qubits > CAPI_MAX_QUBITS) {
+        fail(QSIM_ERR_ARGUMENT, "qsim_circuit_new: num_qubits out of range");
+        return nullptr;
+    }
+    qsim_circuit* qc = new qsim_circuit;
+    qc->qc = QCircuit(num_qubits);
+    return qc;
+}
+
+qsim_circuit* qsim_circuit_load_qasm(const char* path) {
+    if (path == nullptr) {
+        fail(QSIM_ERR_ARGUMENT, "qsim_circuit_load_qasm: path is null");
+        return nullptr;
+    }
+    qsim_circuit* qc = new qsim_circuit;
+    string error;
+    if (! tryLoadQASM(path, qc->qc, error)) {
+        delete qc;
+        fail(QSIM_ERR_ARGUMENT, "qsim_circuit_load_qasm: " + error);
+        return nullptr;
+    }
+    return qc;
+}
+
+void qsim_circuit_free(qsim_circuit* qc) {
+    delete qc;
+}
+
+int qsim_circuit_num_qubits(qsim_circuit* qc) {
+    return qc == nullptr ? -1 : qc->qc.numQubits;
+}
+
+int64_t qsim_circuit_num_gates(qsim_circuit* qc) {
+    return qc == nullptr ? -1 : qc->qc.numGates();
+}
+
+// Check the qubit of a single-qubit gate, then add it
+template <typename Add>
+static int addSingle(qsim_circuit* qc, int qid, const char* name, Add add) {
+    if (! validQubit(qc, qid)) {
+        return fail(QSIM_ERR_ARGUMENT, string(name) + ": invalid circuit or qubit");
+    }
+    add(qc->qc);
+    return QSIM_OK;
+}
+
+// Check the qubits of a 2-qubit gate, then add it
+template <typename Add>
+static int addPair(qsim_circuit* qc, int q1, int q2, const char* name, Add add) {
+    if (! validQubit(qc, q1) || ! validQubit(qc, q2) || q1 == q2) {
+        return fail(QSIM_ERR_ARGUMENT, string(name) + ": invalid circuit or qubits");
+    }
+    add(qc->qc);
+    return QSIM_OK;
+}
+
+int qsim_h(qsim_circuit* qc, int qid) {
+    return addSingle(qc, qid, "qsim_h", [&](QCircuit& c) { c.h(qid); });
+}
+
+int qsim_x(qsim_circuit* qc, int qid) {
+    return addSingle(qc, qid, "qsim_x", [&](QCircuit& c) { c.x(qid); });
+}
+
+int qsim_y(qsim_circuit* qc, int qid) {
+    return addSingle(qc, qid, "qsim_y", [&](QCircuit& c) { c.y(qid); });
+}
+
+int qsim_z(qsim_circuit* qc, int qid) {
+    return addSingle(qc, qid, "qsim_z", [&](QCircuit& c) { c.z(qid); });
+}
+
+int qsim_rx(qsim_circuit* qc, double theta, int qid) {
+    return addSingle(qc, qid, "qsim_rx", [&](QCircuit& c) { c.rx(theta, qid); });
+}
+
+int qsim_ry(qsim_circuit* qc, double theta, int qid) {
+    return addSingle(qc, qid, "qsim_ry", [&](QCircuit& c) { c.ry(theta, qid); });
+}
+
+int qsim_rz(qsim_circuit* qc, double theta, int qid) {
+    return addSingle(qc, qid, "qsim_rz", [&](QCircuit& c) { c.rz(theta, qid); });
+}
+
+int qsim_cx(qsim_circuit* qc, int ctrl, int targ) {
+    return addPair(qc, ctrl, targ, "qsim_cx", [&](QCircuit& c) { c.cx(ctrl, targ); });
+}
+
+int qsim_cy(qsim_circuit* qc, int ctrl, int targ) {
+    return addPair(qc, ctrl, targ, "qsim_cy", [&](QCircuit& c) { c.cy(ctrl, targ); });
+}
+
+int qsim_cz(qsim_circuit* qc, int ctrl, int targ) {
+    return addPair(qc, ctrl, targ, "qsim_cz", [&](QCircuit& c) { c.cz(ctrl, targ); });
+}
+
+int qsim_swap(qsim_circuit* qc, int qid1, int qid2) {
+    return addPair(qc, qid1, qid2, "qsim_swap", [&](QCircuit& c) { c.swap(qid1, qid2); });
+}
+
+int qsim_barrier(qsim_circuit* qc) {
+    if (qc == nullptr) {
+        return fail(QSIM_ERR_ARGUMENT, "qsim_barrier: circuit is null");
+    }
+    qc->qc.barrier();
+    return QSIM_OK;
+}
+
+int qsim_repeat(qsim_circuit* qc, qsim_circuit* body, int64_t count) {
+    if (qc == nullptr || body == nullptr || body->qc.numQubits != qc->qc.numQubits || count < 0) {
+        return fail(QSIM_ERR_ARGUMENT, "qsim_repeat: invalid circuits or count");
+    }
+    qc->qc.repeat(body->qc, count);
+    return QSIM_OK;
+}
+
+//
+// Simulation
+//
+
+int qsim_apply(qsim_circuit* qc, double* states, int64_t rows, int64_t cols) {
+    if (qc == nullptr || states == nullptr || cols <= 0) {
+        return fail(QSIM_ERR_ARGUMENT, "qsim_apply: null circuit or buffer, or cols <= 0");
+    }
+    if (qc->qc.numQubits > CAPI_MAX_QUBITS || rows != (1LL << qc->qc.numQubits)) {
+        return fail(QSIM_ERR_SIZE, "qsim_apply: rows != 2^numQubits");
+    }
+    // complex<double> is layout-compatible with double[2]
+    applyCircuitContiguous(qc->qc, reinterpret_cast<DTYPE*>(states), cols);
+    return QSIM_OK;
+}
+
+int qsim_operation_matrix(qsim_circuit* qc, double* out, int64_t dim) {
+    if (qc == nullptr || out == nullptr) {
+        return fail(QSIM_ERR_ARGUMENT, "qsim_operation_matrix: null circuit or buffer");
+    }
+    if (qc->qc.numQubits > 31 || dim != (1LL << qc->qc.numQubits)) {
+        return fail(QSIM_ERR_SIZE, "qsim_operation_matrix: dim != 2^numQubits");
+    }
+    // column j of the identity is the basis vector |j>, U is built in place
+    DTYPE* buf = reinterpret_cast<DTYPE*>(out);
+    fill(buf, buf + dim * dim, DTYPE(0));
+    for (ll i = 0; i < dim; ++ i) {
+        buf[i * dim + i] = 1;
+    }
+    applyCircuitContiguous(qc->qc, buf, dim);
+    return QSIM_OK;
+}
+
+int qsim_amplitudes(qsim_circuit* qc, const int64_t* bitstrings, int64_t count, double* out, int64_t memory_cap, int num_threads) {
+    if (qc == nullptr || bitstrings == nullptr || out == nullptr || count < 0 || num_threads < 0) {
+        return fail(QSIM_ERR_ARGUMENT, "qsim_amplitudes: invalid arguments");
+    }
+    vector<ll> xs(bitstrings, bitstrings + count);
+    for (ll x : xs) {
+        if (x < 0 || (x >> qc->qc.numQubits) != 0) {
+            return fail(QSIM_ERR_ARGUMENT, "qsim_amplitudes: bitstring out of range");
+        }
+    }
+    ll cap = memory_cap > 0 ? memory_cap : 1LL << 30;
+    // the contraction reuses the plan of the estimate
+    TNStats stats;
+    shared_ptr<TNPlan> plan;
+    if (! tnEstimate(qc->qc, cap, num_threads, stats, &plan)) {
+        return fail(QSIM_ERR_SIZE, "qsim_amplitudes: memory_cap is too small for this circuit");
+    }
+    vector<DTYPE> amps = tnAmplitudes(*plan, xs);
+    copy(amps.begin(), amps.end(), reinterpret_cast<DTYPE*>(out));
+    return QSIM_OK;
+}
+
+//
+// Results
+//
+
+int qsim_expectation(const double* state, int num_qubits, const char* const* paulis, const double* coeffs, int64_t num_terms,
+                     double* out, int num_threads) {
+    if (state == nullptr || paulis == nullptr || coeffs == nullptr || out == nullptr || num_terms < 0
+        || num_qubits <= 0 || num_qubits > CAPI_MAX_QUBITS || num_threads < 0) {
+        return fail(QSIM_ERR_ARGUMENT, "qsim_expectation: invalid arguments");
+    }
+    Observable obs(num_qubits);
+    for (int64_t t = 0; t < num_terms; ++ t) {
+        string p = paulis[t] == nullptr ? "" : paulis[t];
+        if ((int)p.size() != num_qubits || p.find_first_not_of("IXYZ") != string::npos) {
+            return fail(QSIM_ERR_ARGUMENT, "qsim_expectation: a Pauli string is not num_qubits characters over {I, X, Y, Z}");
+        }
+        obs.add(coeffs[t], p);
+    }
+    *out = obs.expectation(reinterpret_cast<const DTYPE*>(state), num_threads);
+    return QSIM_OK;
+}
+
+int qsim_sample(const double* state, int num_qubits, int64_t shots, int64_t seed, int64_t* indices, int64_t* counts,
+                int64_t capacity, int64_t* num_outcomes, int num_threads) {
+    if (state == nullptr || num_outcomes == nullptr || shots < 0 || capacity < 0 || num_qubits <= 0 || num_qubits > CAPI_MAX_QUBITS
+        || num_threads < 0 || (capacity > 0 && (indices == nullptr || counts == nullptr))) {
+        return fail(QSIM_ERR_ARGUMENT, "qsim_sample: invalid arguments");
+    }
+    ll dim = 1LL << num_qubits;
+    vector<double> weights(dim);
+    double total = 0;
+    for (ll i = 0; i < dim; ++ i) {
+        weights[i] = state[2 * i] * state[2 * i] + state[2 * i + 1] * state[2 * i + 1];
+        total += weights[i];
+    }
+    // sampleIndices exits on a zero or NaN total
+    if (! (isfinite(total) && total > 0)) {
+        return fail(QSIM_ERR_ARGUMENT, "qsim_sample: the state has a zero or non-finite norm");
+    }
+    vector<pair<ll, ll>> outcomes = sampleIndices(weights, shots, seed, num_threads);
+    *num_outcomes = outcomes.size();
+    for (ll k = 0; k < (ll)outcomes.size() && k < capacity; ++ k) {
+        indices[k] = outcomes[k].first;
+        counts[k] = outcomes[k].second;
+    }
+    return QSIM_OK;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+/*
+ * C API of libqsim.so (make lib)
+ *
+ * Circuits are opaque handles. Complex buffers are caller-owned, row-major,
+ * interleaved complex128 (real, imag), i.e., the memory layout of a C-ordered
+ * NumPy array of dtype complex128 or an Arrow fixed-size list of 2 doubles.
+ * Results are written straight into these buffers without intermediate copies.
+ * Amplitude i is the basis state whose bit q is the value of qubit q.
+ *
+ * Every function returns QSIM_OK or an error code, and qsim_last_error()
+ * describes the last error of the calling thread. No call holds a lock
+ * while simulating, so independent calls may run concurrently, and one
+ * circuit may be simulated by several threads at once as long as no thread
+ * modifies it.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__) && ! defined(_WIN32)
+#define QSIM_API __attribute__((visibility("default")))
+#else
+#define QSIM_API
+#endif
+
+#define QSIM_API_VERSION 1
+
+#define QSIM_OK 0
+#define QSIM_ERR_ARGUMENT 1 /* a null handle, a qubit out of range, ... */
+#define QSIM_ERR_SIZE 2 /* a buffer does not match the circuit */
+
+typedef struct qsim_circuit qsim_circuit;
+
+QSIM_API int qsim_api_version(void);
+QSIM_API const char* qsim_last_error(void);
+
+/*
+ * Circuits
+ */
+QSIM_API qsim_circuit* qsim_circuit_new(int num_qubits); /* NULL if num_qubits is out of range */
+QSIM_API qsim_circuit* qsim_circuit_load_qasm(const char* path); /* NULL if the file cannot be read or parsed */
+QSIM_API void qsim_circuit_free(qsim_circuit* qc);
+QSIM_API int qsim_circuit_num_qubits(qsim_circuit* qc);
+QSIM_API int64_t qsim_circuit_num_gates(qsim_circuit* qc); /* repeated blocks expanded */
+
+QSIM_API int qsim_h(qsim_circuit* qc, int qid);
+QSIM_API int qsim_x(qsim_circuit* qc, int qid);
+QSIM_API int qsim_y(qsim_circuit* qc, int qid);
+QSIM_API int qsim_z(qsim_circuit* qc, int qid);
+QSIM_API int qsim_rx(qsim_circuit* qc, double theta, int qid);
+QSIM_API int qsim_ry(qsim_circuit* qc, double theta, int qid);
+QSIM_API int qsim_rz(qsim_circuit* qc, double theta, int qid);
+QSIM_API int qsim_cx(qsim_circuit* qc, int ctrl, int targ);
+QSIM_API int qsim_cy(qsim_circuit* qc, int ctrl, int targ);
+QSIM_API int qsim_cz(qsim_circuit* qc, int ctrl, int targ);
+QSIM_API int qsim_swap(qsim_circuit* qc, int qid1, int qid2);
+QSIM_API int qsim_barrier(qsim_circuit* qc);
+QSIM_API int qsim_repeat(qsim_circuit* qc, qsim_circuit* body, int64_t count); /* body is copied */
+
+/*
+ * Simulation
+ */
+
+/* Apply the circuit in place to rows * cols complex entries, rows = 2^n, column j is the j-th state */
+QSIM_API int qsim_apply(qsim_circuit* qc, double* states, int64_t rows, int64_t cols);
+
+/* Write the operation matrix U into dim * dim complex entries, dim = 2^n */
+QSIM_API int qsim_operation_matrix(qsim_circuit* qc, double* out, int64_t dim);
+
+/* Write <x|U|0...0> for count bitstrings into count complex entries, by tensor-network contraction */
+QSIM_API int qsim_amplitudes(qsim_circuit* qc, const int64_t* bitstrings, int64_t count, double* out, int64_t memory_cap, int num_threads);
+
+/*
+ * Results
+ */
+
+/* Write sum_t coeffs[t] <state| P_t |state> into out, paulis[t] over {I, X, Y, Z}, the last character on qubit 0 */
+QSIM_API int qsim_expectation(const double* state, int num_qubits, const char* const* paulis, const double* coeffs, int64_t num_terms,
+                              double* out, int num_threads);
+
+/*
+ * Sample shots basis states from 2^num_qubits amplitudes, seed -1 for a random seed.
+ * Writes the distinct outcomes and their counts in ascending order into indices and
+ * counts, up to capacity entries, and the number of distinct outcomes into num_outcomes.
+ * QSIM_ERR_ARGUMENT if the norm of the state is zero or not finite.
+ */
+QSIM_API int qsim_sample(const double* state, int num_qubits, int64_t shots, int64_t seed, int64_t* indices, int64_t* counts,
+                         int64_t capacity, int64_t* num_outcomes, int num_threads);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,143 @@
+#include "equivalence.h"
+
+#define MAX_EXACT_QUBITS 14 // U1 and U2 take 2 * 16 * 4^n bytes
+
+// Print the result of an equivalence check
+void EquivalenceResult::print() {
+    cout << "[INFO] [Equivalence] equivalent: [" << (equivalent ? "true" : "false") << "] method: [" 
+         << (exact ? "exact" : "states") << "] numStates: [" << numStates << "] globalPhase: [" << globalPhase 
+         << "] minFidelity: [" << minFidelity << "] maxDeviation: [" << maxDeviation 
+         << "] processFidelity >= [" << processFidelityBound << "] confidence: [" << confidence << "]" << endl;
+}
+
+/**
+ * @brief Check if two circuits are equivalent up to global phase with random and basis states
+ * 
+ * @param qc1 a quantum circuit
+ * @param qc2 a quantum circuit with the same number of qubits
+ * @param numRandom the number of Haar-random states
+ * @param basisStates the computational basis states to test, e.g., {0}
+ * @param tol the tolerance on |<U1 x|U2 x> - globalPhase|
+ * @param confidence the confidence of the process fidelity bound
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return EquivalenceResult the result
+ */
+EquivalenceResult checkEquivalence(QCircuit& qc1, QCircuit& qc2, ll numRandom, vector<ll> basisStates, 
+                                   double tol, double confidence, ll seed, int numThreads) {
+    if (qc1.numQubits != qc2.numQubits) {
+        cout << "[ERROR] checkEquivalence: qc1.numQubits != qc2.numQubits. " << endl;
+        exit(1);
+    }
+    ll dim = 1LL << qc1.numQubits;
+    ll numStates = numRandom + basisStates.size();
+    if (numStates == 0) {
+        cout << "[ERROR] checkEquivalence: no states to test. " << endl;
+        exit(1);
+    }
+
+    // columns [0, numRandom) are Haar-random states, the rest are basis states
+    Matrix<DTYPE> states(dim, numStates);
+    mt19937_64 rng(seed < 0 ? random_device()() : (unsigned long long)seed);
+    normal_distribution<double> gauss(0, 1);
+    for (ll c = 0; c < numRandom; ++ c) {
+        double nrm = 0;
+        for (ll i = 0; i < dim; ++ i) {
+            states.data[i][c] = DTYPE(gauss(rng), gauss(rng));
+            nrm += norm(states.data[i][c]);
+        }
+        for (ll i = 0; i < dim; ++ i) {
+            states.data[i][c] /= sqrt(nrm);
+        }
+    }
+    for (size_t b = 0; b < basisStates.size(); ++ b) {
+        if (basisStates[b] < 0 || basisStates[b] >= dim) {
+            cout << "[ERROR] checkEquivalence: basis state " << basisStates[b] << " out of range. " << endl;
+            exit(1);
+        }
+        states.data[basisStates[b]][numRandom + b] = 1;
+    }
+
+    Matrix<DTYPE> out1(states), out2(move(states));
+    cacheRepeatMatrices(qc1, numStates, numThreads);
+    cacheRepeatMatrices(qc2, numStates, numThreads);
+    parallelFor(0, numStates, numThreads, [&](ll cbegin, ll cend) {
+        applyCircuit(out1, qc1, cbegin, cend);
+        applyCircuit(out2, qc2, cbegin, cend);
+    });
+
+    // overlaps <U1 x|U2 x> of every column
+    vector<DTYPE> overlap(numStates, 0);
+    for (ll i = 0; i < dim; ++ i) {
+        for (ll c = 0; c < numStates; ++ c) {
+            overlap[c] += conj(out1.data[i][c]) * out2.data[i][c];
+        }
+    }
+
+    EquivalenceResult res;
+    res.exact = false;
+    res.numStates = numStates;
+    res.globalPhase = abs(overlap[0]) > 0 ? overlap[0] / abs(overlap[0]) : DTYPE(1);
+    res.minFidelity = 1;
+    res.maxDeviation = 0;
+    double sumRandom = 0;
+    for (ll c = 0; c < numStates; ++ c) {
+        double fid = norm(overlap[c]);
+        res.minFidelity = min(res.minFidelity, fid);
+        res.maxDeviation = max(res.maxDeviation, abs(overlap[c] - res.globalPhase));
+        if (c < numRandom) {
+            sumRandom += fid;
+        }
+    }
+    res.equivalent = res.maxDeviation <= tol;
+
+    res.confidence = confidence;
+    res.processFidelityBound = 0;
+    if (numRandom > 0) {
+        double favg = sumRandom / numRandom - sqrt(log(1.0 / (1.0 - confidence)) / (2.0 * numRandom));
+        res.processFidelityBound = max(0.0, ((dim + 1) * favg - 1) / dim);
+    }
+    return res;
+}
+
+/**
+ * @brief Check if two circuits are equivalent up to global phase exactly, for small circuits
+ * 
+ * @param qc1 a quantum circuit
+ * @param qc2 a quantum circuit with the same number of qubits
+ * @param tol the tolerance on 1 - |tr(U1^dag U2)| / d
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return EquivalenceResult the result
+ */
+EquivalenceResult checkEquivalenceExact(QCircuit& qc1, QCircuit& qc2, double tol, int numThreads) {
+    if (qc1.numQubits != qc2.numQubits) {
+        cout << "[ERROR] checkEquivalenceExact: qc1.numQubits != qc2.numQubits. " << endl;
+        exit(1);
+    }
+    if (qc1.numQubits > MAX_EXACT_QUBITS) {
+        cout << "[ERROR] checkEquivalenceExact: more than " << MAX_EXACT_QUBITS << " qubits, use checkEquivalence. " << endl;
+        exit(1);
+    }
+    ll dim = 1LL << qc1.numQubits;
+    Matrix<DTYPE> sv1(dim, 1), sv2(dim, 1);
+    Matrix<DTYPE> u1 = OMSimColumnwise(sv1, qc1, numThreads);
+    Matrix<DTYPE> u2 = OMSimColumnwise(sv2, qc2, numThreads);
+
+    DTYPE trace = 0;
+    for (ll i = 0; i < dim; ++ i) {
+        for (ll j = 0; j < dim; ++ j) {
+            trace += conj(u1.data[i][j]) * u2.data[i][j];
+        }
+    }
+
+    EquivalenceResult res;
+    res.exact = true;
+    res.numStates = dim;
+    res.globalPhase = abs(trace) > 0 ? trace / abs(trace) : DTYPE(1);
+    res.processFidelityBound = norm(trace) / ((double)dim * dim);
+    res.minFidelity = res.processFidelityBound;
+    res.maxDeviation = 1 - abs(trace) / dim;
+    res.confidence = 1;
+    res.equivalent = res.maxDeviation <= tol;
+    return res;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "omsim.h"
+
+// The result of an equivalence check of two circuits up to global phase
+struct EquivalenceResult {
+    bool equivalent; // U2 = globalPhase * U1 on all tested states (or exactly)
+    bool exact; // obtained by the exact trace check
+    ll numStates; // the number of tested states
+    DTYPE globalPhase; // the estimated global phase
+    double minFidelity; // min over the tested states of |<U1 x|U2 x>|^2
+    double maxDeviation; // max over the tested states of |<U1 x|U2 x> - globalPhase|
+    double processFidelityBound; // a lower bound on |tr(U1^dag U2)|^2 / d^2 (the exact value if exact)
+    double confidence; // the confidence of processFidelityBound
+
+    void print();
+};
+
+/**
+ * @brief Check if two circuits are equivalent up to global phase with random and basis states
+ * 
+ * All states are pushed through both circuits as one column batch with the in-place 
+ * gate kernels. The circuits are equivalent on the tested states if every overlap 
+ * <U1 x|U2 x> equals the same unit phase. From the mean fidelity F over k Haar-random 
+ * states, Hoeffding's inequality gives F_avg >= F - sqrt(ln(1/(1-confidence)) / (2k)), 
+ * and F_pro = ((d+1) F_avg - 1) / d converts it into a process fidelity bound. 
+ * 
+ * @param qc1 a quantum circuit
+ * @param qc2 a quantum circuit with the same number of qubits
+ * @param numRandom the number of Haar-random states
+ * @param basisStates the computational basis states to test, e.g., {0}
+ * @param tol the tolerance on |<U1 x|U2 x> - globalPhase|
+ * @param confidence the confidence of the process fidelity bound
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return EquivalenceResult the result
+ */
+EquivalenceResult checkEquivalence(QCircuit& qc1, QCircuit& qc2, ll numRandom = 16, vector<ll> basisStates = {0}, 
+                                   double tol = 1e-8, double confidence = 0.99, ll seed = -1, int numThreads = 0);
+
+/**
+ * @brief Check if two circuits are equivalent up to global phase exactly, for small circuits
+ * 
+ * U1^dag U2 is unitary, so |tr(U1^dag U2)| = d iff U1^dag U2 = e^{i phi} I. The trace 
+ * is sum_ij conj(U1_ij) U2_ij, so no matrix product is needed once U1 and U2 are built. 
+ * 
+ * @param qc1 a quantum circuit
+ * @param qc2 a quantum circuit with the same number of qubits
+ * @param tol the tolerance on 1 - |tr(U1^dag U2)| / d
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return EquivalenceResult the result
+ */
+EquivalenceResult checkEquivalenceExact(QCircuit& qc1, QCircuit& qc2, double tol = 1e-8, int numThreads = 0);
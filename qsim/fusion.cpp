@@ -0,0 +1,392 @@
+#include "fusion.h"
+#include "parallel.h"
+
+#define FUSED_EPS 1e-14 // entries below this are treated as zero when detecting structure
+#define FUSED_PARALLEL_BASES (1LL << 14) // ops with fewer bases are applied by one thread
+
+// A block of gates on disjoint qubits from the other open blocks
+struct OpenBlock {
+    vector<int> qubits; // ascending
+    vector<QGate*> gates; // in circuit order
+};
+
+// Return the control and target qubits of a gate
+static vector<int> gateQubits(QGate& gate) {
+    vector<int> qubits = gate.controlQubits;
+    qubits.insert(qubits.end(), gate.targetQubits.begin(), gate.targetQubits.end());
+    return qubits;
+}
+
+// Check if local bit b of a 2^k * 2^k matrix acts as a control: no mixing of the bit, and the identity where it is 0
+static bool isControlBit(const vector<DTYPE>& u, int k, int b) {
+    ll dim = 1LL << k;
+    for (ll r = 0; r < dim; ++ r) {
+        for (ll c = 0; c < dim; ++ c) {
+            bool rb = (r >> b) & 1, cb = (c >> b) & 1;
+            if (rb != cb && abs(u[r * dim + c]) > FUSED_EPS) {
+                return false;
+            }
+            if (! rb && ! cb && abs(u[r * dim + c] - DTYPE(r == c ? 1 : 0)) > FUSED_EPS) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Return the 2^(k-1) * 2^(k-1) block of u where local bit b is 1
+static vector<DTYPE> controlledBlock(const vector<DTYPE>& u, int k, int b) {
+    ll dim = 1LL << k, half = dim >> 1;
+    vector<DTYPE> v(half * half);
+    for (ll r = 0; r < half; ++ r) {
+        for (ll c = 0; c < half; ++ c) {
+            v[r * half + c] = u[(insertZeroBit(r, b) | (1LL << b)) * dim + (insertZeroBit(c, b) | (1LL << b))];
+        }
+    }
+    return v;
+}
+
+/**
+ * @brief Turn a closed block into a fused op, stripping controls and detecting diagonal matrices
+ *
+ * @param block the block
+ * @param ops the ops to append to
+ * @param stats the statistics to update
+ */
+static void emitBlock(OpenBlock& block, vector<FusedOp>& ops, FusionStats& stats) {
+    int k = block.qubits.size();
+    if (k > FUSED_MAX_QUBITS) {
+        cout << "[ERROR] fuseCircuit: a gate on more than " << FUSED_MAX_QUBITS << " qubits" << endl;
+        exit(1);
+    }
+    // the block matrix is the product of its gates on the local qubits
+    ll dim = 1LL << k;
+    Matrix<DTYPE> local;
+    local.identity(dim);
+    for (QGate* gate : block.gates) {
+        QGate lg(*gate);
+        for (int& q : lg.controlQubits) {
+            q = lower_bound(block.qubits.begin(), block.qubits.end(), q) - block.qubits.begin();
+        }
+        for (int& q : lg.targetQubits) {
+            q = lower_bound(block.qubits.begin(), block.qubits.end(), q) - block.qubits.begin();
+        }
+        applyGate(local, lg, 0, dim);
+    }
+    FusedOp op;
+    op.targets = block.qubits;
+    op.cmask = 0;
+    op.mat.assign(local.data[0], local.data[0] + dim * dim);
+    op.numGates = block.gates.size();
+    op.count = 0;
+    op.len = 0;
+
+    // strip the controls from the highest bit down, so the lower local bits keep their positions
+    for (int b = k - 1; b >= 0; -- b) {
+        if (isControlBit(op.mat, k, b)) {
+            op.mat = controlledBlock(op.mat, k, b);
+            op.cmask |= 1LL << op.targets[b];
+            op.targets.erase(op.targets.begin() + b);
+            -- k;
+        }
+    }
+    dim = 1LL << k;
+    bool diagonal = true, identity = true;
+    for (ll r = 0; r < dim; ++ r) {
+        for (ll c = 0; c < dim; ++ c) {
+            DTYPE expect = r == c ? 1 : 0;
+            diagonal = diagonal && (r == c || abs(op.mat[r * dim + c]) <= FUSED_EPS);
+            identity = identity && abs(op.mat[r * dim + c] - expect) <= FUSED_EPS;
+        }
+    }
+    stats.numGates += op.numGates;
+    if (identity) {
+        ++ stats.numDropped;
+        return;
+    }
+    if (diagonal) {
+        op.kind = FUSED_DIAGONAL;
+        vector<DTYPE> diag(dim);
+        for (ll r = 0; r < dim; ++ r) {
+            diag[r] = op.mat[r * dim + r];
+        }
+        op.mat = diag;
+        ++ stats.numDiagonal;
+    } else {
+        op.kind = FUSED_DENSE;
+        ++ stats.numDense;
+    }
+    ++ stats.numOps;
+    stats.numControlled += op.cmask != 0;
+    ++ stats.opsByQubits[k];
+    ops.push_back(op);
+}
+
+/**
+ * @brief Fuse the levels of a quantum circuit into ops, recursing into repeated blocks
+ *
+ * @param qc the quantum circuit
+ * @param maxQubits the max qubits of a block
+ * @param ops the ops to append to
+ * @param stats the statistics to update
+ */
+static void fuseInto(QCircuit& qc, int maxQubits, vector<FusedOp>& ops, FusionStats& stats) {
+    map<int, OpenBlock> open; // keyed by creation order
+    vector<int> owner(qc.numQubits, -1); // the open block on each qubit
+    int nextId = 0;
+    auto close = [&](int id) {
+        for (int q : open[id].qubits) {
+            owner[q] = -1;
+        }
+        emitBlock(open[id], ops, stats);
+        open.erase(id);
+    };
+
+    for (int j = 0; j < qc.numDepths; ++ j) {
+        if (qc.isRepeat(j)) {
+            // a repeated block is a barrier on all qubits
+            while (! open.empty()) {
+                close(open.begin()->first);
+            }
+            QRepeat& rep = qc.repeats.find(j)->second;
+            size_t head = ops.size();
+            FusedOp loop;
+            loop.kind = FUSED_LOOP;
+            loop.cmask = 0;
+            loop.numGates = 0;
+            loop.count = rep.count;
+            loop.len = 0;
+            ops.push_back(loop);
+            fuseInto(*rep.body, maxQubits, ops, stats);
+            ops[head].len = ops.size() - head - 1;
+            continue;
+        }
+        for (auto& gate : qc.gates[j]) {
+            if (gate.isIDE() || gate.isMARK()) {
+                continue;
+            }
+            vector<int> qubits = gateQubits(gate);
+            set<int> touched, joint(qubits.begin(), qubits.end());
+            for (int q : qubits) {
+                if (owner[q] >= 0) {
+                    touched.insert(owner[q]);
+                }
+            }
+            for (int id : touched) {
+                joint.insert(open[id].qubits.begin(), open[id].qubits.end());
+            }
+            OpenBlock block;
+            if ((int)joint.size() <= maxQubits) {
+                // the touched blocks are on disjoint qubits, so their gates commute
+                block.qubits.assign(joint.begin(), joint.end());
+                for (int id : touched) {
+                    block.gates.insert(block.gates.end(), open[id].gates.begin(), open[id].gates.end());
+                    open.erase(id);
+                }
+            } else {
+                for (int id : touched) {
+                    close(id);
+                }
+                block.qubits = qubits;
+                sort(block.qubits.begin(), block.qubits.end());
+            }
+            block.gates.push_back(&gate);
+            for (int q : block.qubits) {
+                owner[q] = nextId;
+            }
+            open[nextId ++] = block;
+        }
+    }
+    while (! open.empty()) {
+        close(open.begin()->first);
+    }
+}
+
+/**
+ * @brief Fuse the gates of a quantum circuit into blocks of at most maxQubits qubits
+ *
+ * @param qc the quantum circuit
+ * @param maxQubits the max qubits of a block, 1 to FUSED_MAX_QUBITS, a wider gate forms a block of its own
+ * @param stats optional fusion statistics
+ * @return vector<FusedOp> the fused ops, in circuit order
+ */
+vector<FusedOp> fuseCircuit(QCircuit& qc, int maxQubits, FusionStats* stats) {
+    if (maxQubits < 1 || maxQubits > FUSED_MAX_QUBITS) {
+        cout << "[ERROR] fuseCircuit: maxQubits must be in [1, " << FUSED_MAX_QUBITS << "]" << endl;
+        exit(1);
+    }
+    FusionStats local = {0, 0, 0, 0, 0, 0, {0}};
+    vector<FusedOp> ops;
+    fuseInto(qc, maxQubits, ops, local);
+    if (stats != nullptr) {
+        *stats = local;
+    }
+    return ops;
+}
+
+//
+// Kernels
+//
+// The bases are the rows whose target qubits are 0 and whose control qubits
+// are 1. Base k of [0, 2^(n - #targets - #controls)) is found by inserting zero
+// bits at the targets and controls in ascending order and setting the controls.
+// Row base + offs[l] holds local index l of the op's matrix.
+//
+
+// Return base k with zero bits inserted at the fixed qubits (ascending) and the controls set
+static inline ll baseIndex(ll k, const int* fixed, int numFixed, ll cmask) {
+    for (int f = 0; f < numFixed; ++ f) {
+        k = insertZeroBit(k, fixed[f]);
+    }
+    return k | cmask;
+}
+
+// Apply a dense 2^K * 2^K matrix to the bases [kbegin, kend)
+template <int K>
+static void denseKernel(Matrix<DTYPE>& mat, const FusedOp& op, const int* fixed, int numFixed, ll kbegin, ll kend, ll cbegin, ll cend) {
+    const int D = 1 << K;
+    ll offs[D];
+    double mr[D * D], mi[D * D];
+    for (int l = 0; l < D; ++ l) {
+        offs[l] = 0;
+        for (int b = 0; b < K; ++ b) {
+            offs[l] |= (ll)((l >> b) & 1) << op.targets[b];
+        }
+    }
+    for (int e = 0; e < D * D; ++ e) {
+        mr[e] = op.mat[e].real();
+        mi[e] = op.mat[e].imag();
+    }
+    for (ll k = kbegin; k < kend; ++ k) {
+        ll base = baseIndex(k, fixed, numFixed, op.cmask);
+        DTYPE* rows[D];
+        for (int l = 0; l < D; ++ l) {
+            rows[l] = mat.data[base + offs[l]];
+        }
+        for (ll c = cbegin; c < cend; ++ c) {
+            double vr[D], vi[D];
+            for (int l = 0; l < D; ++ l) {
+                vr[l] = rows[l][c].real();
+                vi[l] = rows[l][c].imag();
+            }
+            for (int r = 0; r < D; ++ r) {
+                double ar = 0, ai = 0;
+                for (int l = 0; l < D; ++ l) {
+                    ar += mr[r * D + l] * vr[l] - mi[r * D + l] * vi[l];
+                    ai += mr[r * D + l] * vi[l] + mi[r * D + l] * vr[l];
+                }
+                rows[r][c] = DTYPE(ar, ai);
+            }
+        }
+    }
+}
+
+// Multiply the rows of the bases [kbegin, kend) by a 2^K diagonal
+template <int K>
+static void diagonalKernel(Matrix<DTYPE>& mat, const FusedOp& op, const int* fixed, int numFixed, ll kbegin, ll kend, ll cbegin, ll cend) {
+    const int D = 1 << K;
+    ll offs[D];
+    double dr[D], di[D];
+    for (int l = 0; l < D; ++ l) {
+        offs[l] = 0;
+        for (int b = 0; b < K; ++ b) {
+            offs[l] |= (ll)((l >> b) & 1) << op.targets[b];
+        }
+        dr[l] = op.mat[l].real();
+        di[l] = op.mat[l].imag();
+    }
+    for (ll k = kbegin; k < kend; ++ k) {
+        ll base = baseIndex(k, fixed, numFixed, op.cmask);
+        for (int l = 0; l < D; ++ l) {
+            DTYPE* row = mat.data[base + offs[l]];
+            for (ll c = cbegin; c < cend; ++ c) {
+                double xr = row[c].real(), xi = row[c].imag();
+                row[c] = DTYPE(dr[l] * xr - di[l] * xi, dr[l] * xi + di[l] * xr);
+            }
+        }
+    }
+}
+
+typedef void (*FusedKernel)(Matrix<DTYPE>&, const FusedOp&, const int*, int, ll, ll, ll, ll);
+
+static const FusedKernel DENSE_KERNELS[FUSED_MAX_QUBITS + 1] = {
+    nullptr, denseKernel<1>, denseKernel<2>, denseKernel<3>, denseKernel<4>, denseKernel<5>
+};
+
+static const FusedKernel DIAGONAL_KERNELS[FUSED_MAX_QUBITS + 1] = {
+    diagonalKernel<0>, diagonalKernel<1>, diagonalKernel<2>, diagonalKernel<3>, diagonalKernel<4>, diagonalKernel<5>
+};
+
+// Apply ops [0, nops) in place, repeating the loop bodies
+static void runFused(Matrix<DTYPE>& mat, const FusedOp* ops, ll nops, ll cbegin, ll cend, int numThreads) {
+    for (ll p = 0; p < nops; ) {
+        const FusedOp& op = ops[p];
+        if (op.kind == FUSED_LOOP) {
+            for (ll r = 0; r < op.count; ++ r) {
+                runFused(mat, ops + p + 1, op.len, cbegin, cend, numThreads);
+            }
+            p += 1 + op.len;
+            continue;
+        }
+        int fixed[64], numFixed = 0;
+        ll tmask = 0;
+        for (int q : op.targets) {
+            tmask |= 1LL << q;
+        }
+        for (int q = 0; q < 64; ++ q) {
+            if (((tmask | op.cmask) >> q) & 1) {
+                fixed[numFixed ++] = q;
+            }
+        }
+        FusedKernel kernel = (op.kind == FUSED_DENSE ? DENSE_KERNELS : DIAGONAL_KERNELS)[op.targets.size()];
+        ll numBases = mat.row >> numFixed;
+        if (numThreads == 1 || numBases < FUSED_PARALLEL_BASES) {
+            kernel(mat, op, fixed, numFixed, 0, numBases, cbegin, cend);
+        } else {
+            parallelFor(0, numBases, numThreads, [&](ll kbegin, ll kend) {
+                kernel(mat, op, fixed, numFixed, kbegin, kend, cbegin, cend);
+            });
+        }
+        ++ p;
+    }
+}
+
+/**
+ * @brief Apply fused ops in place to the columns [cbegin, cend) of mat
+ *
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param ops the fused ops
+ * @param cbegin the first column
+ * @param cend one past the last column
+ * @param numThreads the threads splitting the rows of each op, 0 means all hardware threads
+ */
+void applyFused(Matrix<DTYPE>& mat, const vector<FusedOp>& ops, ll cbegin, ll cend, int numThreads) {
+    runFused(mat, ops.data(), ops.size(), cbegin, cend, numThreads);
+}
+
+/**
+ * @brief Conduct state vector simulation with fused k-qubit kernels
+ *
+ * @param sv the state vector, mat.row = 2^numQubits
+ * @param qc the quantum circuit
+ * @param maxQubits the max qubits of a fused block, 1 to FUSED_MAX_QUBITS, a wider gate forms a block of its own
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param stats optional fusion statistics
+ */
+void SVSimFused(Matrix<DTYPE>& sv, QCircuit& qc, int maxQubits, int numThreads, FusionStats* stats) {
+    if (sv.row != (1LL << qc.numQubits)) {
+        cout << "[ERROR] SVSimFused: sv.row != 2^numQubits. " << endl;
+        exit(1);
+    }
+    vector<FusedOp> ops = fuseCircuit(qc, maxQubits, stats);
+    applyFused(sv, ops, 0, sv.col, numThreads);
+}
+
+void FusionStats::print() {
+    cout << "[INFO] [Fusion] gates: [" << numGates << "] ops: [" << numOps << "] dense: [" << numDense << "] diagonal: [" << numDiagonal
+         << "] controlled: [" << numControlled << "] dropped: [" << numDropped << "] by qubits:";
+    for (int k = 0; k <= FUSED_MAX_QUBITS; ++ k) {
+        cout << " " << k << ": [" << opsByQubits[k] << "]";
+    }
+    cout << endl;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "kernel.h"
+
+//
+// Gate fusion and fused k-qubit kernels
+//
+// fuseCircuit groups neighbouring gates into blocks of at most maxQubits
+// qubits. It keeps a set of open blocks on disjoint qubits. A gate joins the
+// blocks on its qubits if their union still fits, otherwise those blocks are
+// closed and the gate opens a new one. Gates in different open blocks act on
+// different qubits and commute, so the order of the circuit is preserved.
+//
+// A closed block becomes one op: its 2^k * 2^k matrix is the product of its
+// gates. Qubits on which the matrix is the identity unless the qubit is 1 are
+// stripped as controls, e.g., the control of CX, and both qubits of CZ. Diagonal
+// matrices keep only the diagonal, and identities are dropped. The kernels are
+// templates on k = 1..5, so the index offsets and the matrix are compile-time
+// sized locals, and each op reads and writes the state once instead of once per
+// gate. Repeated blocks are fused separately and kept as loops.
+//
+
+enum FusedKind {
+    FUSED_DENSE, // a dense 2^k * 2^k matrix
+    FUSED_DIAGONAL, // a diagonal matrix, k = 0 for a phase on the control subspace
+    FUSED_LOOP // the head of a repeated block, the body follows
+};
+
+#define FUSED_MAX_QUBITS 5
+
+struct FusedOp {
+    FusedKind kind;
+    vector<int> targets; // ascending, local bit b of the matrix is qubit targets[b]
+    ll cmask; // the mask of the stripped control qubits, the op only acts where they are all 1
+    vector<DTYPE> mat; // row-major 2^k * 2^k entries, or the 2^k diagonal
+    int numGates; // the gates fused into the op
+    ll count; // the repetitions of a loop
+    ll len; // the number of ops in the loop body, which follows the head
+};
+
+struct FusionStats {
+    ll numGates; // the input gates, repeated blocks counted once
+    ll numOps; // the fused ops, loop heads excluded
+    ll numDense;
+    ll numDiagonal;
+    ll numControlled; // ops with stripped control qubits
+    ll numDropped; // blocks equal to the identity
+    ll opsByQubits[FUSED_MAX_QUBITS + 1]; // the ops acting on k target qubits
+
+    void print();
+};
+
+/**
+ * @brief Fuse the gates of a quantum circuit into blocks of at most maxQubits qubits
+ *
+ * @param qc the quantum circuit
+ * @param maxQubits the max qubits of a block, 1 to FUSED_MAX_QUBITS, a wider gate forms a block of its own
+ * @param stats optional fusion statistics
+ * @return vector<FusedOp> the fused ops, in circuit order
+ */
+vector<FusedOp> fuseCircuit(QCircuit& qc, int maxQubits = FUSED_MAX_QUBITS, FusionStats* stats = nullptr);
+
+/**
+ * @brief Apply fused ops in place to the columns [cbegin, cend) of mat
+ *
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param ops the fused ops
+ * @param cbegin the first column
+ * @param cend one past the last column
+ * @param numThreads the threads splitting the rows of each op, 0 means all hardware threads
+ */
+void applyFused(Matrix<DTYPE>& mat, const vector<FusedOp>& ops, ll cbegin, ll cend, int numThreads = 1);
+
+/**
+ * @brief Conduct state vector simulation with fused k-qubit kernels
+ *
+ * @param sv the state vector, mat.row = 2^numQubits
+ * @param qc the quantum circuit
+ * @param maxQubits the max qubits of a fused block, 1 to FUSED_MAX_QUBITS, a wider gate forms a block of its own
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param stats optional fusion statistics
+ */
+void SVSimFused(Matrix<DTYPE>& sv, QCircuit& qc, int maxQubits = FUSED_MAX_QUBITS, int numThreads = 0, FusionStats* stats = nullptr);
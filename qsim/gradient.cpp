@@ -0,0 +1,149 @@
+#include "gradient.h"
+
+#define PARALLEL_MIN_ROWS (1LL << 14) // smaller state vectors are swept by the calling thread
+
+/**
+ * @brief Apply a gate to a state vector, splitting the amplitude pairs across threads
+ *
+ * @param sv the state vector
+ * @param gate the processing gate
+ * @param numThreads the number of threads
+ */
+static void applyGateParallel(Matrix<DTYPE>& sv, QGate& gate, int numThreads) {
+    if (sv.row < PARALLEL_MIN_ROWS) {
+        applyGate(sv, gate, 0, 1);
+        return;
+    }
+    // every pair is owned by one row, so even-bounded row ranges never race
+    parallelFor(0, sv.row / 2, numThreads, [&](ll begin, ll end) {
+        applyGateRows(sv, gate, 2 * begin, 2 * end, 0, 1);
+    });
+}
+
+/**
+ * @brief Compute <lambda| P_q |psi> for the generator P of a rotation gate
+ *
+ * (X psi)[j] = psi[j ^ b], (Y psi)[j] = -i psi[j ^ b] if bit q of j is 0 and
+ * i psi[j ^ b] otherwise, and (Z psi)[j] = +-psi[j], where b = 2^q.
+ *
+ * @param lambda the adjoint state
+ * @param psi the state
+ * @param gname RX, RY or RZ
+ * @param qid the target qubit
+ * @param numThreads the number of threads
+ * @return DTYPE the inner product
+ */
+static DTYPE generatorOverlap(Matrix<DTYPE>& lambda, Matrix<DTYPE>& psi, const string& gname, int qid, int numThreads) {
+    ll b = 1LL << qid;
+    char p = gname[1];
+    vector<ll> bounds = tileBounds(0, psi.row, psi.row < PARALLEL_MIN_ROWS ? 1 : numThreads);
+    vector<DTYPE> partial(bounds.size() - 1, 0);
+    parallelForTiles(bounds, [&](int w, ll begin, ll end) {
+        DTYPE acc = 0;
+        for (ll j = begin; j < end; ++ j) {
+            DTYPE l = conj(lambda.data[j][0]);
+            if (p == 'X') {
+                acc += l * psi.data[j ^ b][0];
+            } else if (p == 'Y') {
+                acc += (j & b) ? l * DTYPE(0, 1) * psi.data[j ^ b][0] : l * DTYPE(0, -1) * psi.data[j ^ b][0];
+            } else {
+                acc += (j & b) ? -l * psi.data[j][0] : l * psi.data[j][0];
+            }
+        }
+        partial[w] = acc;
+    });
+    DTYPE total = 0;
+    for (auto& v : partial) {
+        total += v;
+    }
+    return total;
+}
+
+/**
+ * @brief Compute d<H>/d theta for every rotation gate with the adjoint method
+ *
+ * @param qc a quantum circuit
+ * @param sv the input state vector, not modified
+ * @param obs the observable H
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return GradientResult <H> and the gradients
+ */
+GradientResult adjointGradient(QCircuit& qc, Matrix<DTYPE>& sv, Observable& obs, int numThreads) {
+    if (sv.row != (1LL << qc.numQubits) || sv.col != 1) {
+        cout << "[ERROR] adjointGradient: sv is not a 2^numQubits * 1 column. " << endl;
+        exit(1);
+    }
+    if (obs.numQubits != qc.numQubits) {
+        cout << "[ERROR] adjointGradient: obs.numQubits != qc.numQubits. " << endl;
+        exit(1);
+    }
+
+    // the gate sequence of the unrolled circuit and the inverse of each distinct gate matrix
+    QCircuit flat = qc.unrolled();
+    vector<QGate> gates;
+    vector<int> levels;
+    map<Matrix<DTYPE>*, shared_ptr<Matrix<DTYPE>>> inverses;
+    for (int j = 0; j < flat.numDepths; ++ j) {
+        for (auto& gate : flat.gates[j]) {
+            if (gate.isIDE() || gate.isMARK()) {
+                continue;
+            }
+            gates.push_back(gate);
+            levels.push_back(j);
+            Matrix<DTYPE>* m = gate.gmat.get();
+            if (inverses.count(m) == 0) {
+                auto inv = make_shared<Matrix<DTYPE>>(m->row, m->col);
+                for (ll r = 0; r < m->row; ++ r) {
+                    for (ll c = 0; c < m->col; ++ c) {
+                        inv->data[c][r] = conj(m->data[r][c]); // G is unitary, G^-1 = G^dagger
+                    }
+                }
+                inverses[m] = inv;
+            }
+        }
+    }
+
+    // forward pass
+    Matrix<DTYPE> psi = sv;
+    for (auto& gate : gates) {
+        applyGateParallel(psi, gate, numThreads);
+    }
+    Matrix<DTYPE> lambda = obs.apply(psi, numThreads);
+
+    GradientResult res;
+    DTYPE e = 0;
+    for (ll j = 0; j < psi.row; ++ j) {
+        e += conj(psi.data[j][0]) * lambda.data[j][0];
+    }
+    res.expectation = e.real();
+
+    // backward sweep: psi = G_(i+1..P)^dagger U |sv>, lambda = G_(i+1..P)^dagger H U |sv>
+    for (ll i = (ll)gates.size() - 1; i >= 0; -- i) {
+        QGate& gate = gates[i];
+        bool rotation = gate.gname == "RX" || gate.gname == "RY" || gate.gname == "RZ";
+        if (rotation) {
+            ParamGradient pg;
+            pg.level = levels[i];
+            pg.qubit = gate.targetQubits[0];
+            pg.gname = gate.gname;
+            pg.grad = generatorOverlap(lambda, psi, gate.gname, pg.qubit, numThreads).imag();
+            res.params.push_back(pg);
+        }
+        if (i == 0) {
+            break; // the first gate need not be un-applied
+        }
+        QGate inv = gate;
+        inv.gmat = inverses[gate.gmat.get()];
+        applyGateParallel(psi, inv, numThreads);
+        applyGateParallel(lambda, inv, numThreads);
+    }
+    reverse(res.params.begin(), res.params.end());
+    return res;
+}
+
+void GradientResult::print() {
+    cout << "[INFO] [Gradient] expectation: [" << expectation << "] numParams: [" << params.size() << "]" << endl;
+    for (auto& pg : params) {
+        cout << pg.gname << " (level " << pg.level << ", q" << pg.qubit << "): " << pg.grad << endl;
+    }
+}
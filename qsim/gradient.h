@@ -0,0 +1,41 @@
+#pragma once
+
+#include "kernel.h"
+#include "observable.h"
+#include "parallel.h"
+
+// The derivative of <H> with respect to the angle of one RX, RY or RZ gate
+struct ParamGradient {
+    int level; // the level of the gate in qc.unrolled()
+    int qubit; // the target qubit of the gate
+    string gname; // RX, RY or RZ
+    double grad; // d<H>/d theta
+};
+
+struct GradientResult {
+    double expectation; // <H> at the current parameters
+    vector<ParamGradient> params; // the rotation gates in level order, then in qubit order
+
+    void print();
+};
+
+/**
+ * @brief Compute d<H>/d theta for every rotation gate with the adjoint method
+ *
+ * One forward pass gives |psi> = U |sv> and |lambda> = H |psi>. The backward sweep
+ * un-applies the gates G_P, ..., G_1 from both vectors with their inverses.
+ * For a rotation G = exp(-i theta P / 2), where P is X, Y or Z, dG/d theta = -i/2 P G,
+ * so d<H>/d theta = Im <lambda| P |psi> is taken before G is un-applied. The Pauli
+ * P is applied analytically inside the inner product. Only two state vectors
+ * are held, and the total cost is about three simulations for any number of gates.
+ *
+ * Repeated blocks are unrolled, so a gate inside a repeated block yields one
+ * gradient per repetition.
+ *
+ * @param qc a quantum circuit
+ * @param sv the input state vector, not modified
+ * @param obs the observable H
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return GradientResult <H> and the gradients
+ */
+GradientResult adjointGradient(QCircuit& qc, Matrix<DTYPE>& sv, Observable& obs, int numThreads = 0);
@@ -0,0 +1,193 @@
+#include "kernel.h"
+
+/**
+ * @brief Apply a 2x2 matrix to the amplitude pairs owned by the rows [rbegin, rend)
+ * 
+ * Pair (i, i|2^targ) is owned by row i, which is the k-th row with bit targ = 0 
+ * for k in [rbegin/2, rend/2). 
+ */
+static void apply2x2Rows(Matrix<DTYPE>& mat, Matrix<DTYPE>& u, int targ, ll cmask, ll rbegin, ll rend, ll cbegin, ll cend) {
+    DTYPE u00 = u.data[0][0], u01 = u.data[0][1];
+    DTYPE u10 = u.data[1][0], u11 = u.data[1][1];
+    ll tmask = 1LL << targ;
+
+    for (ll k = rbegin >> 1; k < (rend >> 1); ++ k) {
+        ll i0 = insertZeroBit(k, targ);
+        if ((i0 & cmask) != cmask) {
+            continue;
+        }
+        DTYPE* r0 = mat.data[i0];
+        DTYPE* r1 = mat.data[i0 | tmask];
+        for (ll c = cbegin; c < cend; ++ c) {
+            DTYPE a = r0[c];
+            DTYPE b = r1[c];
+            r0[c] = u00 * a + u01 * b;
+            r1[c] = u10 * a + u11 * b;
+        }
+    }
+}
+
+/**
+ * @brief Apply a 2x2 matrix to the amplitude pairs (i, i|2^targ), where all bits in cmask are 1
+ * 
+ * @param mat the state vector(s)
+ * @param u the 2x2 matrix
+ * @param targ the target qubit
+ * @param cmask the mask of control qubits, 0 for an uncontrolled gate
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void apply2x2(Matrix<DTYPE>& mat, Matrix<DTYPE>& u, int targ, ll cmask, ll cbegin, ll cend) {
+    apply2x2Rows(mat, u, targ, cmask, 0, mat.row, cbegin, cend);
+}
+
+/**
+ * @brief Apply a gate in place to the columns [cbegin, cend) of mat
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param gate the processing gate
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyGate(Matrix<DTYPE>& mat, QGate& gate, ll cbegin, ll cend) {
+    applyGateRows(mat, gate, 0, mat.row, cbegin, cend);
+}
+
+/**
+ * @brief Apply a gate in place to the amplitude pairs owned by the rows [rbegin, rend)
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param gate the processing gate
+ * @param rbegin the first row, even
+ * @param rend one past the last row, even
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyGateRows(Matrix<DTYPE>& mat, QGate& gate, ll rbegin, ll rend, ll cbegin, ll cend) {
+    if (gate.isIDE() || gate.isMARK()) {
+        return;
+    }
+    if (gate.isSingle()) {
+        apply2x2Rows(mat, *gate.gmat, gate.targetQubits[0], 0, rbegin, rend, cbegin, cend);
+        return;
+    }
+    if (gate.is2QubitControlled()) {
+        apply2x2Rows(mat, *gate.gmat, gate.targetQubits[0], 1LL << gate.controlQubits[0], rbegin, rend, cbegin, cend);
+        return;
+    }
+    if (gate.gname == "SWAP") {
+        ll mask0 = 1LL << gate.targetQubits[0];
+        ll mask1 = 1LL << gate.targetQubits[1];
+        for (ll i = rbegin; i < rend; ++ i) {
+            if ((i & mask0) == mask0 && (i & mask1) == 0) {
+                // i   := |0..1>
+                // row := |1..0>
+                DTYPE* r0 = mat.data[i];
+                DTYPE* r1 = mat.data[i ^ mask0 ^ mask1];
+                for (ll c = cbegin; c < cend; ++ c) {
+                    std::swap(r0[c], r1[c]);
+                }
+            }
+        }
+        return;
+    }
+    cout << "[ERROR] applyGate: " << gate.gname << " not implemented" << endl;
+    exit(1);
+}
+
+/**
+ * @brief Apply all gates of a level in place to the columns [cbegin, cend) of mat
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param level the processing level
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyLevel(Matrix<DTYPE>& mat, vector<QGate>& level, ll cbegin, ll cend) {
+    // gates in the same level act on disjoint qubits, so the order does not matter
+    for (auto& gate : level) {
+        applyGate(mat, gate, cbegin, cend);
+    }
+}
+
+/**
+ * @brief Apply a dense 2^n * 2^n matrix in place to the columns [cbegin, cend) of mat
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param opmat the operation matrix
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyDense(Matrix<DTYPE>& mat, Matrix<DTYPE>& opmat, ll cbegin, ll cend) {
+    if (opmat.row != mat.row || opmat.col != mat.row) {
+        cout << "[ERROR] applyDense: opmat is not " << mat.row << " * " << mat.row << ". " << endl;
+        exit(1);
+    }
+    // gather a block of columns into a row-major buffer, so that opmat is read row by row
+    const ll B = 8;
+    vector<DTYPE> in(mat.row * B);
+    for (ll c0 = cbegin; c0 < cend; c0 += B) {
+        ll nb = min(B, cend - c0);
+        for (ll k = 0; k < mat.row; ++ k) {
+            for (ll b = 0; b < nb; ++ b) {
+                in[k * B + b] = mat.data[k][c0 + b];
+            }
+        }
+        for (ll i = 0; i < mat.row; ++ i) {
+            DTYPE acc[B] = {};
+            for (ll k = 0; k < mat.row; ++ k) {
+                DTYPE o = opmat.data[i][k];
+                const DTYPE* x = &in[k * B];
+                for (ll b = 0; b < nb; ++ b) {
+                    acc[b] += o * x[b];
+                }
+            }
+            for (ll b = 0; b < nb; ++ b) {
+                mat.data[i][c0 + b] = acc[b];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Apply all levels of a quantum circuit in place to the columns [cbegin, cend) of mat
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param qc a quantum circuit
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyCircuit(Matrix<DTYPE>& mat, QCircuit& qc, ll cbegin, ll cend) {
+    applyLevels(mat, qc, 0, qc.numDepths, cbegin, cend);
+}
+
+/**
+ * @brief Apply the levels [lbegin, lend) of a quantum circuit in place to the columns [cbegin, cend) of mat
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param qc a quantum circuit
+ * @param lbegin the first level
+ * @param lend one past the last level
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyLevels(Matrix<DTYPE>& mat, QCircuit& qc, int lbegin, int lend, ll cbegin, ll cend) {
+    if (mat.row != (1LL << qc.numQubits)) {
+        cout << "[ERROR] applyLevels: mat.row != 2^numQubits. " << endl;
+        exit(1);
+    }
+    for (int j = lbegin; j < lend; ++ j) {
+        if (qc.isRepeat(j)) {
+            QRepeat& rep = qc.repeats[j];
+            if (rep.powmat != nullptr) {
+                applyDense(mat, *rep.powmat, cbegin, cend);
+            } else {
+                for (ll r = 0; r < rep.count; ++ r) {
+                    applyCircuit(mat, *rep.body, cbegin, cend);
+                }
+            }
+            continue;
+        }
+        applyLevel(mat, qc.gates[j], cbegin, cend);
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "qcircuit.h"
+
+//
+// In-place gate kernels
+//
+// Each column of mat is treated as an independent state vector, so the same
+// kernels update a single state vector (mat.col == 1) or a batch of columns,
+// e.g., all 2^n basis vectors of an operation matrix.
+//
+
+/**
+ * @brief Apply a 2x2 matrix to the amplitude pairs (i, i|2^targ), where all bits in cmask are 1
+ * 
+ * The matrix need not be unitary, e.g., a Kraus operator. 
+ * 
+ * @param mat the state vector(s)
+ * @param u the 2x2 matrix
+ * @param targ the target qubit
+ * @param cmask the mask of control qubits, 0 for an uncontrolled gate
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void apply2x2(Matrix<DTYPE>& mat, Matrix<DTYPE>& u, int targ, ll cmask, ll cbegin, ll cend);
+
+/**
+ * @brief Apply a gate in place to the columns [cbegin, cend) of mat
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param gate the processing gate
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyGate(Matrix<DTYPE>& mat, QGate& gate, ll cbegin, ll cend);
+
+/**
+ * @brief Apply a gate in place to the amplitude pairs owned by the rows [rbegin, rend)
+ * 
+ * An amplitude pair (or SWAP pair) is owned by exactly one of its rows, so any 
+ * partition of [0, mat.row) into even-bounded ranges applies the gate exactly 
+ * once and can be processed in parallel. If [rbegin, rend) is aligned to 
+ * 2^(q+1) for every qubit q of the gate, only rows in the range are touched. 
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param gate the processing gate
+ * @param rbegin the first row, even
+ * @param rend one past the last row, even
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyGateRows(Matrix<DTYPE>& mat, QGate& gate, ll rbegin, ll rend, ll cbegin, ll cend);
+
+/**
+ * @brief Apply all gates of a level in place to the columns [cbegin, cend) of mat
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param level the processing level
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyLevel(Matrix<DTYPE>& mat, vector<QGate>& level, ll cbegin, ll cend);
+
+/**
+ * @brief Apply a dense 2^n * 2^n matrix in place to the columns [cbegin, cend) of mat
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param opmat the operation matrix
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyDense(Matrix<DTYPE>& mat, Matrix<DTYPE>& opmat, ll cbegin, ll cend);
+
+/**
+ * @brief Apply all levels of a quantum circuit in place to the columns [cbegin, cend) of mat
+ * 
+ * A repeated block is applied with its cached QRepeat::powmat if present, 
+ * otherwise its body is applied count times. 
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param qc a quantum circuit
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyCircuit(Matrix<DTYPE>& mat, QCircuit& qc, ll cbegin, ll cend);
+
+/**
+ * @brief Apply the levels [lbegin, lend) of a quantum circuit in place to the columns [cbegin, cend) of mat
+ * 
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param qc a quantum circuit
+ * @param lbegin the first level
+ * @param lend one past the last level
+ * @param cbegin the first column
+ * @param cend one past the last column
+ */
+void applyLevels(Matrix<DTYPE>& mat, QCircuit& qc, int lbegin, int lend, ll cbegin, ll cend);
+
+//
+// Utility functions
+//
+
+/**
+ * @brief Insert a zero bit at position qid of k
+ * 
+ * @param k the compressed index
+ * @param qid the bit position
+ * @return ll the index with bit qid = 0
+ */
+inline ll insertZeroBit(ll k, int qid) {
+    ll low = k & ((1LL << qid) - 1);
+    return ((k >> qid) << (qid + 1)) | low;
+}
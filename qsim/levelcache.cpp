@@ -0,0 +1,148 @@
+#include "levelcache.h"
+
+/**
+ * @brief Construct a new LevelCache object
+ * 
+ * @param capacity_ the memory cap in bytes
+ */
+LevelCache::LevelCache(ll capacity_) {
+    capacity = capacity_;
+    bytesHeld = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+/**
+ * @brief Return the cached operator of a level, or nullptr if it is not cached
+ * 
+ * @param level the processing level
+ * @return shared_ptr<Matrix<DTYPE>> the level operator
+ */
+shared_ptr<Matrix<DTYPE>> LevelCache::get(vector<QGate>& level) {
+    string sig = levelSignature(level);
+    lock_guard<mutex> lock(mtx);
+    auto it = index.find(sig);
+    if (it == index.end()) {
+        misses ++;
+        return nullptr;
+    }
+    hits ++;
+    lru.splice(lru.begin(), lru, it->second); // move to the front
+    return it->second->second;
+}
+
+/**
+ * @brief Insert the operator of a level, evicting the least recently used operators if needed
+ * 
+ * @param level the processing level
+ * @param mat the level operator
+ */
+void LevelCache::put(vector<QGate>& level, shared_ptr<Matrix<DTYPE>> mat) {
+    ll bytes = matrixBytes(*mat);
+    if (bytes > capacity) {
+        return; // never fits
+    }
+    string sig = levelSignature(level);
+    lock_guard<mutex> lock(mtx);
+    auto it = index.find(sig);
+    if (it != index.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        return;
+    }
+    lru.push_front(Entry(sig, mat));
+    index[sig] = lru.begin();
+    bytesHeld += bytes;
+    evict();
+}
+
+/**
+ * @brief Evict the least recently used entries until bytesHeld <= capacity
+ */
+void LevelCache::evict() {
+    while (bytesHeld > capacity && ! lru.empty()) {
+        bytesHeld -= matrixBytes(*lru.back().second);
+        index.erase(lru.back().first);
+        lru.pop_back();
+        evictions ++;
+    }
+}
+
+/**
+ * @brief Drop all entries and reset the stats
+ */
+void LevelCache::clear() {
+    lock_guard<mutex> lock(mtx);
+    lru.clear();
+    index.clear();
+    bytesHeld = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+// Return the number of cached operators
+ll LevelCache::size() {
+    lock_guard<mutex> lock(mtx);
+    return lru.size();
+}
+
+// Return hits / (hits + misses)
+double LevelCache::hitRate() {
+    lock_guard<mutex> lock(mtx);
+    return hits + misses == 0 ? 0.0 : (double)hits / (hits + misses);
+}
+
+// Print the cache statistics
+void LevelCache::printStats() {
+    double rate = hitRate();
+    lock_guard<mutex> lock(mtx);
+    cout << "[INFO] [LevelCache] entries: [" << lru.size() << "] hits: [" << hits << "] misses: [" << misses 
+         << "] hit rate: [" << fixed << setprecision(2) << rate * 100 << "%] evictions: [" << evictions 
+         << "] bytes held: [" << bytesHeld << " / " << capacity << "]" << endl;
+}
+
+//
+// Utility functions
+//
+
+/**
+ * @brief Get the content signature of a level
+ * 
+ * @param level the processing level
+ * @return string the signature, equal for identical levels
+ */
+string levelSignature(vector<QGate>& level) {
+    string sig = to_string(level.size()) + '#'; // levels of different widths never match
+    for (auto& gate : level) {
+        if (gate.isIDE() || gate.isMARK()) {
+            continue;
+        }
+        sig += gate.gname;
+        sig += '|';
+        for (int q : gate.controlQubits) {
+            sig += to_string(q) + ',';
+        }
+        sig += '|';
+        for (int q : gate.targetQubits) {
+            sig += to_string(q) + ',';
+        }
+        sig += '|';
+        // the raw entries distinguish parameterized gates, e.g., RX(0.1) and RX(0.2)
+        for (ll i = 0; i < gate.gmat->row; ++ i) {
+            sig.append((const char*)gate.gmat->data[i], gate.gmat->col * sizeof(DTYPE));
+        }
+        sig += ';';
+    }
+    return sig;
+}
+
+/**
+ * @brief Get the number of bytes held by a matrix
+ * 
+ * @param mat the matrix
+ * @return ll the bytes of the elements and the row pointers
+ */
+ll matrixBytes(const Matrix<DTYPE>& mat) {
+    return mat.row * mat.col * sizeof(DTYPE) + mat.row * sizeof(DTYPE*);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "qcircuit.h"
+
+/**
+ * @brief An LRU cache of level operators keyed by the level signature
+ * 
+ * Two levels have the same signature iff they hold the same gates (names, 
+ * control and target qubits, and gate matrix entries) on the same qubits. 
+ * The cache is bounded by capacity bytes and is safe to share between threads. 
+ */
+class LevelCache {
+private:
+    typedef pair<string, shared_ptr<Matrix<DTYPE>>> Entry;
+    list<Entry> lru; // the most recently used entry is at the front
+    unordered_map<string, list<Entry>::iterator> index;
+    mutex mtx;
+
+    void evict(); // Evict the least recently used entries until bytesHeld <= capacity
+public:
+    ll capacity; // the memory cap in bytes
+    ll bytesHeld; // the bytes held by the cached matrices
+    ll hits;
+    ll misses;
+    ll evictions;
+
+    LevelCache(ll capacity_ = 1LL << 30);
+
+    shared_ptr<Matrix<DTYPE>> get(vector<QGate>& level); // Return the cached operator or nullptr
+    void put(vector<QGate>& level, shared_ptr<Matrix<DTYPE>> mat); // Insert a level operator
+    void clear(); // Drop all entries and reset the stats
+
+    ll size(); // the number of cached operators
+    double hitRate(); // hits / (hits + misses)
+    void printStats();
+};
+
+//
+// Utility functions
+//
+
+/**
+ * @brief Get the content signature of a level
+ * 
+ * @param level the processing level
+ * @return string the signature, equal for identical levels
+ */
+string levelSignature(vector<QGate>& level);
+
+/**
+ * @brief Get the number of bytes held by a matrix
+ * 
+ * @param mat the matrix
+ * @return ll the bytes of the elements and the row pointers
+ */
+ll matrixBytes(const Matrix<DTYPE>& mat);
@@ -1,4 +1,5 @@
 #include "matrix.h"
+#include "memory.h"
 
 //
 // Constructors of Matrix
@@ -15,41 +16,19 @@ Matrix<T>::Matrix() {
 // Initialize a all-zero matrix
 template<typename T>
 Matrix<T>::Matrix(ll r, ll c) { 
-    row = r;
-    col = c;
-    data = new T *[row];
-    for (ll i = 0; i < row; i++) {
-        data[i] = new T[col];
-        for (ll j = 0; j < col; j++) {
-            data[i][j] = 0;
-        }
-    }
+    allocate(r, c);
 }
 
 // Initialize a matrix with a given 2D array
 template<typename T>
 Matrix<T>::Matrix(ll r, ll c, T **temp) {
-    row = r;
-    col = c;
-    data = new T *[row];
-    for (ll i = 0; i < row; i++) {
-        data[i] = new T[col];
-        for (ll j = 0; j < col; j++) {
-            data[i][j] = *((T *) temp + i * col + j);
-        }
-    }
+    allocate(r, c, (const T*)temp);
 }
 
 // Copy constructor
 template<typename T>
 Matrix<T>::Matrix(const Matrix<T> &matrx) {
-    row = matrx.row;
-    col = matrx.col;
-    data = new T *[row];
-    for (ll i = 0; i < row; i++) {
-        data[i] = new T[col];
-        memcpy(data[i], matrx.data[i], col * sizeof(T));
-    }
+    allocate(matrx.row, matrx.col, matrx.row > 0 ? matrx.data[0] : nullptr);
 }
 
 // Move constructor
@@ -67,13 +46,23 @@ Matrix<T>::Matrix(Matrix<T> &&matrx) {
 // Operations
 //
 
+// Allocate the row pointers and one contiguous block of r * c entries, zeroed or copied from src
+template<typename T>
+void Matrix<T>::allocate(ll r, ll c, const T* src) {
+    row = r;
+    col = c;
+    data = (T**)allocBlock(row, sizeof(T*));
+    T* block = (T*)allocBlock(row, col * sizeof(T), src);
+    for (ll i = 0; i < row; i++) {
+        data[i] = block + i * col;
+    }
+}
+
 template<typename T>
 void Matrix<T>::clear() {
     if (data != nullptr) {
-        for (ll i = 0; i < row; i++) {
-            delete[] data[i];
-        }
-        delete[] data;
+        freeBlock(data[0]);
+        freeBlock(data);
         data = nullptr;
     }
     row = 0;
@@ -85,13 +74,7 @@ template<typename T>
 Matrix<T>& Matrix<T>::operator=(const Matrix<T>& matrx) {
     if (this != &matrx) {
         clear();
-        row = matrx.row;
-        col = matrx.col;
-        data = new T*[row];
-        for (ll i = 0; i < row; i++) {
-            data[i] = new T[col];
-            memcpy(data[i], matrx.data[i], col * sizeof(T));
-        }
+        allocate(matrx.row, matrx.col, matrx.row > 0 ? matrx.data[0] : nullptr);
     }
     return *this;
 }
@@ -177,21 +160,44 @@ Matrix<T> Matrix<T>::tensorProduct(const Matrix<T>& matrx) const {
     return temp;
 }
 
+// Matrix power C = A^k by repeated squaring, O(log k) multiplications
+template<typename T>
+Matrix<T> Matrix<T>::power(ll k) const {
+    if (row != col) {
+        cout << "[ERROR] Matrix power: row != col. " << endl;
+        exit(1);
+    }
+    if (k < 0) {
+        cout << "[ERROR] Matrix power: k < 0. " << endl;
+        exit(1);
+    }
+    Matrix<T> result, base(*this);
+    result.identity(row);
+    bool first = true;
+    while (k > 0) {
+        if (k & 1) {
+            if (first) {
+                result = base; // skip the product with the identity
+                first = false;
+            } else {
+                result = base * result;
+            }
+        }
+        k >>= 1;
+        if (k > 0) {
+            base = base * base;
+        }
+    }
+    return result;
+}
+
 // Rotation X
 template<typename T>
 void Matrix<T>::rotationX(double theta) {
     T rx[2][2] = {{{cos(theta/2), 0}, {0, -sin(theta/2)}},
                   {{0, -sin(theta/2)}, {cos(theta/2), 0}}};
     clear();
-    row = 2;
-    col = 2;
-    data = new T*[2];
-    for (ll i = 0; i < 2; i++) {
-        data[i] = new T[2];
-        for (ll j = 0; j < 2; j++) {
-            data[i][j] = rx[i][j];
-        }
-    }
+    allocate(2, 2, (const T*)rx);
 }
 
 // Rotation Y
@@ -200,15 +206,7 @@ void Matrix<T>::rotationY(double theta) {
     T ry[2][2] = {{cos(theta/2), -sin(theta/2)},
                   {sin(theta/2), cos(theta/2)}};
     clear();
-    row = 2;
-    col = 2;
-    data = new T*[2];
-    for (ll i = 0; i < 2; i++) {
-        data[i] = new T[2];
-        for (ll j = 0; j < 2; j++) {
-            data[i][j] = ry[i][j];
-        }
-    }
+    allocate(2, 2, (const T*)ry);
 }
 
 // Rotation Z
@@ -217,29 +215,16 @@ void Matrix<T>::rotationZ(double theta) {
     T rz[2][2] = {{exp(-T(0, 1) * theta / 2.0), 0},
                   {0, exp(T(0, 1) * theta / 2.0)}};
     clear();
-    row = 2;
-    col = 2;
-    data = new T*[2];
-    for (ll i = 0; i < 2; i++) {
-        data[i] = new T[2];
-        for (ll j = 0; j < 2; j++) {
-            data[i][j] = rz[i][j];
-        }
-    }
+    allocate(2, 2, (const T*)rz);
 }
 
 // Set the matrix to be an identity matrix
 template<typename T>
 void Matrix<T>::identity(ll r) {
     clear();
-    row = r;
-    col = r;
-    data = new T*[row];
+    allocate(r, r);
     for (ll i = 0; i < row; i++) {
-        data[i] = new T[col];
-        for (ll j = 0; j < col; j++) {
-            data[i][j] = (i == j) ? 1 : 0;
-        }
+        data[i][i] = 1;
     }
 }
 
@@ -247,15 +232,7 @@ void Matrix<T>::identity(ll r) {
 template<typename T>
 void Matrix<T>::zero(ll r, ll c) {
     clear();
-    row = r;
-    col = c;
-    data = new T*[row];
-    for (ll i = 0; i < row; i++) {
-        data[i] = new T[col];
-        for (ll j = 0; j < col; j++) {
-            data[i][j] = 0;
-        }
-    }
+    allocate(r, c);
 }
 
 // Check if the matrix is a zero matrix
@@ -296,6 +273,7 @@ void Matrix<T>::print() const {
 // Print the matrix dictionary
 template<typename T>
 void Matrix<T>::printMatrixDict() {
+    lock_guard<mutex> lock(MatrixDictMutex);
     for (auto it = MatrixDict.begin(); it != MatrixDict.end(); ++ it) {
         cout << it->first << ": " << endl;
         it->second->print();
@@ -318,8 +296,12 @@ Matrix<T>::~Matrix() {
 template<typename T>
 map<string, shared_ptr<Matrix<T>>> Matrix<T>::MatrixDict; // A global matrix dictionary
 
+template<typename T>
+mutex Matrix<T>::MatrixDictMutex; // constant-initialized, so it is usable by static initializers in any order
+
 template<typename T>
 void Matrix<T>::initMatrixDict() {
+    lock_guard<mutex> lock(MatrixDictMutex);
     T mark[1][1] = {{1}}; // placeholder
     MatrixDict["MARK"] = make_shared<Matrix<T>>(1, 1, (T**)mark);
 
@@ -369,6 +351,43 @@ void Matrix<T>::initMatrixDict() {
     MatrixDict["CSWAP"] = MatrixDict["SWAP"];
 }
 
+/**
+ * @brief Look up a matrix in MatrixDict without inserting the key
+ * 
+ * @param key the matrix name
+ * @return shared_ptr<Matrix<T>> the matrix, nullptr if absent
+ */
+template<typename T>
+shared_ptr<Matrix<T>> Matrix<T>::findMatrix(const string& key) {
+    lock_guard<mutex> lock(MatrixDictMutex);
+    auto it = MatrixDict.find(key);
+    return it == MatrixDict.end() ? nullptr : it->second;
+}
+
+/**
+ * @brief Insert a matrix into MatrixDict unless the key already holds one
+ * 
+ * @param key the matrix name
+ * @param mat the matrix
+ * @return shared_ptr<Matrix<T>> the matrix stored under key
+ */
+template<typename T>
+shared_ptr<Matrix<T>> Matrix<T>::internMatrix(const string& key, shared_ptr<Matrix<T>> mat) {
+    lock_guard<mutex> lock(MatrixDictMutex);
+    shared_ptr<Matrix<T>>& slot = MatrixDict[key];
+    if (slot == nullptr) {
+        slot = mat;
+    }
+    return slot;
+}
+
+// Return a copy of MatrixDict, e.g., to iterate over it while other threads add gates
+template<typename T>
+map<string, shared_ptr<Matrix<T>>> Matrix<T>::snapshotMatrixDict() {
+    lock_guard<mutex> lock(MatrixDictMutex);
+    return MatrixDict;
+}
+
 template class Matrix<DTYPE>;
 
 // Create a static instance of StaticInitializer
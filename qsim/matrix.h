@@ -9,11 +9,13 @@ using namespace std;
 template <typename T>
 class Matrix {
 private:
+    void allocate(ll r, ll c, const T* src = nullptr); // Allocate one contiguous block of r * c entries, see memory.h
     void clear(); // Clear the matrix
 public:
     ll row, col;
     T** data;
     static map<string, shared_ptr<Matrix>> MatrixDict; // A global matrix dictionary
+    static mutex MatrixDictMutex; // Guards every access to MatrixDict
 
     //
     // Constructors
@@ -34,6 +36,7 @@ public:
     Matrix& operator+=(const Matrix& matrx); // Matrix addition
     Matrix operator*(const Matrix& matrx) const; // Matrix multiplication
     Matrix tensorProduct(const Matrix& matrx) const; // Tensor product
+    Matrix power(ll k) const; // Matrix power by repeated squaring
 
     void rotationX(double theta); // Rotation X gate matrix
     void rotationY(double theta); // Rotation Y gate matrix
@@ -50,6 +53,9 @@ public:
     void print() const; // Print a Matrix
     void printMatrixDict(); // Print the matrix dictionary
     static void initMatrixDict();
+    static shared_ptr<Matrix> findMatrix(const string& key); // Look up MatrixDict, nullptr if absent
+    static shared_ptr<Matrix> internMatrix(const string& key, shared_ptr<Matrix> mat); // Insert mat unless key exists, return the stored matrix
+    static map<string, shared_ptr<Matrix>> snapshotMatrixDict(); // A copy of MatrixDict
 
     //
     // Destructor
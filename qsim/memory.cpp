@@ -0,0 +1,357 @@
+#include "memory.h"
+#include "parallel.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define MEM_ALIGN 64 // the alignment of the blocks, one cache line
+#define MEM_HEADER 64 // the header before each block, keeps the block aligned
+#define MEM_HUGE_PAGE (1LL << 21) // the huge page size of x86-64 and arm64
+#define MEM_PLACEMENT_SAMPLES 1024 // the pages sampled per block by memoryStats
+#define MEM_MPOL_INTERLEAVE 3 // MPOL_INTERLEAVE of <numaif.h>, which needs libnuma
+
+enum BlockKind {
+    BLOCK_HEAP, // posix_memalign or _aligned_malloc
+    BLOCK_MAPPED, // anonymous mmap, maybe with transparent huge pages
+    BLOCK_HUGETLB // anonymous mmap from the hugetlbfs pool
+};
+
+// Stored in the MEM_HEADER bytes before each block
+struct BlockHeader {
+    void* base; // the start of the allocation
+    ll mapBytes; // the bytes mapped at base, 0 for heap blocks
+    ll bytes; // the bytes of the block
+    int kind;
+};
+
+static mutex PolicyMutex;
+static AllocPolicy Policy;
+static atomic<ll> LargeBytes(1LL << 22); // Policy.largeBytes, read without the lock by small allocations
+
+// The large blocks, guarded by RegionMutex
+static mutex RegionMutex;
+static map<void*, ll> Regions; // block -> bytes
+static MemoryStats Counters = {0, 0, 0, 0, 0, 0, 0, 0, -1, 1, {}};
+
+void setAllocPolicy(const AllocPolicy& policy) {
+    lock_guard<mutex> lock(PolicyMutex);
+    Policy = policy;
+    LargeBytes = policy.largeBytes;
+}
+
+AllocPolicy getAllocPolicy() {
+    lock_guard<mutex> lock(PolicyMutex);
+    return Policy;
+}
+
+/**
+ * @brief Get the number of online NUMA nodes, 1 without NUMA support
+ */
+int numaNodes() {
+    static int nodes = [] {
+        int maxNode = 0;
+#ifdef __linux__
+        ifstream in("/sys/devices/system/node/online");
+        string ranges;
+        if (in >> ranges) {
+            // e.g., "0-3,6"
+            stringstream ss(ranges);
+            string range;
+            while (getline(ss, range, ',')) {
+                size_t dash = range.find('-');
+                maxNode = max(maxNode, atoi(range.c_str() + (dash == string::npos ? 0 : dash + 1)));
+            }
+        }
+#endif
+        return maxNode + 1;
+    }();
+    return nodes;
+}
+
+// Zero or copy [0, rows) rows of the block on the tiles of the threaded kernels
+static void touchBlock(char* block, ll rows, ll rowBytes, const void* src, int numThreads) {
+    parallelForTiles(tileBounds(0, rows, numThreads), [&](int, ll tileBegin, ll tileEnd) {
+        char* dst = block + tileBegin * rowBytes;
+        ll bytes = (tileEnd - tileBegin) * rowBytes;
+        if (src == nullptr) {
+            memset(dst, 0, bytes);
+        } else {
+            memcpy(dst, (const char*)src + tileBegin * rowBytes, bytes);
+        }
+    });
+}
+
+#ifndef _WIN32
+// Map a large block with the policy, return the start of the mapping and set kind and mapBytes
+static char* mapBlock(ll bytes, const AllocPolicy& policy, int& kind, ll& mapBytes) {
+    ll total = bytes + MEM_HEADER;
+#ifdef MAP_HUGETLB
+    if (policy.hugePages == HUGEPAGES_EXPLICIT) {
+        mapBytes = (total + MEM_HUGE_PAGE - 1) / MEM_HUGE_PAGE * MEM_HUGE_PAGE;
+        void* mem = mmap(nullptr, mapBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED) {
+            kind = BLOCK_HUGETLB;
+            return (char*)mem;
+        }
+        ++ Counters.numFallback; // the pool is empty or hugetlbfs is unsupported
+    }
+#endif
+    // Over-map by a huge page and trim, so the block starts on a huge page boundary
+    ll padded = total + MEM_HUGE_PAGE;
+    void* mem = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return nullptr;
+    }
+    char* raw = (char*)mem;
+    char* base = (char*)(((uintptr_t)raw + MEM_HUGE_PAGE - 1) / MEM_HUGE_PAGE * MEM_HUGE_PAGE);
+    ll pageSize = sysconf(_SC_PAGESIZE);
+    mapBytes = (total + pageSize - 1) / pageSize * pageSize;
+    if (base > raw) {
+        munmap(raw, base - raw);
+    }
+    if (raw + padded > base + mapBytes) {
+        munmap(base + mapBytes, raw + padded - (base + mapBytes));
+    }
+    kind = BLOCK_MAPPED;
+#ifdef MADV_HUGEPAGE
+    if (policy.hugePages != HUGEPAGES_OFF && madvise(base, mapBytes, MADV_HUGEPAGE) == 0) {
+        ++ Counters.numTransparent;
+    }
+#endif
+    return base;
+}
+
+// Interleave the pages of a mapping over all NUMA nodes, before they are touched
+static bool interleaveBlock(char* base, ll mapBytes) {
+#if defined(__linux__) && defined(SYS_mbind)
+    int nodes = numaNodes();
+    if (nodes <= 1) {
+        return false;
+    }
+    vector<unsigned long> mask((nodes + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long)), 0);
+    for (int n = 0; n < nodes; ++ n) {
+        mask[n / (8 * sizeof(unsigned long))] |= 1UL << (n % (8 * sizeof(unsigned long)));
+    }
+    unsigned long maxNode = mask.size() * 8 * sizeof(unsigned long) + 1;
+    return syscall(SYS_mbind, base, mapBytes, MEM_MPOL_INTERLEAVE, mask.data(), maxNode, 0) == 0;
+#else
+    (void)base;
+    (void)mapBytes;
+    return false;
+#endif
+}
+#endif
+
+/**
+ * @brief Allocate a 64-byte aligned block of rows * rowBytes bytes
+ *
+ * @param rows the number of rows, the unit of the first-touch tiles
+ * @param rowBytes the bytes of each row
+ * @param src optional, rows * rowBytes bytes to copy into the block, nullptr to zero it
+ * @return void* the block, nullptr if it is empty
+ */
+void* allocBlock(ll rows, ll rowBytes, const void* src) {
+    ll bytes = rows * rowBytes;
+    if (bytes <= 0) {
+        return nullptr;
+    }
+    char* base = nullptr;
+    BlockHeader header = {nullptr, 0, bytes, BLOCK_HEAP};
+    AllocPolicy policy;
+    bool large = bytes >= LargeBytes;
+#ifndef _WIN32
+    if (large) {
+        policy = getAllocPolicy();
+        lock_guard<mutex> lock(RegionMutex);
+        base = mapBlock(bytes, policy, header.kind, header.mapBytes);
+        if (base != nullptr) {
+            ++ Counters.numLarge;
+            Counters.numExplicit += header.kind == BLOCK_HUGETLB;
+            if (policy.interleave && interleaveBlock(base, header.mapBytes)) {
+                ++ Counters.numInterleaved;
+            }
+        }
+    }
+#endif
+    if (base == nullptr) {
+        large = false;
+        header.kind = BLOCK_HEAP;
+#ifdef _WIN32
+        base = (char*)_aligned_malloc(bytes + MEM_HEADER, MEM_ALIGN);
+#else
+        void* mem = nullptr;
+        base = posix_memalign(&mem, MEM_ALIGN, bytes + MEM_HEADER) == 0 ? (char*)mem : nullptr;
+#endif
+    }
+    if (base == nullptr) {
+        cout << "[ERROR] allocBlock: cannot allocate " << bytes << " bytes. " << endl;
+        exit(1);
+    }
+    header.base = base;
+    char* block = base + MEM_HEADER;
+    memcpy(block - sizeof(BlockHeader), &header, sizeof(BlockHeader));
+
+    if (large && policy.firstTouch) {
+        touchBlock(block, rows, rowBytes, src, policy.numThreads);
+    } else if (src == nullptr) {
+        if (header.kind == BLOCK_HEAP) {
+            memset(block, 0, bytes); // mapped pages are already zero
+        }
+    } else {
+        memcpy(block, src, bytes);
+    }
+
+    if (large) {
+        lock_guard<mutex> lock(RegionMutex);
+        Regions[block] = bytes;
+        ++ Counters.liveBlocks;
+        Counters.liveBytes += bytes;
+        Counters.peakBytes = max(Counters.peakBytes, Counters.liveBytes);
+    }
+    return block;
+}
+
+/**
+ * @brief Free a block returned by allocBlock
+ *
+ * @param block the block, may be nullptr
+ */
+void freeBlock(void* block) {
+    if (block == nullptr) {
+        return;
+    }
+    BlockHeader header;
+    memcpy(&header, (char*)block - sizeof(BlockHeader), sizeof(BlockHeader));
+    if (header.kind == BLOCK_HEAP) {
+#ifdef _WIN32
+        _aligned_free(header.base);
+#else
+        free(header.base);
+#endif
+        return;
+    }
+#ifndef _WIN32
+    {
+        lock_guard<mutex> lock(RegionMutex);
+        Regions.erase(block);
+        -- Counters.liveBlocks;
+        Counters.liveBytes -= header.bytes;
+    }
+    munmap(header.base, header.mapBytes);
+#endif
+}
+
+#ifdef __linux__
+// Sum the huge page kB of the mappings in /proc/self/smaps that overlap the regions
+static ll hugeBytesOf(const vector<pair<uintptr_t, uintptr_t>>& regions) {
+    ifstream in("/proc/self/smaps");
+    if (! in) {
+        return -1;
+    }
+    ll kb = 0;
+    bool overlaps = false;
+    string line;
+    while (getline(in, line)) {
+        size_t dash = line.find('-'), space = line.find(' ');
+        if (dash != string::npos && dash < space && isxdigit(line[0])) {
+            // a mapping header, e.g., "7f12a4000000-7f12a8000000 rw-p 00000000 00:00 0"
+            uintptr_t start = stoull(line.substr(0, dash), nullptr, 16);
+            uintptr_t end = stoull(line.substr(dash + 1, space - dash - 1), nullptr, 16);
+            overlaps = false;
+            for (auto& r : regions) {
+                overlaps = overlaps || (start < r.second && r.first < end);
+            }
+        } else if (overlaps && (line.compare(0, 14, "AnonHugePages:") == 0 || line.compare(0, 16, "Private_Hugetlb:") == 0
+                                || line.compare(0, 15, "Shared_Hugetlb:") == 0)) {
+            kb += atoll(line.c_str() + line.find(':') + 1);
+        }
+    }
+    return kb * 1024;
+}
+
+// Estimate the bytes of a region on each node from the nodes of up to MEM_PLACEMENT_SAMPLES pages
+static bool addNodeBytes(uintptr_t start, ll bytes, vector<ll>& nodeBytes) {
+#ifdef SYS_move_pages
+    ll pageSize = sysconf(_SC_PAGESIZE);
+    ll numPages = (bytes + pageSize - 1) / pageSize;
+    ll stride = max(1LL, numPages / MEM_PLACEMENT_SAMPLES);
+    vector<void*> pages;
+    for (ll p = 0; p < numPages; p += stride) {
+        pages.push_back((void*)(start + p * pageSize));
+    }
+    vector<int> status(pages.size(), -1);
+    // nodes == nullptr only queries the node of each page
+    if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0) != 0) {
+        return false;
+    }
+    for (int s : status) {
+        if (s >= 0 && s < (int)nodeBytes.size()) {
+            nodeBytes[s] += stride * pageSize;
+        }
+    }
+    return true;
+#else
+    (void)start;
+    (void)bytes;
+    (void)nodeBytes;
+    return false;
+#endif
+}
+#endif
+
+/**
+ * @brief Get the allocation counters and the page placement of the live large blocks
+ *
+ * @param placement whether to query the huge pages and the NUMA nodes of the live blocks
+ * @return MemoryStats the statistics
+ */
+MemoryStats memoryStats(bool placement) {
+    MemoryStats stats;
+    vector<pair<uintptr_t, uintptr_t>> regions;
+    {
+        lock_guard<mutex> lock(RegionMutex);
+        stats = Counters;
+        for (auto& r : Regions) {
+            regions.push_back({(uintptr_t)r.first, (uintptr_t)r.first + r.second});
+        }
+    }
+    stats.numNodes = numaNodes();
+    stats.hugeBytes = -1;
+    stats.nodeBytes.clear();
+#ifdef __linux__
+    if (placement) {
+        stats.hugeBytes = min(hugeBytesOf(regions), stats.liveBytes);
+        stats.nodeBytes.assign(stats.numNodes, 0);
+        for (auto& r : regions) {
+            if (! addNodeBytes(r.first, r.second - r.first, stats.nodeBytes)) {
+                stats.nodeBytes.clear();
+                break;
+            }
+        }
+    }
+#else
+    (void)placement;
+#endif
+    return stats;
+}
+
+void MemoryStats::print() {
+    cout << "[INFO] [Memory] large blocks: [" << numLarge << "] explicit huge: [" << numExplicit << "] transparent huge: ["
+         << numTransparent << "] fallback: [" << numFallback << "] interleaved: [" << numInterleaved << "]" << endl;
+    cout << "[INFO] [Memory] live blocks: [" << liveBlocks << "] live: [" << liveBytes << " B] peak: [" << peakBytes << " B] huge pages: [";
+    if (hugeBytes < 0) {
+        cout << "unknown";
+    } else {
+        cout << hugeBytes << " B";
+    }
+    cout << "] nodes: [" << numNodes << "]";
+    for (ll n = 0; n < (ll)nodeBytes.size(); ++ n) {
+        cout << " node" << n << ": [" << nodeBytes[n] << " B]";
+    }
+    cout << endl;
+}
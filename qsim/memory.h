@@ -0,0 +1,96 @@
+#pragma once
+
+#include <bits/stdc++.h>
+using namespace std;
+
+#define ll long long int
+
+//
+// Allocation policy of large matrices and state vectors
+//
+// Matrix and SoAMatrix store their entries in one block from allocBlock. Blocks
+// of at least largeBytes are mapped directly from the OS and follow the policy:
+//   - hugePages: HUGEPAGES_TRANSPARENT advises the kernel to back the block with
+//     transparent huge pages, HUGEPAGES_EXPLICIT maps pages from the hugetlbfs
+//     pool (vm.nr_hugepages) and falls back to transparent ones if the pool is
+//     empty, HUGEPAGES_OFF keeps the system default.
+//   - firstTouch: the block is zeroed or copied by the threads of tileBounds
+//     over its rows, the partition of the threaded kernels, so on a NUMA
+//     machine each page lands on the node of the thread that later updates it.
+//   - interleave: the pages are spread round-robin over all NUMA nodes instead,
+//     for kernels whose threads touch every row, e.g., the column-wise OMSim.
+// Smaller blocks come from the heap. On Windows and on machines without NUMA
+// or huge page support, the policy degrades to plain 64-byte aligned blocks.
+//
+
+enum HugePageMode {
+    HUGEPAGES_OFF,
+    HUGEPAGES_TRANSPARENT,
+    HUGEPAGES_EXPLICIT
+};
+
+struct AllocPolicy {
+    ll largeBytes = 1LL << 22; // blocks of at least this many bytes follow the policy
+    HugePageMode hugePages = HUGEPAGES_TRANSPARENT;
+    bool firstTouch = true; // zero or copy large blocks in parallel
+    bool interleave = false; // interleave the pages of large blocks over the NUMA nodes
+    int numThreads = 0; // the threads of the first touch, 0 means all hardware threads
+};
+
+struct MemoryStats {
+    ll numLarge; // the large blocks allocated so far
+    ll numExplicit; // ... backed by hugetlbfs pages
+    ll numTransparent; // ... advised to use transparent huge pages
+    ll numFallback; // ... that asked for hugetlbfs pages but got none
+    ll numInterleaved; // ... interleaved over the NUMA nodes
+    ll liveBlocks; // the large blocks not yet freed
+    ll liveBytes;
+    ll peakBytes; // the max liveBytes so far
+    ll hugeBytes; // the bytes of the live large blocks backed by huge pages, -1 if unknown
+    int numNodes; // the online NUMA nodes
+    vector<ll> nodeBytes; // the bytes of the live large blocks on each node, estimated from sampled pages, empty if unknown
+
+    void print();
+};
+
+/**
+ * @brief Set the allocation policy of the blocks allocated from now on
+ *
+ * @param policy the policy
+ */
+void setAllocPolicy(const AllocPolicy& policy);
+
+/**
+ * @brief Get the current allocation policy
+ */
+AllocPolicy getAllocPolicy();
+
+/**
+ * @brief Allocate a 64-byte aligned block of rows * rowBytes bytes
+ *
+ * @param rows the number of rows, the unit of the first-touch tiles
+ * @param rowBytes the bytes of each row
+ * @param src optional, rows * rowBytes bytes to copy into the block, nullptr to zero it
+ * @return void* the block, nullptr if it is empty
+ */
+void* allocBlock(ll rows, ll rowBytes, const void* src = nullptr);
+
+/**
+ * @brief Free a block returned by allocBlock
+ *
+ * @param block the block, may be nullptr
+ */
+void freeBlock(void* block);
+
+/**
+ * @brief Get the allocation counters and the page placement of the live large blocks
+ *
+ * @param placement whether to query the huge pages and the NUMA nodes of the live blocks
+ * @return MemoryStats the statistics
+ */
+MemoryStats memoryStats(bool placement = true);
+
+/**
+ * @brief Get the number of online NUMA nodes, 1 without NUMA support
+ */
+int numaNodes();
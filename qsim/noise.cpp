@@ -0,0 +1,299 @@
+#include "noise.h"
+
+/**
+ * @brief Construct a noiseless NoiseModel object
+ */
+NoiseModel::NoiseModel() {
+    readout01 = 0;
+    readout10 = 0;
+}
+
+/**
+ * @brief Add a depolarizing channel after a gate
+ * 
+ * @param p the probability of a uniformly random non-identity Pauli on the gate's qubits
+ * @param gname the gate name, "" for all gates
+ */
+void NoiseModel::addDepolarizing(double p, string gname) {
+    if (p < 0 || p > 1) {
+        cout << "[ERROR] addDepolarizing: p is not in [0, 1]. " << endl;
+        exit(1);
+    }
+    if (gateNoise.find(gname) == gateNoise.end()) {
+        gateNoise[gname] = GateNoise{0, 0};
+    }
+    gateNoise[gname].depolarizing = p;
+}
+
+/**
+ * @brief Add an amplitude damping channel after a gate
+ * 
+ * @param gamma the damping rate on each qubit of the gate
+ * @param gname the gate name, "" for all gates
+ */
+void NoiseModel::addAmplitudeDamping(double gamma, string gname) {
+    if (gamma < 0 || gamma > 1) {
+        cout << "[ERROR] addAmplitudeDamping: gamma is not in [0, 1]. " << endl;
+        exit(1);
+    }
+    if (gateNoise.find(gname) == gateNoise.end()) {
+        gateNoise[gname] = GateNoise{0, 0};
+    }
+    gateNoise[gname].damping = gamma;
+}
+
+/**
+ * @brief Set the readout errors of all qubits
+ * 
+ * @param p01 P(read 1 | 0)
+ * @param p10 P(read 0 | 1)
+ */
+void NoiseModel::setReadoutError(double p01, double p10) {
+    readout01 = p01;
+    readout10 = p10;
+}
+
+/**
+ * @brief Get the noise after a gate
+ * 
+ * @param gate the processing gate
+ * @return GateNoise the gate-specific noise, or the noise for all gates
+ */
+GateNoise NoiseModel::getNoise(QGate& gate) {
+    auto it = gateNoise.find(gate.gname);
+    if (it == gateNoise.end()) {
+        it = gateNoise.find("");
+    }
+    return it == gateNoise.end() ? GateNoise{0, 0} : it->second;
+}
+
+//
+// Kraus choices on a single state vector
+//
+
+/**
+ * @brief Get the qubits of a gate (controls and targets)
+ */
+static vector<int> gateQubits(QGate& gate) {
+    vector<int> qubits = gate.controlQubits;
+    qubits.insert(qubits.end(), gate.targetQubits.begin(), gate.targetQubits.end());
+    return qubits;
+}
+
+/**
+ * @brief Apply a uniformly random non-identity Pauli string to the given qubits
+ */
+static void applyRandomPauli(Matrix<DTYPE>& sv, vector<int>& qubits, mt19937_64& rng) {
+    static const shared_ptr<Matrix<DTYPE>> paulis[4] = {Matrix<DTYPE>::findMatrix("IDE"), Matrix<DTYPE>::findMatrix("X"), 
+                                                        Matrix<DTYPE>::findMatrix("Y"), Matrix<DTYPE>::findMatrix("Z")};
+    ll numPaulis = 1LL << (2 * qubits.size());
+    ll r = uniform_int_distribution<ll>(1, numPaulis - 1)(rng);
+    for (size_t k = 0; k < qubits.size(); ++ k) {
+        int p = (r >> (2 * k)) & 3;
+        if (p != 0) {
+            apply2x2(sv, *paulis[p], qubits[k], 0, 0, 1);
+        }
+    }
+}
+
+/**
+ * @brief Apply an amplitude damping channel to qubit[qid] by choosing one of its Kraus operators
+ * 
+ * K0 = [[1, 0], [0, sqrt(1 - gamma)]], K1 = [[0, sqrt(gamma)], [0, 0]], P(K1) = gamma * P(qubit[qid] = 1)
+ */
+static void applyDamping(Matrix<DTYPE>& sv, int qid, double gamma, mt19937_64& rng) {
+    ll mask = 1LL << qid;
+    double p1 = 0;
+    for (ll i = 0; i < sv.row; ++ i) {
+        if (i & mask) {
+            p1 += norm(sv.data[i][0]);
+        }
+    }
+    double pjump = gamma * p1;
+    bool jump = uniform_real_distribution<double>(0, 1)(rng) < pjump;
+    double scale = 1.0 / sqrt(jump ? pjump : 1 - pjump);
+    double keep = sqrt(1 - gamma);
+    for (ll i = 0; i < sv.row; ++ i) {
+        if (i & mask) {
+            continue;
+        }
+        if (jump) {
+            // |1> -> |0>
+            sv.data[i][0] = sv.data[i | mask][0] * sqrt(gamma) * scale;
+            sv.data[i | mask][0] = 0;
+        } else {
+            sv.data[i][0] *= scale;
+            sv.data[i | mask][0] *= keep * scale;
+        }
+    }
+}
+
+/**
+ * @brief Sample the first noise event of a trajectory
+ * 
+ * A depolarizing error is state-independent, so it can be drawn ahead of time. 
+ * An amplitude damping channel depends on the state, so it is always an event. 
+ * 
+ * @return pair<ll, bool> (gate index of the first event, whether a depolarizing error occurs there)
+ */
+static pair<ll, bool> sampleFirstEvent(vector<GateNoise>& noises, mt19937_64& rng) {
+    uniform_real_distribution<double> uniform(0, 1);
+    for (size_t g = 0; g < noises.size(); ++ g) {
+        bool depolarized = noises[g].depolarizing > 0 && uniform(rng) < noises[g].depolarizing;
+        if (depolarized || noises[g].damping > 0) {
+            return make_pair((ll)g, depolarized);
+        }
+    }
+    return make_pair((ll)noises.size(), false);
+}
+
+/**
+ * @brief Get the random stream of trajectory t
+ */
+static mt19937_64 trajectoryRng(unsigned long long base, ll t) {
+    seed_seq seq{(unsigned)(base >> 32), (unsigned)base, (unsigned)(t >> 32), (unsigned)t};
+    return mt19937_64(seq);
+}
+
+/**
+ * @brief Run quantum trajectories and pass every final state to a callback
+ * 
+ * @param qc a quantum circuit
+ * @param sv the initial state vector
+ * @param noise the noise model
+ * @param numTrajectories the number of trajectories
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param fn the callback fn(workerId, trajectoryId, finalState, rng), called on the worker's thread
+ */
+void runTrajectories(QCircuit& qc, Matrix<DTYPE>& sv, NoiseModel& noise, ll numTrajectories, ll seed, int numThreads, 
+                     const function<void(int, ll, Matrix<DTYPE>&, mt19937_64&)>& fn) {
+    if (sv.row != (1LL << qc.numQubits) || sv.col != 1) {
+        cout << "[ERROR] runTrajectories: sv is not a 2^numQubits * 1 column. " << endl;
+        exit(1);
+    }
+    vector<QGate> ops = qc.flatGates();
+    vector<GateNoise> noises;
+    for (auto& gate : ops) {
+        noises.push_back(noise.getNoise(gate));
+    }
+    unsigned long long base = seed < 0 ? random_device()() : (unsigned long long)seed;
+
+    // Step 1. Sort the trajectories by their first noise event
+    vector<pair<ll, ll>> order(numTrajectories); // (first event, trajectory id)
+    parallelFor(0, numTrajectories, numThreads, [&](ll begin, ll end) {
+        for (ll t = begin; t < end; ++ t) {
+            mt19937_64 rng = trajectoryRng(base, t);
+            order[t] = make_pair(sampleFirstEvent(noises, rng).first, t);
+        }
+    });
+    sort(order.begin(), order.end());
+
+    // Step 2. Each worker owns a contiguous range of trajectories and one shared noiseless prefix
+    parallelForTiles(tileBounds(0, numTrajectories, numThreads), [&](int w, ll begin, ll end) {
+        Matrix<DTYPE> prefix(sv), state;
+        ll prefixPos = 0;
+        uniform_real_distribution<double> uniform(0, 1);
+        for (ll k = begin; k < end; ++ k) {
+            ll t = order[k].second;
+            mt19937_64 rng = trajectoryRng(base, t);
+            pair<ll, bool> event = sampleFirstEvent(noises, rng); // replay the draws of Step 1
+            for (; prefixPos < event.first; ++ prefixPos) {
+                applyGate(prefix, ops[prefixPos], 0, 1);
+            }
+            state = prefix;
+
+            for (ll g = event.first; g < (ll)ops.size(); ++ g) {
+                applyGate(state, ops[g], 0, 1);
+                vector<int> qubits = gateQubits(ops[g]);
+                // the depolarizing draw at the first event was made by sampleFirstEvent
+                bool depolarized = g == event.first ? event.second 
+                                 : noises[g].depolarizing > 0 && uniform(rng) < noises[g].depolarizing;
+                if (depolarized) {
+                    applyRandomPauli(state, qubits, rng);
+                }
+                if (noises[g].damping > 0) {
+                    for (int q : qubits) {
+                        applyDamping(state, q, noises[g].damping, rng);
+                    }
+                }
+            }
+            fn(w, t, state, rng);
+        }
+    });
+}
+
+/**
+ * @brief Sample noisy measurement outcomes of all qubits by quantum trajectories
+ * 
+ * @param qc a quantum circuit
+ * @param sv the initial state vector
+ * @param noise the noise model
+ * @param numTrajectories the number of trajectories
+ * @param shotsPerTrajectory the number of shots sampled from each final state
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return map<string, ll> bitstring -> count
+ */
+map<string, ll> trajectorySample(QCircuit& qc, Matrix<DTYPE>& sv, NoiseModel& noise, ll numTrajectories, 
+                                 ll shotsPerTrajectory, ll seed, int numThreads) {
+    int workers = numWorkers(numThreads);
+    vector<map<ll, ll>> partial(workers);
+    vector<vector<double>> weights(workers);
+
+    runTrajectories(qc, sv, noise, numTrajectories, seed, numThreads, 
+                    [&](int w, ll, Matrix<DTYPE>& state, mt19937_64& rng) {
+        vector<double>& wt = weights[w];
+        wt.resize(state.row);
+        for (ll i = 0; i < state.row; ++ i) {
+            wt[i] = norm(state.data[i][0]);
+        }
+        uniform_real_distribution<double> uniform(0, 1);
+        for (auto& p : sampleIndices(wt, shotsPerTrajectory, rng() >> 1, 1)) {
+            for (ll s = 0; s < p.second; ++ s) {
+                ll outcome = p.first;
+                for (int q = 0; q < qc.numQubits; ++ q) {
+                    double flip = ((outcome >> q) & 1) ? noise.readout10 : noise.readout01;
+                    if (flip > 0 && uniform(rng) < flip) {
+                        outcome ^= 1LL << q;
+                    }
+                }
+                partial[w][outcome] ++;
+            }
+        }
+    });
+
+    map<string, ll> counts;
+    for (auto& m : partial) {
+        for (auto& p : m) {
+            counts[toBitstring(p.first, qc.numQubits)] += p.second;
+        }
+    }
+    return counts;
+}
+
+/**
+ * @brief Estimate a noisy expectation value by averaging over quantum trajectories
+ * 
+ * @param qc a quantum circuit
+ * @param sv the initial state vector
+ * @param noise the noise model (readout errors are ignored)
+ * @param obs the observable
+ * @param numTrajectories the number of trajectories
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return double the mean of <psi_t| H |psi_t> over the trajectories
+ */
+double trajectoryExpectation(QCircuit& qc, Matrix<DTYPE>& sv, NoiseModel& noise, Observable& obs, 
+                             ll numTrajectories, ll seed, int numThreads) {
+    vector<double> partial(numWorkers(numThreads), 0.0);
+    runTrajectories(qc, sv, noise, numTrajectories, seed, numThreads, 
+                    [&](int w, ll, Matrix<DTYPE>& state, mt19937_64&) {
+        partial[w] += obs.expectation(state, 1);
+    });
+    double total = 0;
+    for (double p : partial) {
+        total += p;
+    }
+    return numTrajectories > 0 ? total / numTrajectories : 0.0;
+}
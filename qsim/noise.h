@@ -0,0 +1,88 @@
+#pragma once
+
+#include "omsim.h"
+#include "observable.h"
+#include "sampler.h"
+
+// The noise channels applied after a gate
+struct GateNoise {
+    double depolarizing; // probability of a uniformly random non-identity Pauli on the gate's qubits
+    double damping; // amplitude damping rate gamma on each qubit of the gate
+};
+
+/**
+ * @brief A noise model for a quantum circuit
+ * 
+ * Gate noise is looked up by gate name, falling back to the entry "" that 
+ * applies to all gates. Readout errors flip measured bits independently. 
+ */
+class NoiseModel {
+public:
+    map<string, GateNoise> gateNoise; // gname -> the noise after the gate, "" for all gates
+    double readout01; // P(read 1 | 0)
+    double readout10; // P(read 0 | 1)
+
+    NoiseModel();
+
+    void addDepolarizing(double p, string gname = "");
+    void addAmplitudeDamping(double gamma, string gname = "");
+    void setReadoutError(double p01, double p10);
+
+    GateNoise getNoise(QGate& gate); // the noise after a gate
+};
+
+//
+// Quantum trajectory simulation
+//
+// Every trajectory applies stochastic Kraus choices to a single state vector, 
+// so each worker holds O(2^n) memory. Trajectories are sorted by the position 
+// of their first noise event; each worker advances one shared noiseless prefix 
+// state and branches every trajectory off it at its first event. 
+// Trajectory t uses a random stream derived from (seed, t), so the results do 
+// not depend on the number of threads. 
+//
+
+/**
+ * @brief Sample noisy measurement outcomes of all qubits by quantum trajectories
+ * 
+ * @param qc a quantum circuit
+ * @param sv the initial state vector
+ * @param noise the noise model
+ * @param numTrajectories the number of trajectories
+ * @param shotsPerTrajectory the number of shots sampled from each final state
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return map<string, ll> bitstring -> count
+ */
+map<string, ll> trajectorySample(QCircuit& qc, Matrix<DTYPE>& sv, NoiseModel& noise, ll numTrajectories, 
+                                 ll shotsPerTrajectory = 1, ll seed = -1, int numThreads = 0);
+
+/**
+ * @brief Estimate a noisy expectation value by averaging over quantum trajectories
+ * 
+ * @param qc a quantum circuit
+ * @param sv the initial state vector
+ * @param noise the noise model (readout errors are ignored)
+ * @param obs the observable
+ * @param numTrajectories the number of trajectories
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return double the mean of <psi_t| H |psi_t> over the trajectories
+ */
+double trajectoryExpectation(QCircuit& qc, Matrix<DTYPE>& sv, NoiseModel& noise, Observable& obs, 
+                             ll numTrajectories, ll seed = -1, int numThreads = 0);
+
+/**
+ * @brief Run quantum trajectories and pass every final state to a callback
+ * 
+ * @param qc a quantum circuit
+ * @param sv the initial state vector
+ * @param noise the noise model
+ * @param numTrajectories the number of trajectories
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param fn the callback fn(workerId, trajectoryId, finalState, rng), called on the worker's thread, 
+ *           workerId < numWorkers(numThreads)
+ */
+void runTrajectories(QCircuit& qc, Matrix<DTYPE>& sv, NoiseModel& noise, ll numTrajectories, ll seed, int numThreads, 
+                    const function<void(int, ll, Matrix<DTYPE>&, mt19937_64&)>& fn);
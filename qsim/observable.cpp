@@ -0,0 +1,210 @@
+#include "observable.h"
+
+/**
+ * @brief Construct an empty observable on numQubits_ qubits
+ * 
+ * @param numQubits_ #Qubits
+ */
+Observable::Observable(int numQubits_) {
+    numQubits = numQubits_;
+}
+
+/**
+ * @brief Add a Pauli string acting on all qubits
+ * 
+ * @param coeff the weight
+ * @param paulis a string over {I, X, Y, Z}, from the high-order qubit to q_0
+ */
+void Observable::add(double coeff, string paulis) {
+    if ((int)paulis.size() != numQubits) {
+        cout << "[ERROR] Observable add: the length of " << paulis << " != numQubits. " << endl;
+        exit(1);
+    }
+    vector<int> qubits;
+    for (int k = numQubits - 1; k >= 0; -- k) {
+        qubits.push_back(k);
+    }
+    add(coeff, paulis, qubits);
+}
+
+/**
+ * @brief Add a Pauli string acting on the given qubits
+ * 
+ * @param coeff the weight
+ * @param paulis a string over {I, X, Y, Z}
+ * @param qubits paulis[k] acts on qubit[qubits[k]]
+ */
+void Observable::add(double coeff, string paulis, vector<int> qubits) {
+    if (paulis.size() != qubits.size()) {
+        cout << "[ERROR] Observable add: paulis.size() != qubits.size(). " << endl;
+        exit(1);
+    }
+    PauliTerm term;
+    term.coeff = coeff;
+    term.xmask = 0;
+    term.zmask = 0;
+    for (size_t k = 0; k < paulis.size(); ++ k) {
+        if (qubits[k] < 0 || qubits[k] >= numQubits) {
+            cout << "[ERROR] Observable add: qubit " << qubits[k] << " out of range. " << endl;
+            exit(1);
+        }
+        ll bit = 1LL << qubits[k];
+        switch (paulis[k]) {
+            case 'I': break;
+            case 'X': term.xmask |= bit; break;
+            case 'Y': term.xmask |= bit; term.zmask |= bit; break;
+            case 'Z': term.zmask |= bit; break;
+            default:
+                cout << "[ERROR] Observable add: unknown Pauli " << paulis[k] << endl;
+                exit(1);
+        }
+    }
+    terms.push_back(term);
+}
+
+/**
+ * @brief Compute sum_t coeff_t <sv| P_t |sv> over the amplitudes amp(j), j in [0, dim)
+ * 
+ * For P = i^{|x & z|} X^x Z^z, <sv| P |sv> = i^{|x & z|} sum_j conj(sv[j ^ x]) sv[j] (-1)^{|j & z|}. 
+ */
+template <typename Amp>
+static double pauliExpectation(vector<PauliTerm>& terms, ll dim, int numThreads, Amp amp) {
+    // group the terms by X mask; each group keeps (zmask, coeff * i^{|x & z|})
+    map<ll, vector<pair<ll, DTYPE>>> groups;
+    const DTYPE phases[4] = {DTYPE(1, 0), DTYPE(0, 1), DTYPE(-1, 0), DTYPE(0, -1)};
+    for (auto& term : terms) {
+        int ny = __builtin_popcountll(term.xmask & term.zmask);
+        groups[term.xmask].push_back(make_pair(term.zmask, term.coeff * phases[ny & 3]));
+    }
+
+    vector<ll> bounds = tileBounds(0, dim, numThreads);
+    vector<DTYPE> partial(bounds.size() - 1, 0);
+    parallelForTiles(bounds, [&](int w, ll begin, ll end) {
+        DTYPE acc = 0;
+        for (auto& group : groups) {
+            ll xmask = group.first;
+            vector<pair<ll, DTYPE>>& zterms = group.second;
+            for (ll j = begin; j < end; ++ j) {
+                DTYPE prod = conj(amp(j ^ xmask)) * amp(j);
+                if (prod == 0.0) {
+                    continue;
+                }
+                DTYPE weight = 0;
+                for (auto& zt : zterms) {
+                    if (__builtin_popcountll(j & zt.first) & 1) {
+                        weight -= zt.second;
+                    } else {
+                        weight += zt.second;
+                    }
+                }
+                acc += weight * prod;
+            }
+        }
+        partial[w] = acc;
+    });
+
+    DTYPE total = 0;
+    for (auto& p : partial) {
+        total += p;
+    }
+    return total.real(); // H is Hermitian
+}
+
+/**
+ * @brief Compute the expectation <sv| H |sv>
+ * 
+ * @param sv the state vector, a 2^n * 1 column
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return double the expectation
+ */
+double Observable::expectation(Matrix<DTYPE>& sv, int numThreads) {
+    if (sv.row != (1LL << numQubits) || sv.col != 1) {
+        cout << "[ERROR] Observable expectation: sv is not a 2^numQubits * 1 column. " << endl;
+        exit(1);
+    }
+    return pauliExpectation(terms, sv.row, numThreads, [&](ll j) { return sv.data[j][0]; });
+}
+
+/**
+ * @brief Compute the expectation <sv| H |sv> of a contiguous state vector
+ * 
+ * @param sv the 2^numQubits amplitudes
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return double the expectation
+ */
+double Observable::expectation(const DTYPE* sv, int numThreads) {
+    return pauliExpectation(terms, 1LL << numQubits, numThreads, [&](ll j) { return sv[j]; });
+}
+
+/**
+ * @brief Apply the observable to a state vector
+ * 
+ * Each output amplitude gathers one input amplitude per X mask, 
+ * (H sv)[j] = sum_x w_x(j ^ x) * sv[j ^ x], so the rows can be split across threads. 
+ * 
+ * @param sv the state vector
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return Matrix<DTYPE> H |sv>
+ */
+Matrix<DTYPE> Observable::apply(Matrix<DTYPE>& sv, int numThreads) {
+    if (sv.row != (1LL << numQubits) || sv.col != 1) {
+        cout << "[ERROR] Observable apply: sv is not a 2^numQubits * 1 column. " << endl;
+        exit(1);
+    }
+
+    // group the terms by X mask; each group keeps (zmask, coeff * i^{|x & z|})
+    map<ll, vector<pair<ll, DTYPE>>> groups;
+    const DTYPE phases[4] = {DTYPE(1, 0), DTYPE(0, 1), DTYPE(-1, 0), DTYPE(0, -1)};
+    for (auto& term : terms) {
+        int ny = __builtin_popcountll(term.xmask & term.zmask);
+        groups[term.xmask].push_back(make_pair(term.zmask, term.coeff * phases[ny & 3]));
+    }
+
+    Matrix<DTYPE> out(sv.row, 1);
+    parallelFor(0, sv.row, numThreads, [&](ll begin, ll end) {
+        for (auto& group : groups) {
+            ll xmask = group.first;
+            vector<pair<ll, DTYPE>>& zterms = group.second;
+            for (ll j = begin; j < end; ++ j) {
+                ll src = j ^ xmask; // X^x Z^z |src> = (-1)^{|src & z|} |j>
+                if (sv.data[src][0] == 0.0) {
+                    continue;
+                }
+                DTYPE weight = 0;
+                for (auto& zt : zterms) {
+                    if (__builtin_popcountll(src & zt.first) & 1) {
+                        weight -= zt.second;
+                    } else {
+                        weight += zt.second;
+                    }
+                }
+                out.data[j][0] += weight * sv.data[src][0];
+            }
+        }
+    });
+    return out;
+}
+
+// Return the number of distinct X masks, i.e., the number of passes over the amplitudes
+int Observable::numGroups() {
+    set<ll> xmasks;
+    for (auto& term : terms) {
+        xmasks.insert(term.xmask);
+    }
+    return xmasks.size();
+}
+
+// Print the Pauli terms
+void Observable::print() {
+    cout << "[INFO] [Observable] numQubits: [" << numQubits << "] numTerms: [" << terms.size() 
+         << "] numGroups: [" << numGroups() << "]" << endl;
+    for (auto& term : terms) {
+        string paulis(numQubits, 'I');
+        for (int q = 0; q < numQubits; ++ q) {
+            bool x = (term.xmask >> q) & 1;
+            bool z = (term.zmask >> q) & 1;
+            paulis[numQubits - 1 - q] = x ? (z ? 'Y' : 'X') : (z ? 'Z' : 'I');
+        }
+        cout << term.coeff << " * " << paulis << endl;
+    }
+}
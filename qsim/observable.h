@@ -0,0 +1,34 @@
+#pragma once
+
+#include "parallel.h"
+
+// A weighted Pauli string coeff * P, where P = i^{|x & z|} X^x Z^z
+struct PauliTerm {
+    double coeff; // the real weight of the term
+    ll xmask; // bit q is set if P has X or Y on qubit q
+    ll zmask; // bit q is set if P has Z or Y on qubit q
+};
+
+/**
+ * @brief An observable H = sum_t coeff_t * P_t given as a weighted sum of Pauli strings
+ * 
+ * Expectations are computed directly on the state vector without building any 
+ * 2^n * 2^n matrix: X^x Z^z |j> = (-1)^{|j & z|} |j ^ x>. Terms are grouped 
+ * by their X mask, so all terms of a group share one pass over the amplitude pairs. 
+ */
+class Observable {
+public:
+    int numQubits;
+    vector<PauliTerm> terms;
+
+    Observable(int numQubits_);
+
+    void add(double coeff, string paulis); // e.g., add(0.5, "XIZY"), the last character acts on q_0
+    void add(double coeff, string paulis, vector<int> qubits); // e.g., add(0.5, "ZZ", {0, 3})
+
+    double expectation(Matrix<DTYPE>& sv, int numThreads = 0); // <sv| H |sv>
+    double expectation(const DTYPE* sv, int numThreads = 0); // <sv| H |sv> of 2^numQubits contiguous amplitudes
+    Matrix<DTYPE> apply(Matrix<DTYPE>& sv, int numThreads = 0); // H |sv>
+    int numGroups(); // the number of distinct X masks
+    void print();
+};
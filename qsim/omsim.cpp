@@ -5,15 +5,34 @@
  * 
  * @param sv the state vector
  * @param qc a quantum circuit
+ * @param cache an optional cache of level operators shared by identical levels
  * @return Matrix<DTYPE> the operation matrix
  */
-Matrix<DTYPE> OMSim(Matrix<DTYPE>& sv, QCircuit& qc) {
+Matrix<DTYPE> OMSim(Matrix<DTYPE>& sv, QCircuit& qc, LevelCache* cache) {
     Matrix<DTYPE> opmat, levelmat;
     opmat.identity(sv.row);
     levelmat.identity(2);
 
     // calculate the operation matrix of the quantum circuit
     for (int j = 0; j < qc.numDepths; ++ j) {
+        if (qc.isRepeat(j)) {
+            // compute the operation matrix of the block once, then raise it to the count-th power
+            QRepeat& rep = qc.repeats[j];
+            if (rep.powmat == nullptr) {
+                Matrix<DTYPE> blocksv(sv.row, 1);
+                rep.powmat = make_shared<Matrix<DTYPE>>(OMSim(blocksv, *rep.body, cache).power(rep.count));
+            }
+            opmat = *rep.powmat * opmat;
+            continue;
+        }
+        if (cache != nullptr) {
+            // reuse the operator of an identical level
+            shared_ptr<Matrix<DTYPE>> cached = cache->get(qc.gates[j]);
+            if (cached != nullptr) {
+                opmat = *cached * opmat;
+                continue;
+            }
+        }
         int qid = qc.numQubits-1;
 
         // get the highest gate matrix
@@ -45,16 +64,514 @@ Matrix<DTYPE> OMSim(Matrix<DTYPE>& sv, QCircuit& qc) {
         // [TODO] Step 3. Update the operation matrix opmat for the entire circuit
 
         // ///////////////////////////////////////////////////////////////////////////
+
+        if (cache != nullptr) {
+            cache->put(qc.gates[j], make_shared<Matrix<DTYPE>>(levelmat));
+        }
+    }
+    // update the state vector sv
+    sv = opmat * sv;
+    return opmat;
+}
+
+/**
+ * @brief Conduct operation matrix simulation by column-wise state-vector propagation
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return Matrix<DTYPE> the operation matrix
+ */
+Matrix<DTYPE> OMSimColumnwise(Matrix<DTYPE>& sv, QCircuit& qc, int numThreads) {
+    if (sv.row != (1LL << qc.numQubits)) {
+        cout << "[ERROR] OMSimColumnwise: sv.row != 2^numQubits. " << endl;
+        exit(1);
+    }
+    Matrix<DTYPE> opmat;
+    opmat.identity(sv.row);
+    cacheRepeatMatrices(qc, opmat.col, numThreads);
+
+    // column j of opmat is the image of the basis vector |j>
+    parallelFor(0, opmat.col, numThreads, [&](ll cbegin, ll cend) {
+        applyCircuit(opmat, qc, cbegin, cend);
+    });
+
+    // update the state vector sv
+    sv = opmat * sv;
+    return opmat;
+}
+
+/**
+ * @brief Conduct operation matrix simulation with sparse level operators
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ * @param threshold the density above which the accumulation becomes dense
+ * @return SparseMatrix<DTYPE> the operation matrix
+ */
+SparseMatrix<DTYPE> OMSimSparse(Matrix<DTYPE>& sv, QCircuit& qc, double threshold) {
+    if (sv.row != (1LL << qc.numQubits)) {
+        cout << "[ERROR] OMSimSparse: sv.row != 2^numQubits. " << endl;
+        exit(1);
+    }
+    QCircuit flat = qc.unrolled();
+
+    // the operation matrix is held in exactly one of the three formats
+    enum { MONOMIAL, CSR, DENSE } format = MONOMIAL;
+    MonomialMatrix<DTYPE> monomat;
+    SparseMatrix<DTYPE> csrmat;
+    Matrix<DTYPE> densemat;
+    monomat.identity(sv.row);
+
+    for (int j = 0; j < flat.numDepths; ++ j) {
+        SparseMatrix<DTYPE> levelmat = getLevelSparse(flat.gates[j]);
+        if (format == MONOMIAL) {
+            if (levelmat.isMonomial()) {
+                monomat = levelmat.toMonomial() * monomat;
+                continue;
+            }
+            csrmat = monomat.toSparse();
+            format = CSR;
+        }
+        if (format == CSR) {
+            csrmat = levelmat * csrmat;
+            if (csrmat.density() > threshold) {
+                densemat = csrmat.toDense();
+                format = DENSE;
+            }
+            continue;
+        }
+        densemat = levelmat * densemat;
+    }
+
+    SparseMatrix<DTYPE> opmat;
+    if (format == MONOMIAL) {
+        opmat = monomat.toSparse();
+    } else if (format == CSR) {
+        opmat = csrmat;
+    } else {
+        opmat = SparseMatrix<DTYPE>(densemat);
+    }
+    // update the state vector sv
+    sv = opmat * sv;
+    return opmat;
+}
+
+// A node of the product tree, the product O_{end-1} ... O_begin of the level operators, keyed by begin
+struct TreeNode {
+    int end;
+    int height;
+    shared_ptr<Matrix<DTYPE>> mat;
+};
+
+// C += A * B over the rows [rbegin, rend) of C, skipping the zero entries of A
+static void multiplyRows(const Matrix<DTYPE>& a, const Matrix<DTYPE>& b, Matrix<DTYPE>& c, ll rbegin, ll rend) {
+    for (ll i = rbegin; i < rend; ++ i) {
+        DTYPE* ci = c.data[i];
+        for (ll k = 0; k < a.col; ++ k) {
+            double ar = a.data[i][k].real(), ai = a.data[i][k].imag();
+            if (ar == 0 && ai == 0) {
+                continue;
+            }
+            const DTYPE* bk = b.data[k];
+            for (ll j = 0; j < b.col; ++ j) {
+                ci[j] += DTYPE(ar * bk[j].real() - ai * bk[j].imag(), ar * bk[j].imag() + ai * bk[j].real());
+            }
+        }
+    }
+}
+
+/**
+ * @brief Conduct operation matrix simulation by a parallel product tree of the level operators
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param maxLive the max 2^n * 2^n matrices live at once, at least 3, 0 means 3 per thread
+ * @param cache an optional cache of level operators shared by identical levels
+ * @param stats optional tree statistics
+ * @return Matrix<DTYPE> the operation matrix
+ */
+Matrix<DTYPE> OMSimTree(Matrix<DTYPE>& sv, QCircuit& qc, int numThreads, int maxLive, LevelCache* cache, TreeStats* stats) {
+    if (sv.row != (1LL << qc.numQubits)) {
+        cout << "[ERROR] OMSimTree: sv.row != 2^numQubits. " << endl;
+        exit(1);
+    }
+    auto start = chrono::steady_clock::now();
+    int workers = numWorkers(numThreads);
+    if (maxLive == 0) {
+        maxLive = 3 * workers;
+    }
+    if (maxLive < 3) {
+        cout << "[ERROR] OMSimTree: maxLive < 3, a product needs 2 operands and 1 result. " << endl;
+        exit(1);
+    }
+    // the leaves of the repeated blocks, built by the tree of each body
+    int numLevels = qc.numDepths;
+    vector<shared_ptr<Matrix<DTYPE>>> repeatOps(numLevels);
+    for (auto& it : qc.repeats) {
+        QRepeat& rep = it.second;
+        if (rep.powmat == nullptr) {
+            Matrix<DTYPE> blocksv(sv.row, 1);
+            rep.powmat = make_shared<Matrix<DTYPE>>(OMSimTree(blocksv, *rep.body, numThreads, maxLive, cache).power(rep.count));
+        }
+        repeatOps[it.first] = rep.powmat;
+    }
+
+    mutex mtx;
+    condition_variable cv;
+    map<int, TreeNode> ready; // the finished nodes, keyed by their first level
+    int next = 0; // the next level to build
+    int live = 0, peakLive = 0, running = 0, height = 0;
+    ll numProducts = 0;
+    bool done = numLevels == 0;
+
+    auto work = [&]() {
+        unique_lock<mutex> lock(mtx);
+        while (! done) {
+            // a product needs 1 free slot, and building a level 2, so a product always fits afterwards
+            bool relaxed = next == numLevels || live + 2 > maxLive;
+            auto lo = ready.end();
+            int loHeight = INT_MAX;
+            for (auto it = ready.begin(); it != ready.end() && live + 1 <= maxLive; ++ it) {
+                auto hi = ready.find(it->second.end);
+                if (hi == ready.end() || (! relaxed && hi->second.height != it->second.height)) {
+                    continue;
+                }
+                int h = max(it->second.height, hi->second.height);
+                if (h < loHeight) {
+                    lo = it;
+                    loHeight = h;
+                }
+            }
+            if (lo != ready.end()) {
+                // multiply the lowest adjacent pair, the later levels on the left
+                int begin = lo->first;
+                TreeNode a = lo->second;
+                auto hi = ready.find(a.end);
+                TreeNode b = hi->second;
+                ready.erase(hi);
+                ready.erase(lo);
+                ++ live;
+                ++ running;
+                peakLive = max(peakLive, live);
+                int share = max(1, workers / running);
+                lock.unlock();
+
+                shared_ptr<Matrix<DTYPE>> prod = make_shared<Matrix<DTYPE>>(a.mat->row, a.mat->col);
+                parallelFor(0, prod->row, share, [&](ll rbegin, ll rend) {
+                    multiplyRows(*b.mat, *a.mat, *prod, rbegin, rend);
+                });
+                a.mat.reset();
+                b.mat.reset();
+
+                lock.lock();
+                live -= 2;
+                -- running;
+                ++ numProducts;
+                height = max(height, loHeight + 1);
+                ready[begin] = {b.end, loHeight + 1, prod};
+            } else if (next < numLevels && live + 2 <= maxLive) {
+                int j = next ++;
+                ++ live;
+                ++ running;
+                peakLive = max(peakLive, live);
+                lock.unlock();
+
+                shared_ptr<Matrix<DTYPE>> mat = qc.isRepeat(j) ? repeatOps[j] : getLevelMatrix(qc.gates[j], cache);
+
+                lock.lock();
+                -- running;
+                ready[j] = {j + 1, 0, mat};
+            } else {
+                cv.wait(lock);
+                continue;
+            }
+            done = next == numLevels && running == 0 && ready.size() == 1;
+            cv.notify_all();
+        }
+    };
+    parallelFor(0, workers, workers, [&](ll, ll) {
+        work();
+    });
+
+    Matrix<DTYPE> opmat;
+    if (numLevels == 0) {
+        opmat.identity(sv.row);
+    } else {
+        shared_ptr<Matrix<DTYPE>>& root = ready.begin()->second.mat;
+        if (root.use_count() == 1) {
+            opmat = move(*root);
+        } else {
+            opmat = *root; // a cached level or a repeated block
+        }
+    }
+    if (stats != nullptr) {
+        stats->numLevels = numLevels;
+        stats->numProducts = numProducts;
+        stats->height = height;
+        stats->peakLive = peakLive;
+        stats->maxLive = maxLive;
+        stats->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
     }
     // update the state vector sv
     sv = opmat * sv;
     return opmat;
 }
 
+void TreeStats::print() {
+    cout << "[INFO] [Tree] levels: [" << numLevels << "] products: [" << numProducts << "] height: [" << height
+         << "] peakLive: [" << peakLive << " / " << maxLive << "] time: [" << seconds << "s]" << endl;
+}
+
+/**
+ * @brief Conduct state vector simulation of a quantum circuit with the in-place gate kernels
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ */
+void SVSim(Matrix<DTYPE>& sv, QCircuit& qc) {
+    cacheRepeatMatrices(qc, sv.col);
+    applyCircuit(sv, qc, 0, sv.col);
+}
+
+/**
+ * @brief Apply the levels of a quantum circuit to mat in place, with a checkpoint every interval levels
+ * 
+ * @param mat the state vector(s), restored from the checkpoint if it matches
+ * @param qc a quantum circuit
+ * @param path the checkpoint file
+ * @param interval the number of levels between two checkpoints
+ * @param compress whether to zero-run encode the checkpoints
+ * @param fingerprint the fingerprint of the simulation
+ * @param numThreads the number of threads, 0 means all hardware threads
+ */
+static void simulateCheckpointed(Matrix<DTYPE>& mat, QCircuit& qc, const string& path, int interval, bool compress, uint64_t fingerprint, int numThreads) {
+    if (interval <= 0) {
+        cout << "[ERROR] simulateCheckpointed: interval <= 0. " << endl;
+        exit(1);
+    }
+    int start = 0;
+    Matrix<DTYPE> restored;
+    if (loadCheckpoint(path, fingerprint, restored, start)) {
+        if (restored.row != mat.row || restored.col != mat.col || start < 0 || start > qc.numDepths) {
+            cout << "[ERROR] simulateCheckpointed: invalid checkpoint " << path << endl;
+            exit(1);
+        }
+        mat = move(restored);
+        cout << "[INFO] [Checkpoint] resumed: [" << path << "] nextLevel: [" << start << "]" << endl;
+    }
+    cacheRepeatMatrices(qc, mat.col, numThreads);
+
+    for (int lbegin = start; lbegin < qc.numDepths; ) {
+        int lend = min(lbegin + interval, qc.numDepths);
+        parallelFor(0, mat.col, numThreads, [&](ll cbegin, ll cend) {
+            applyLevels(mat, qc, lbegin, lend, cbegin, cend);
+        });
+        lbegin = lend;
+        if (lbegin < qc.numDepths) {
+            saveCheckpoint(path, mat, lbegin, fingerprint, compress);
+        }
+    }
+    remove(path.c_str());
+}
+
+/**
+ * @brief Conduct state vector simulation with a checkpoint every interval levels
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ * @param path the checkpoint file
+ * @param interval the number of levels between two checkpoints
+ * @param compress whether to zero-run encode the checkpoints
+ */
+void SVSimCheckpointed(Matrix<DTYPE>& sv, QCircuit& qc, const string& path, int interval, bool compress) {
+    if (sv.row != (1LL << qc.numQubits)) {
+        cout << "[ERROR] SVSimCheckpointed: sv.row != 2^numQubits. " << endl;
+        exit(1);
+    }
+    // the checkpoint must belong to the same circuit and the same input state
+    uint64_t key[3] = {1, circuitFingerprint(qc), matrixChecksum(sv)};
+    Checksum64 cs;
+    cs.update(key, sizeof(key));
+    simulateCheckpointed(sv, qc, path, interval, compress, cs.value(), 0);
+}
+
+/**
+ * @brief Conduct column-wise operation matrix simulation with a checkpoint every interval levels
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ * @param path the checkpoint file
+ * @param interval the number of levels between two checkpoints
+ * @param compress whether to zero-run encode the checkpoints
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return Matrix<DTYPE> the operation matrix
+ */
+Matrix<DTYPE> OMSimCheckpointed(Matrix<DTYPE>& sv, QCircuit& qc, const string& path, int interval, bool compress, int numThreads) {
+    if (sv.row != (1LL << qc.numQubits)) {
+        cout << "[ERROR] OMSimCheckpointed: sv.row != 2^numQubits. " << endl;
+        exit(1);
+    }
+    uint64_t key[2] = {2, circuitFingerprint(qc)};
+    Checksum64 cs;
+    cs.update(key, sizeof(key));
+
+    Matrix<DTYPE> opmat;
+    opmat.identity(sv.row);
+    simulateCheckpointed(opmat, qc, path, interval, compress, cs.value(), numThreads);
+
+    // update the state vector sv
+    sv = opmat * sv;
+    return opmat;
+}
+
 //
 // Utility functions
 //
 
+/**
+ * @brief Get a complete gate matrix according to the applied qubits, in the sparse format
+ * 
+ * @param gate the processing gate
+ * @return SparseMatrix<DTYPE> a complete gate matrix
+ */
+SparseMatrix<DTYPE> getCompleteSparseMatrix(QGate& gate) {
+    if (gate.isIDE() || gate.isSingle()) {
+        return SparseMatrix<DTYPE>(* gate.gmat);
+    }
+    if (gate.is2QubitControlled()) {
+        return genControlledGateSparse(gate);
+    }
+    if (gate.gname == "SWAP") {
+        return genSwapGateSparse(gate);
+    }
+    cout << "[ERROR] getCompleteSparseMatrix: " << gate.gname << " not implemented" << endl;
+    exit(1);
+}
+
+/**
+ * @brief Generate the gate matrix of a 2-qubit controlled gate, in the sparse format
+ * 
+ * @param gate the processing gate
+ * @return SparseMatrix<DTYPE> a complete gate matrix
+ */
+SparseMatrix<DTYPE> genControlledGateSparse(QGate& gate) {
+    int ctrl = gate.controlQubits[0];
+    int targ = gate.targetQubits[0];
+    int low = min(ctrl, targ);
+    ll dim = 1LL << (abs(ctrl - targ) + 1);
+    ll cmask = 1LL << (ctrl - low);
+    ll tmask = 1LL << (targ - low);
+
+    // column i: |i> if the control bit is 0, otherwise the gate acts on the target bit
+    vector<tuple<ll, ll, DTYPE>> triplets;
+    for (ll i = 0; i < dim; ++ i) {
+        if ((i & cmask) == 0) {
+            triplets.push_back(make_tuple(i, i, DTYPE(1)));
+            continue;
+        }
+        ll bit = (i & tmask) ? 1 : 0;
+        for (ll r = 0; r < 2; ++ r) {
+            DTYPE v = gate.gmat->data[r][bit];
+            if (v != 0.0) {
+                triplets.push_back(make_tuple(r ? (i | tmask) : (i & ~tmask), i, v));
+            }
+        }
+    }
+    return SparseMatrix<DTYPE>(dim, dim, triplets);
+}
+
+/**
+ * @brief Generate the gate matrix of a SWAP gate, in the sparse format
+ * 
+ * @param gate the processing SWAP gate
+ * @return SparseMatrix<DTYPE> a complete gate matrix
+ */
+SparseMatrix<DTYPE> genSwapGateSparse(QGate& gate) {
+    // when adding a SWAP, the target qubits are sorted in ascending order
+    int span = gate.targetQubits[1] - gate.targetQubits[0] + 1;
+    ll mask0 = (1LL << (span - 1));
+    ll mask1 = 1;
+
+    MonomialMatrix<DTYPE> mat;
+    mat.identity(1LL << span);
+    for (ll i = 0; i < (1LL << span); ++ i) {
+        if (((i & mask0) == 0) != ((i & mask1) == 0)) {
+            // |0..1> <-> |1..0>
+            mat.perm[i] = i ^ mask0 ^ mask1;
+        }
+    }
+    return mat.toSparse();
+}
+
+/**
+ * @brief Get the 2^n * 2^n operator of a level, in the sparse format
+ * 
+ * @param level the processing level
+ * @return SparseMatrix<DTYPE> the tensor product of the complete gate matrices, high-order qubits first
+ */
+SparseMatrix<DTYPE> getLevelSparse(vector<QGate>& level) {
+    SparseMatrix<DTYPE> levelmat;
+    levelmat.identity(1);
+    for (int qid = level.size() - 1; qid >= 0; -- qid) {
+        // MARK gates cover the remaining qubits of a multi-qubit gate
+        if (level[qid].isMARK()) {
+            continue;
+        }
+        levelmat = levelmat.tensorProduct(getCompleteSparseMatrix(level[qid]));
+    }
+    return levelmat;
+}
+
+/**
+ * @brief Get the 2^n * 2^n operator of a level
+ * 
+ * @param level the processing level
+ * @param cache an optional cache of level operators
+ * @return shared_ptr<Matrix<DTYPE>> the level operator
+ */
+shared_ptr<Matrix<DTYPE>> getLevelMatrix(vector<QGate>& level, LevelCache* cache) {
+    if (cache != nullptr) {
+        shared_ptr<Matrix<DTYPE>> cached = cache->get(level);
+        if (cached != nullptr) {
+            return cached;
+        }
+    }
+    shared_ptr<Matrix<DTYPE>> levelmat = make_shared<Matrix<DTYPE>>();
+    levelmat->identity(1LL << level.size());
+    applyLevel(*levelmat, level, 0, levelmat->col);
+    if (cache != nullptr) {
+        cache->put(level, levelmat);
+    }
+    return levelmat;
+}
+
+/**
+ * @brief Cache the operation matrices O_body^count of the repeated blocks of a circuit
+ * 
+ * @param qc a quantum circuit
+ * @param ncols the number of columns the repeated blocks will be applied to
+ * @param numThreads the number of threads, 0 means all hardware threads
+ */
+void cacheRepeatMatrices(QCircuit& qc, ll ncols, int numThreads) {
+    double dim = (double)(1LL << qc.numQubits);
+    for (auto& it : qc.repeats) {
+        QRepeat& rep = it.second;
+        if (rep.powmat != nullptr || rep.count == 0) {
+            continue;
+        }
+        double squaring = (2 * log2((double)rep.count) + 1) * dim * dim * dim + dim * dim * ncols;
+        double unrolling = (double)rep.count * rep.body->numGates() * dim * ncols;
+        if (squaring >= unrolling) {
+            continue;
+        }
+        Matrix<DTYPE> blocksv(1LL << qc.numQubits, 1);
+        Matrix<DTYPE> blockmat = OMSimColumnwise(blocksv, *rep.body, numThreads);
+        rep.powmat = make_shared<Matrix<DTYPE>>(blockmat.power(rep.count));
+    }
+}
+
 /**
  * @brief [TODO] Get a complete gate matrix according to the applied qubits
  * 
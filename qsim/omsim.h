@@ -1,20 +1,184 @@
 #pragma once
 
-#include "qcircuit.h"
+#include "kernel.h"
+#include "levelcache.h"
+#include "sparse.h"
+#include "parallel.h"
+#include "serialize.h"
 
 /**
  * @brief [TODO] Conduct operation matrix simulation of a quantum circuit
  * 
  * @param sv the state vector
  * @param qc a quantum circuit
+ * @param cache an optional cache of level operators shared by identical levels
  * @return Matrix<DTYPE> the operation matrix
  */
-Matrix<DTYPE> OMSim(Matrix<DTYPE>& sv, QCircuit& qc);
+Matrix<DTYPE> OMSim(Matrix<DTYPE>& sv, QCircuit& qc, LevelCache* cache = nullptr);
+
+/**
+ * @brief Conduct operation matrix simulation by column-wise state-vector propagation
+ * 
+ * All 2^n basis vectors (the columns of the identity) are pushed through the 
+ * in-place gate kernels as a batch. Each worker owns a contiguous column tile. 
+ * The cost is O(#gates * 4^n) without any per-level 2^n * 2^n temporaries. 
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return Matrix<DTYPE> the operation matrix
+ */
+Matrix<DTYPE> OMSimColumnwise(Matrix<DTYPE>& sv, QCircuit& qc, int numThreads = 0);
+
+/**
+ * @brief Conduct operation matrix simulation with sparse level operators
+ * 
+ * The level operators are built as sparse matrices. The operation matrix is 
+ * accumulated as a MonomialMatrix while every level is monomial (e.g., Clifford 
+ * gates without H), then as a CSR matrix, and it switches to a dense matrix 
+ * once its density exceeds the threshold. 
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ * @param threshold the density above which the accumulation becomes dense
+ * @return SparseMatrix<DTYPE> the operation matrix
+ */
+SparseMatrix<DTYPE> OMSimSparse(Matrix<DTYPE>& sv, QCircuit& qc, double threshold = 0.1);
+
+struct TreeStats {
+    int numLevels; // the leaves of the product tree, repeated blocks counted once
+    ll numProducts; // the 2^n * 2^n matrix products
+    int height; // the height of the product tree
+    int peakLive; // the max 2^n * 2^n matrices live at once
+    int maxLive; // the cap on peakLive
+    double seconds;
+
+    void print();
+};
+
+/**
+ * @brief Conduct operation matrix simulation by a parallel product tree of the level operators
+ * 
+ * The workers build the level operators (the producer stage) and multiply 
+ * adjacent partial products [l, m) and [m, r) into O_{r-1} ... O_l at the same 
+ * time. Pairs of equal height are multiplied first, so the products form a 
+ * balanced tree of height about log2(#levels) instead of a serial chain, and 
+ * the rows of a product are split across the idle workers near the root. A 
+ * level is only built when it leaves room for a product under maxLive, and 
+ * pairs of any height are multiplied once every level is built or the cap is 
+ * reached. Repeated blocks are leaves O_body^count. 
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param maxLive the max 2^n * 2^n matrices live at once, at least 3, 0 means 3 per thread
+ * @param cache an optional cache of level operators shared by identical levels
+ * @param stats optional tree statistics
+ * @return Matrix<DTYPE> the operation matrix
+ */
+Matrix<DTYPE> OMSimTree(Matrix<DTYPE>& sv, QCircuit& qc, int numThreads = 0, int maxLive = 0, LevelCache* cache = nullptr,
+                        TreeStats* stats = nullptr);
+
+/**
+ * @brief Conduct state vector simulation of a quantum circuit with the in-place gate kernels
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ */
+void SVSim(Matrix<DTYPE>& sv, QCircuit& qc);
+
+/**
+ * @brief Conduct state vector simulation with a checkpoint every interval levels
+ * 
+ * If path holds a checkpoint of the same circuit and input state, the simulation 
+ * resumes from it. The checkpoint is removed once the simulation completes. 
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ * @param path the checkpoint file
+ * @param interval the number of levels between two checkpoints
+ * @param compress whether to zero-run encode the checkpoints
+ */
+void SVSimCheckpointed(Matrix<DTYPE>& sv, QCircuit& qc, const string& path, int interval = 16, bool compress = false);
+
+/**
+ * @brief Conduct column-wise operation matrix simulation with a checkpoint every interval levels
+ * 
+ * The checkpoint holds the product of the levels applied so far. If path holds 
+ * a checkpoint of the same circuit, the simulation resumes from it. The 
+ * checkpoint is removed once the simulation completes. 
+ * 
+ * @param sv the state vector
+ * @param qc a quantum circuit
+ * @param path the checkpoint file
+ * @param interval the number of levels between two checkpoints
+ * @param compress whether to zero-run encode the checkpoints
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return Matrix<DTYPE> the operation matrix
+ */
+Matrix<DTYPE> OMSimCheckpointed(Matrix<DTYPE>& sv, QCircuit& qc, const string& path, int interval = 16, bool compress = false, int numThreads = 0);
 
 //
 // Utility functions
 //
 
+/**
+ * @brief Get a complete gate matrix according to the applied qubits, in the sparse format
+ * 
+ * @param gate the processing gate
+ * @return SparseMatrix<DTYPE> a complete gate matrix
+ */
+SparseMatrix<DTYPE> getCompleteSparseMatrix(QGate& gate);
+
+/**
+ * @brief Generate the gate matrix of a 2-qubit controlled gate, in the sparse format
+ * 
+ * @param gate the processing gate
+ * @return SparseMatrix<DTYPE> a complete gate matrix
+ */
+SparseMatrix<DTYPE> genControlledGateSparse(QGate& gate);
+
+/**
+ * @brief Generate the gate matrix of a SWAP gate, in the sparse format
+ * 
+ * @param gate the processing SWAP gate
+ * @return SparseMatrix<DTYPE> a complete gate matrix
+ */
+SparseMatrix<DTYPE> genSwapGateSparse(QGate& gate);
+
+/**
+ * @brief Get the 2^n * 2^n operator of a level, in the sparse format
+ * 
+ * @param level the processing level
+ * @return SparseMatrix<DTYPE> the tensor product of the complete gate matrices, high-order qubits first
+ */
+SparseMatrix<DTYPE> getLevelSparse(vector<QGate>& level);
+
+/**
+ * @brief Get the 2^n * 2^n operator of a level
+ * 
+ * The operator is built by applying the level's gates to the identity with the 
+ * in-place gate kernels. With a cache, identical levels share one operator. 
+ * 
+ * @param level the processing level
+ * @param cache an optional cache of level operators
+ * @return shared_ptr<Matrix<DTYPE>> the level operator
+ */
+shared_ptr<Matrix<DTYPE>> getLevelMatrix(vector<QGate>& level, LevelCache* cache = nullptr);
+
+/**
+ * @brief Cache the operation matrices O_body^count of the repeated blocks of a circuit
+ * 
+ * A block is cached only if raising its matrix to the count-th power by repeated 
+ * squaring, O(log(count) * 8^n), is cheaper than applying its gates count times 
+ * to ncols columns, O(count * #gates * 2^n * ncols). 
+ * 
+ * @param qc a quantum circuit
+ * @param ncols the number of columns the repeated blocks will be applied to
+ * @param numThreads the number of threads, 0 means all hardware threads
+ */
+void cacheRepeatMatrices(QCircuit& qc, ll ncols, int numThreads = 0);
+
 /**
  * @brief [TODO] Get a complete gate matrix according to the applied qubits
  * 
@@ -0,0 +1,352 @@
+#include "optimize.h"
+
+#define OPT_EPS 1e-12 // a merged rotation closer than this to the identity is removed
+
+// A gate of the circuit in program order, or a repeated block
+struct OptGate {
+    QGate gate;
+    vector<int> qubits; // the qubits the gate acts on, all qubits for a repeated block
+    int repeat; // the level of the repeated block in the input circuit, -1 for a gate
+    bool alive;
+};
+
+/**
+ * @brief Return the basis in which a gate acts diagonally on a qubit
+ *
+ * @param g the gate
+ * @param qid a qubit of the gate
+ * @return char 'Z' for Z, RZ, controls and CZ, 'X' for X, RX and the CX target, 'N' otherwise
+ */
+static char diagonalBasis(OptGate& g, int qid) {
+    if (g.repeat >= 0) {
+        return 'N';
+    }
+    QGate& gate = g.gate;
+    if (gate.isControlQubit(qid)) {
+        return 'Z';
+    }
+    const string& name = gate.gname;
+    if (name == "Z" || name == "RZ" || name == "CZ") {
+        return 'Z';
+    }
+    if (name == "X" || name == "RX" || name == "CX") {
+        return 'X';
+    }
+    return 'N';
+}
+
+// Check if two gates commute: on every shared qubit both are diagonal in the same basis
+static bool commute(OptGate& a, OptGate& b) {
+    for (int q : a.qubits) {
+        if (find(b.qubits.begin(), b.qubits.end(), q) == b.qubits.end()) {
+            continue;
+        }
+        char ta = diagonalBasis(a, q);
+        if (ta == 'N' || ta != diagonalBasis(b, q)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check if a 2x2 matrix is the identity
+static bool isIdentity(Matrix<DTYPE>& m) {
+    return abs(m.data[0][0] - 1.0) < OPT_EPS && abs(m.data[1][1] - 1.0) < OPT_EPS
+        && abs(m.data[0][1]) < OPT_EPS && abs(m.data[1][0]) < OPT_EPS;
+}
+
+// Check if b undoes a: the same self-inverse gate on the same qubits
+static bool isInversePair(OptGate& a, OptGate& b) {
+    static const set<string> selfInverse = {"H", "X", "Y", "Z", "CX", "CY", "CZ", "CH", "SWAP"};
+    if (a.repeat >= 0 || b.repeat >= 0 || a.gate.gname != b.gate.gname || selfInverse.count(a.gate.gname) == 0) {
+        return false;
+    }
+    if (a.gate.gname == "CZ" || a.gate.gname == "SWAP") { // symmetric in its qubits
+        vector<int> qa = a.qubits, qb = b.qubits;
+        sort(qa.begin(), qa.end());
+        sort(qb.begin(), qb.end());
+        return qa == qb;
+    }
+    return a.gate.controlQubits == b.gate.controlQubits && a.gate.targetQubits == b.gate.targetQubits;
+}
+
+// Check if a and b are rotations on the same axis and qubit
+static bool isRotationPair(OptGate& a, OptGate& b) {
+    const string& name = a.gate.gname;
+    return a.repeat < 0 && b.repeat < 0 && (name == "RX" || name == "RY" || name == "RZ")
+        && name == b.gate.gname && a.gate.targetQubits == b.gate.targetQubits;
+}
+
+/**
+ * @brief The gates of a circuit in program order, with the gates on each qubit
+ */
+class GateList {
+public:
+    vector<OptGate> ops;
+    vector<vector<int>> onQubit; // qubit -> the ids of the gates on it in program order
+    vector<vector<int>> slot; // gate id -> its position in onQubit[q] for each of its qubits
+
+    GateList(QCircuit& qc) {
+        onQubit.resize(qc.numQubits);
+        for (int j = 0; j < qc.numDepths; ++ j) {
+            if (qc.isRepeat(j)) {
+                OptGate op;
+                op.repeat = j;
+                for (int q = 0; q < qc.numQubits; ++ q) {
+                    op.qubits.push_back(q);
+                }
+                push(op);
+                continue;
+            }
+            for (auto& gate : qc.gates[j]) {
+                if (gate.isIDE() || gate.isMARK()) {
+                    continue;
+                }
+                OptGate op;
+                op.gate = gate;
+                op.repeat = -1;
+                op.qubits = gate.controlQubits;
+                op.qubits.insert(op.qubits.end(), gate.targetQubits.begin(), gate.targetQubits.end());
+                push(op);
+            }
+        }
+    }
+
+    void push(OptGate& op) {
+        op.alive = true;
+        int id = ops.size();
+        slot.push_back({});
+        for (int q : op.qubits) {
+            slot[id].push_back(onQubit[q].size());
+            onQubit[q].push_back(id);
+        }
+        ops.push_back(op);
+    }
+
+    // Return the last alive gate on qubit q before position pos of onQubit[q], or -1
+    int previousOn(int q, int pos) {
+        for (-- pos; pos >= 0; -- pos) {
+            if (ops[onQubit[q][pos]].alive) {
+                return onQubit[q][pos];
+            }
+        }
+        return -1;
+    }
+
+    // Return the position of gate id in onQubit[q]
+    int position(int id, int q) {
+        OptGate& op = ops[id];
+        for (size_t k = 0; k < op.qubits.size(); ++ k) {
+            if (op.qubits[k] == q) {
+                return slot[id][k];
+            }
+        }
+        return -1;
+    }
+};
+
+/**
+ * @brief Rewrite h(t).cz(c,t).h(t) into cx(c,t) and h(t).cx(c,t).h(t) into cz(c,t), ending at gate i
+ *
+ * The three gates must be consecutive on qubit t, so the first H can be moved
+ * forward and the last H backward to the two-qubit gate.
+ *
+ * @param list the gate list
+ * @param i the id of the last H
+ * @return true if the pattern was rewritten
+ */
+static bool rewriteHadamardPattern(GateList& list, int i) {
+    OptGate& last = list.ops[i];
+    if (last.repeat >= 0 || last.gate.gname != "H") {
+        return false;
+    }
+    int t = last.qubits[0];
+    int k = list.previousOn(t, list.position(i, t));
+    if (k < 0 || (list.ops[k].gate.gname != "CZ" && list.ops[k].gate.gname != "CX") || list.ops[k].repeat >= 0) {
+        return false;
+    }
+    QGate& mid = list.ops[k].gate;
+    if (mid.gname == "CX" && mid.targetQubits[0] != t) {
+        return false;
+    }
+    int j = list.previousOn(t, list.position(k, t));
+    if (j < 0 || list.ops[j].repeat >= 0 || list.ops[j].gate.gname != "H") {
+        return false;
+    }
+    int c = list.ops[k].qubits[0] == t ? list.ops[k].qubits[1] : list.ops[k].qubits[0];
+    string name = mid.gname == "CZ" ? "CX" : "CZ";
+    mid.gname = name;
+    mid.controlQubits = {c};
+    mid.targetQubits = {t};
+    mid.gmat = Matrix<DTYPE>::findMatrix(name);
+    list.ops[j].alive = false;
+    last.alive = false;
+    return true;
+}
+
+/**
+ * @brief Move gate i back through the commuting gates and cancel or merge it
+ *
+ * @param list the gate list
+ * @param i the gate id
+ * @param window the max number of earlier gates to move through
+ * @param stats the counters to update
+ * @return true if gate i was cancelled or merged
+ */
+static bool cancelOrMerge(GateList& list, int i, int window, OptimizeStats& stats) {
+    OptGate& cur = list.ops[i];
+    if (cur.repeat >= 0) {
+        return false;
+    }
+    vector<int> pos; // the scan position in onQubit[q] for each qubit of the gate
+    for (int q : cur.qubits) {
+        pos.push_back(list.position(i, q));
+    }
+    for (int steps = 0; steps < window; ) {
+        // the latest earlier gate on any qubit of cur
+        int p = -1;
+        for (size_t k = 0; k < cur.qubits.size(); ++ k) {
+            if (pos[k] > 0) {
+                p = max(p, list.onQubit[cur.qubits[k]][pos[k] - 1]);
+            }
+        }
+        if (p < 0) {
+            return false;
+        }
+        for (size_t k = 0; k < cur.qubits.size(); ++ k) {
+            if (pos[k] > 0 && list.onQubit[cur.qubits[k]][pos[k] - 1] == p) {
+                pos[k] --;
+            }
+        }
+        OptGate& prev = list.ops[p];
+        if (! prev.alive) {
+            continue;
+        }
+        steps ++;
+        if (isInversePair(prev, cur)) {
+            prev.alive = false;
+            cur.alive = false;
+            stats.cancelledPairs ++;
+            return true;
+        }
+        if (isRotationPair(prev, cur)) {
+            Matrix<DTYPE> merged = (*cur.gate.gmat) * (*prev.gate.gmat);
+            cur.alive = false;
+            if (isIdentity(merged)) {
+                prev.alive = false;
+                stats.cancelledPairs ++;
+            } else {
+                prev.gate.gmat = make_shared<Matrix<DTYPE>>(move(merged));
+                stats.mergedRotations ++;
+            }
+            return true;
+        }
+        if (! commute(prev, cur)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Optimize a quantum circuit in place with commutation-aware peephole rules
+ *
+ * @param qc the quantum circuit
+ * @param window the max number of earlier gates a gate is moved through
+ * @return OptimizeStats the gates and levels removed
+ */
+OptimizeStats optimizeCircuit(QCircuit& qc, int window) {
+    OptimizeStats stats;
+    stats.gatesBefore = qc.numGates();
+    stats.levelsBefore = qc.numDepths;
+    stats.cancelledPairs = 0;
+    stats.mergedRotations = 0;
+    stats.rewrittenPatterns = 0;
+
+    GateList list(qc);
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (size_t i = 0; i < list.ops.size(); ++ i) {
+            if (! list.ops[i].alive) {
+                continue;
+            }
+            if (rewriteHadamardPattern(list, i)) {
+                stats.rewrittenPatterns ++;
+                changed = true;
+            } else if (cancelOrMerge(list, i, window, stats)) {
+                changed = true;
+            }
+        }
+    }
+
+    // place the remaining gates as early as possible; a repeated block takes a level of its own
+    vector<int> nextFree(qc.numQubits, 0);
+    vector<int> levels(list.ops.size(), -1);
+    int depth = 1;
+    for (size_t i = 0; i < list.ops.size(); ++ i) {
+        OptGate& op = list.ops[i];
+        if (! op.alive) {
+            continue;
+        }
+        int start = *min_element(op.qubits.begin(), op.qubits.end());
+        int end = *max_element(op.qubits.begin(), op.qubits.end());
+        int level = 0;
+        for (int q = start; q <= end; ++ q) {
+            level = max(level, nextFree[q]);
+        }
+        for (int q = start; q <= end; ++ q) {
+            nextFree[q] = level + 1;
+        }
+        levels[i] = level;
+        depth = max(depth, level + 1);
+    }
+
+    QCircuit opt;
+    opt.numQubits = qc.numQubits;
+    opt.name = qc.name;
+    opt.numDepths = 0;
+    while (opt.numDepths < depth) {
+        opt.add_level();
+    }
+    for (size_t i = 0; i < list.ops.size(); ++ i) {
+        OptGate& op = list.ops[i];
+        if (! op.alive) {
+            continue;
+        }
+        vector<QGate>& level = opt.gates[levels[i]];
+        if (op.repeat >= 0) {
+            QRepeat rep = qc.repeats[op.repeat];
+            rep.body = make_shared<QCircuit>(*rep.body); // the body may be shared with other circuits
+            optimizeCircuit(*rep.body, window); // the body keeps its operation matrix, so powmat stays valid
+            opt.repeats[levels[i]] = rep;
+            continue;
+        }
+        QGate& gate = op.gate;
+        int start = *min_element(op.qubits.begin(), op.qubits.end());
+        int end = *max_element(op.qubits.begin(), op.qubits.end());
+        if (gate.gname == "SWAP") {
+            for (int q = start; q <= end; ++ q) {
+                level[q] = QGate("MARK", {}, {start, end});
+            }
+            level[end] = gate;
+        } else if (gate.controlQubits.size() > 0) {
+            for (int q = start; q <= end; ++ q) {
+                level[q] = QGate("MARK", gate.controlQubits, gate.targetQubits);
+            }
+            level[gate.targetQubits[0]] = gate;
+        } else {
+            level[gate.targetQubits[0]] = gate;
+        }
+    }
+    qc = opt;
+
+    stats.gatesAfter = qc.numGates();
+    stats.levelsAfter = qc.numDepths;
+    return stats;
+}
+
+void OptimizeStats::print() {
+    cout << "[INFO] [Optimize] gates: [" << gatesBefore << " -> " << gatesAfter << "] levels: [" << levelsBefore << " -> "
+         << levelsAfter << "] cancelledPairs: [" << cancelledPairs << "] mergedRotations: [" << mergedRotations
+         << "] rewrittenPatterns: [" << rewrittenPatterns << "]" << endl;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "qcircuit.h"
+
+struct OptimizeStats {
+    ll gatesBefore; // the number of gates, with repeated blocks expanded
+    ll gatesAfter;
+    int levelsBefore;
+    int levelsAfter;
+    ll cancelledPairs; // the number of inverse pairs removed
+    ll mergedRotations; // the number of rotations merged into an earlier one on the same axis
+    ll rewrittenPatterns; // the number of h.cz.h -> cx and h.cx.h -> cz rewrites
+
+    void print();
+};
+
+/**
+ * @brief Optimize a quantum circuit in place with commutation-aware peephole rules
+ *
+ * The gates are processed in order. Each gate is moved back through the earlier
+ * gates on its qubits for as long as it commutes with them. It is cancelled if
+ * it meets its inverse (H, X, Y, Z, CX, CY, CZ, CH, SWAP) and merged if it meets
+ * a rotation on the same axis. Two gates commute if on every shared qubit both
+ * act diagonally in the Z basis (Z, RZ, controls, CZ) or both act diagonally in
+ * the X basis (X, RX, the CX target). The pass also rewrites h(t).cz(c,t).h(t)
+ * into cx(c,t) and h(t).cx(c,t).h(t) into cz(c,t). It repeats until no rule applies.
+ *
+ * All rewrites preserve the operation matrix exactly. The gates are then placed
+ * into levels as early as possible. Repeated blocks are optimized recursively
+ * and act as barriers.
+ *
+ * @param qc the quantum circuit
+ * @param window the max number of earlier gates a gate is moved through
+ * @return OptimizeStats the gates and levels removed
+ */
+OptimizeStats optimizeCircuit(QCircuit& qc, int window = 64);
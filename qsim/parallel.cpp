@@ -0,0 +1,122 @@
+#include "parallel.h"
+
+/**
+ * @brief Get the number of worker threads to use
+ * 
+ * @param requested the requested number of threads, 0 means all hardware threads
+ * @return int the number of worker threads (at least 1)
+ */
+int numWorkers(int requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    int hw = thread::hardware_concurrency();
+    return hw > 0 ? hw : 1;
+}
+
+/**
+ * @brief Split [begin, end) into contiguous tiles and process each tile on its own thread
+ * 
+ * @param begin the first index
+ * @param end one past the last index
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param fn the tile function fn(tileBegin, tileEnd)
+ */
+void parallelFor(ll begin, ll end, int numThreads, const function<void(ll, ll)>& fn) {
+    parallelForTiles(tileBounds(begin, end, numThreads), [&](int, ll tileBegin, ll tileEnd) {
+        fn(tileBegin, tileEnd);
+    });
+}
+
+/**
+ * @brief Split [begin, end) into at most numThreads contiguous tiles
+ * 
+ * @param begin the first index
+ * @param end one past the last index
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return vector<ll> the tile bounds, tile w is [bounds[w], bounds[w+1])
+ */
+vector<ll> tileBounds(ll begin, ll end, int numThreads) {
+    ll total = end - begin;
+    vector<ll> bounds(1, begin);
+    if (total <= 0) {
+        return bounds;
+    }
+    // the first (total % workers) tiles get one extra index
+    ll workers = min((ll)numWorkers(numThreads), total);
+    ll tile = total / workers;
+    ll extra = total % workers;
+    for (ll w = 0; w < workers; ++ w) {
+        bounds.push_back(bounds.back() + tile + (w < extra ? 1 : 0));
+    }
+    return bounds;
+}
+
+/**
+ * @brief Process each tile on its own thread
+ * 
+ * @param bounds the tile bounds returned by tileBounds
+ * @param fn the tile function fn(tileId, tileBegin, tileEnd)
+ */
+void parallelForTiles(const vector<ll>& bounds, const function<void(int, ll, ll)>& fn) {
+    int workers = (int)bounds.size() - 1;
+    if (workers <= 0) {
+        return;
+    }
+    vector<thread> pool;
+    for (int w = 0; w < workers - 1; ++ w) {
+        pool.push_back(thread(fn, w, bounds[w], bounds[w+1]));
+    }
+    fn(workers - 1, bounds[workers - 1], bounds[workers]); // the calling thread takes the last tile
+    for (auto& t : pool) {
+        t.join();
+    }
+}
+
+/**
+ * @brief Run independent jobs on a work-stealing pool
+ * 
+ * @param jobs the job ids, non-negative
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param fn the job function fn(workerId, job)
+ * @return ll the number of stolen jobs
+ */
+ll parallelForStealing(const vector<ll>& jobs, int numThreads, const function<void(int, ll)>& fn) {
+    int workers = (int)min((ll)numWorkers(numThreads), (ll)jobs.size());
+    if (workers <= 0) {
+        return 0;
+    }
+    vector<deque<ll>> queues(workers);
+    vector<mutex> locks(workers);
+    for (size_t k = 0; k < jobs.size(); ++ k) {
+        queues[k % workers].push_back(jobs[k]);
+    }
+
+    atomic<ll> steals(0);
+    parallelForTiles(tileBounds(0, workers, workers), [&](int w, ll, ll) {
+        while (true) {
+            ll job = -1;
+            {
+                lock_guard<mutex> lock(locks[w]);
+                if (! queues[w].empty()) {
+                    job = queues[w].front();
+                    queues[w].pop_front();
+                }
+            }
+            // no job is ever added, so the pool is done once every deque is empty
+            for (int v = (w + 1) % workers; job < 0 && v != w; v = (v + 1) % workers) {
+                lock_guard<mutex> lock(locks[v]);
+                if (! queues[v].empty()) {
+                    job = queues[v].back();
+                    queues[v].pop_back();
+                    steals ++;
+                }
+            }
+            if (job < 0) {
+                return;
+            }
+            fn(w, job);
+        }
+    });
+    return steals;
+}
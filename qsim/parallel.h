@@ -0,0 +1,53 @@
+#pragma once
+
+#include "matrix.h"
+
+/**
+ * @brief Get the number of worker threads to use
+ * 
+ * @param requested the requested number of threads, 0 means all hardware threads
+ * @return int the number of worker threads (at least 1)
+ */
+int numWorkers(int requested = 0);
+
+/**
+ * @brief Split [begin, end) into contiguous tiles and process each tile on its own thread
+ * 
+ * @param begin the first index
+ * @param end one past the last index
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param fn the tile function fn(tileBegin, tileEnd)
+ */
+void parallelFor(ll begin, ll end, int numThreads, const function<void(ll, ll)>& fn);
+
+/**
+ * @brief Split [begin, end) into at most numThreads contiguous tiles
+ * 
+ * @param begin the first index
+ * @param end one past the last index
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return vector<ll> the tile bounds, tile w is [bounds[w], bounds[w+1])
+ */
+vector<ll> tileBounds(ll begin, ll end, int numThreads);
+
+/**
+ * @brief Process each tile on its own thread
+ * 
+ * @param bounds the tile bounds returned by tileBounds
+ * @param fn the tile function fn(tileId, tileBegin, tileEnd)
+ */
+void parallelForTiles(const vector<ll>& bounds, const function<void(int, ll, ll)>& fn);
+
+/**
+ * @brief Run independent jobs on a work-stealing pool
+ * 
+ * The jobs are dealt round-robin in the given order to one deque per worker, 
+ * e.g., sorted by decreasing cost. Each worker takes jobs from the front of its 
+ * own deque and, once it is empty, steals from the back of the other deques. 
+ * 
+ * @param jobs the job ids, non-negative
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param fn the job function fn(workerId, job)
+ * @return ll the number of stolen jobs
+ */
+ll parallelForStealing(const vector<ll>& jobs, int numThreads, const function<void(int, ll)>& fn);
@@ -0,0 +1,296 @@
+#include "planner.h"
+#include "soa.h"
+#include "tensornet.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define PLAN_SIMD_SPEEDUP 2.0 // the expected speedup of the SoA kernels when SIMD is available
+
+// Return the bytes of a dense Matrix<DTYPE>
+static double denseBytes(double rows, double cols) {
+    return rows * cols * sizeof(DTYPE) + rows * sizeof(DTYPE*);
+}
+
+// Return the bytes of an SoAMatrix
+static double soaBytes(double rows, double cols) {
+    return rows * cols * 2 * sizeof(double);
+}
+
+// Return a byte count with a binary unit, e.g., 64 GiB
+static string formatBytes(double bytes) {
+    const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB", "PiB"};
+    int u = 0;
+    while (bytes >= 1024 && u < 5) {
+        bytes /= 1024;
+        ++ u;
+    }
+    ostringstream out;
+    out << setprecision(bytes < 10 ? 2 : 3) << bytes << " " << units[u];
+    return out.str();
+}
+
+// Check if a single-qubit or controlled gate matrix has one nonzero per row
+static bool isMonomialGate(QGate& gate) {
+    if (gate.gname == "SWAP") {
+        return true;
+    }
+    Matrix<DTYPE>& u = *gate.gmat;
+    return (u.data[0][1] == DTYPE(0) && u.data[1][0] == DTYPE(0)) || (u.data[0][0] == DTYPE(0) && u.data[1][1] == DTYPE(0));
+}
+
+// Return the number of levels with repeated blocks expanded
+static ll expandedDepth(QCircuit& qc) {
+    ll depth = 0;
+    for (int j = 0; j < qc.numDepths; ++ j) {
+        depth += qc.isRepeat(j) ? qc.repeats[j].count * expandedDepth(*qc.repeats[j].body) : 1;
+    }
+    return depth;
+}
+
+/**
+ * @brief Profile the size, gate mix and connectivity of a quantum circuit
+ *
+ * @param qc the quantum circuit
+ * @return CircuitProfile the profile
+ */
+CircuitProfile profileCircuit(QCircuit& qc) {
+    CircuitProfile profile;
+    profile.numQubits = qc.numQubits;
+    profile.numDepths = expandedDepth(qc);
+    profile.numGates = 0;
+    profile.numSingle = 0;
+    profile.numControlled = 0;
+    profile.numSwap = 0;
+    profile.monomialOnly = true;
+    profile.maxSpan = 0;
+    set<pair<int, int>> pairs;
+    for (auto& gate : qc.flatGates()) {
+        profile.numGates ++;
+        if (gate.gname == "SWAP") {
+            profile.numSwap ++;
+        } else if (gate.isSingle()) {
+            profile.numSingle ++;
+        } else {
+            profile.numControlled ++;
+        }
+        profile.monomialOnly = profile.monomialOnly && isMonomialGate(gate);
+        vector<int> qubits = gate.controlQubits;
+        qubits.insert(qubits.end(), gate.targetQubits.begin(), gate.targetQubits.end());
+        if (qubits.size() == 2) {
+            int a = min(qubits[0], qubits[1]);
+            int b = max(qubits[0], qubits[1]);
+            pairs.insert(make_pair(a, b));
+            profile.maxSpan = max(profile.maxSpan, b - a);
+        }
+    }
+    profile.numPairs = pairs.size();
+    return profile;
+}
+
+// Return the multiply-adds per column of one pass over the gates
+static double flopsPerColumn(CircuitProfile& profile, double dim) {
+    // a 2x2 gate updates dim/2 pairs with 4 multiply-adds, a controlled one half of them
+    return (2.0 * profile.numSingle + 1.0 * profile.numControlled) * dim;
+}
+
+static MethodEstimate makeEstimate(const string& method, double bytes, double flops, double speedup, ll budget, const string& note) {
+    MethodEstimate e;
+    e.method = method;
+    e.bytes = bytes;
+    e.flops = flops;
+    e.work = flops / speedup;
+    e.fits = bytes <= budget;
+    e.note = note;
+    return e;
+}
+
+/**
+ * @brief Estimate each simulation method for a circuit and output, and pick the cheapest that fits
+ *
+ * @param qc the quantum circuit
+ * @param output the requested output
+ * @param memoryBudget the memory budget in bytes, 0 means half of the physical memory
+ * @param numAmplitudes the number of amplitudes, for OUTPUT_AMPLITUDES
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return SimPlan the estimates and the choice
+ */
+SimPlan planSimulation(QCircuit& qc, SimOutput output, ll memoryBudget, ll numAmplitudes, int numThreads) {
+    SimPlan plan;
+    plan.profile = profileCircuit(qc);
+    plan.output = output;
+    plan.memoryBudget = memoryBudget > 0 ? memoryBudget : defaultMemoryBudget();
+    CircuitProfile& p = plan.profile;
+    ll budget = plan.memoryBudget;
+    double dim = ldexp(1.0, p.numQubits);
+    double simd = string(soaKernelName()) == "scalar" ? 1.0 : PLAN_SIMD_SPEEDUP;
+    string simdNote = string(soaKernelName()) + " kernels";
+
+    if (output == OUTPUT_OPMAT) {
+        double flops = flopsPerColumn(p, dim) * dim;
+        plan.estimates.push_back(makeEstimate("OMSimColumnwise", denseBytes(dim, dim) + denseBytes(dim, 1), flops, 1, budget,
+                                              "2^n columns through the in-place kernels"));
+        plan.estimates.push_back(makeEstimate("OMSimSoA", soaBytes(dim, dim) + denseBytes(dim, dim) + denseBytes(dim, 1), flops, simd, budget,
+                                              simdNote + ", converted to Matrix at the end"));
+        if (p.monomialOnly) {
+            // a monomial matrix holds one entry and one row index per column
+            double mono = dim * (sizeof(DTYPE) + sizeof(ll));
+            plan.estimates.push_back(makeEstimate("OMSimSparse", 3 * mono + denseBytes(dim, 1), p.numDepths * dim, 1, budget,
+                                                  "every gate is monomial, so U stays monomial"));
+        }
+    } else {
+        // the state methods also serve samples, expectations and amplitudes
+        double extra = output == OUTPUT_SAMPLES ? dim * sizeof(double) : 0; // the sampling weights
+        double flops = flopsPerColumn(p, dim);
+        plan.estimates.push_back(makeEstimate("SVSim", denseBytes(dim, 1) + extra, flops, 1, budget, "in-place gate kernels"));
+        plan.estimates.push_back(makeEstimate("SVSimSoA", soaBytes(dim, 1) + 2 * denseBytes(dim, 1) + extra, flops, simd, budget, simdNote));
+        if (output == OUTPUT_AMPLITUDES && p.numQubits <= 62) {
+            TNStats stats;
+            bool fits = tnEstimate(qc, budget, numThreads, stats);
+            ostringstream note;
+            note << "max rank " << stats.maxRank << ", " << stats.numSlices << " slice(s)";
+            MethodEstimate e = makeEstimate("tnAmplitudes", stats.peakBytes, stats.flops * numAmplitudes, 1, budget, note.str());
+            e.fits = fits;
+            plan.estimates.push_back(e);
+        }
+    }
+
+    plan.chosen = -1;
+    for (size_t i = 0; i < plan.estimates.size(); ++ i) {
+        MethodEstimate& e = plan.estimates[i];
+        if (! e.fits) {
+            continue;
+        }
+        if (plan.chosen < 0 || e.work < plan.estimates[plan.chosen].work
+            || (e.work == plan.estimates[plan.chosen].work && e.bytes < plan.estimates[plan.chosen].bytes)) {
+            plan.chosen = i;
+        }
+    }
+
+    ostringstream reason;
+    if (plan.chosen >= 0) {
+        int numFit = 0;
+        for (auto& e : plan.estimates) {
+            numFit += e.fits;
+        }
+        MethodEstimate& e = plan.estimates[plan.chosen];
+        reason << e.method << " needs " << formatBytes(e.bytes) << " of the " << formatBytes(budget) << " budget and has the least work ("
+               << e.work << ") among the " << numFit << " of " << plan.estimates.size() << " methods that fit";
+    } else {
+        int smallest = 0;
+        for (size_t i = 1; i < plan.estimates.size(); ++ i) {
+            if (plan.estimates[i].bytes < plan.estimates[smallest].bytes) {
+                smallest = i;
+            }
+        }
+        reason << "no method fits in " << formatBytes(budget) << "; the smallest, " << plan.estimates[smallest].method << ", needs "
+               << formatBytes(plan.estimates[smallest].bytes);
+    }
+    plan.reason = reason.str();
+    return plan;
+}
+
+/**
+ * @brief Conduct state vector simulation with the method chosen by planSimulation
+ *
+ * Exits with an error instead of running out of memory if no method fits.
+ *
+ * @param sv the state vector, mat.row = 2^numQubits
+ * @param qc the quantum circuit
+ * @param memoryBudget the memory budget in bytes, 0 means half of the physical memory
+ * @return SimPlan the plan that was run
+ */
+SimPlan SVSimAuto(Matrix<DTYPE>& sv, QCircuit& qc, ll memoryBudget) {
+    SimPlan plan = planSimulation(qc, OUTPUT_STATE, memoryBudget);
+    if (plan.chosen < 0) {
+        cout << "[ERROR] SVSimAuto: " << plan.reason << endl;
+        exit(1);
+    }
+    if (sv.row != (1LL << qc.numQubits)) {
+        cout << "[ERROR] SVSimAuto: sv.row != 2^numQubits. " << endl;
+        exit(1);
+    }
+    cout << "[INFO] [Planner] " << plan.reason << endl;
+    if (plan.estimates[plan.chosen].method == "SVSimSoA") {
+        SVSimSoA(sv, qc);
+    } else {
+        SVSim(sv, qc);
+    }
+    return plan;
+}
+
+/**
+ * @brief Compute a few amplitudes <x|U|0...0> with the method chosen by planSimulation
+ *
+ * Exits with an error instead of running out of memory if no method fits.
+ *
+ * @param qc the quantum circuit
+ * @param bitstrings the bitstrings x, bit q of x is the value of qubit q
+ * @param memoryBudget the memory budget in bytes, 0 means half of the physical memory
+ * @param plan optional, the plan that was run
+ * @return vector<DTYPE> the amplitudes, in the order of bitstrings
+ */
+vector<DTYPE> amplitudesAuto(QCircuit& qc, const vector<ll>& bitstrings, ll memoryBudget, SimPlan* plan) {
+    SimPlan chosen = planSimulation(qc, OUTPUT_AMPLITUDES, memoryBudget, bitstrings.size());
+    if (plan != nullptr) {
+        *plan = chosen;
+    }
+    if (chosen.chosen < 0) {
+        cout << "[ERROR] amplitudesAuto: " << chosen.reason << endl;
+        exit(1);
+    }
+    cout << "[INFO] [Planner] " << chosen.reason << endl;
+    const string& method = chosen.estimates[chosen.chosen].method;
+    if (method == "tnAmplitudes") {
+        return tnAmplitudes(qc, bitstrings, chosen.memoryBudget);
+    }
+    Matrix<DTYPE> sv(1LL << qc.numQubits, 1);
+    sv.data[0][0] = 1;
+    if (method == "SVSimSoA") {
+        SVSimSoA(sv, qc);
+    } else {
+        SVSim(sv, qc);
+    }
+    vector<DTYPE> amps;
+    for (ll x : bitstrings) {
+        if (x < 0 || x >= sv.row) {
+            cout << "[ERROR] amplitudesAuto: bitstring " << x << " out of range. " << endl;
+            exit(1);
+        }
+        amps.push_back(sv.data[x][0]);
+    }
+    return amps;
+}
+
+/**
+ * @brief Return half of the physical memory in bytes, the default memory budget
+ */
+ll defaultMemoryBudget() {
+#ifndef _WIN32
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGE_SIZE);
+    if (pages > 0 && pageSize > 0) {
+        return (ll)pages * pageSize / 2;
+    }
+#endif
+    return 1LL << 32;
+}
+
+void CircuitProfile::print() {
+    cout << "[INFO] [Profile] qubits: [" << numQubits << "] depth: [" << numDepths << "] gates: [" << numGates << "] single: ["
+         << numSingle << "] controlled: [" << numControlled << "] swap: [" << numSwap
+         << "] monomial: [" << monomialOnly << "] pairs: [" << numPairs << "] maxSpan: [" << maxSpan << "]" << endl;
+}
+
+void SimPlan::print() {
+    const char* outputs[] = {"opmat", "state", "samples", "expectation", "amplitudes"};
+    profile.print();
+    cout << "[INFO] [Planner] output: [" << outputs[output] << "] budget: [" << formatBytes(memoryBudget) << "]" << endl;
+    for (size_t i = 0; i < estimates.size(); ++ i) {
+        MethodEstimate& e = estimates[i];
+        cout << "[INFO] [Planner] " << ((int)i == chosen ? "* " : "  ") << e.method << " memory: [" << formatBytes(e.bytes)
+             << "] flops: [" << e.flops << "] work: [" << e.work << "] fits: [" << e.fits << "] (" << e.note << ")" << endl;
+    }
+    cout << "[INFO] [Planner] " << reason << endl;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "omsim.h"
+
+//
+// Resource estimation and backend selection
+//
+// planSimulation profiles a circuit, estimates the memory and the work of each
+// simulation method that can produce the requested output, and picks the one
+// with the least work among those that fit the memory budget. The estimates
+// count the dense entries and the row pointers of Matrix<DTYPE>. The work is
+// the complex multiply-adds, divided by a speedup for the SIMD kernels of the
+// SoA layout.
+//
+
+enum SimOutput {
+    OUTPUT_OPMAT, // the operation matrix
+    OUTPUT_STATE, // the final state vector
+    OUTPUT_SAMPLES, // measurement samples of the final state
+    OUTPUT_EXPECTATION, // the expectation value of an observable
+    OUTPUT_AMPLITUDES // a few amplitudes <x|U|0...0>
+};
+
+struct CircuitProfile {
+    int numQubits;
+    int numDepths; // the number of levels, repeated blocks expanded
+    ll numGates; // repeated blocks expanded
+    ll numSingle; // single-qubit gates
+    ll numControlled; // 2-qubit controlled gates
+    ll numSwap;
+    bool monomialOnly; // only gates with one nonzero per row, e.g., X, Z, RZ, CX, CZ, SWAP
+    int numPairs; // the distinct qubit pairs coupled by 2-qubit gates
+    int maxSpan; // the max distance between the qubits of a 2-qubit gate
+
+    void print();
+};
+
+struct MethodEstimate {
+    string method; // the function that runs the method
+    double bytes; // the peak memory
+    double flops; // the complex multiply-adds
+    double work; // flops divided by the expected speedup
+    bool fits; // bytes <= the memory budget
+    string note;
+};
+
+struct SimPlan {
+    CircuitProfile profile;
+    SimOutput output;
+    ll memoryBudget;
+    vector<MethodEstimate> estimates;
+    int chosen; // the index of the chosen estimate, -1 if none fits
+    string reason; // why the method was chosen, or why none fits
+
+    void print();
+};
+
+/**
+ * @brief Profile the size, gate mix and connectivity of a quantum circuit
+ *
+ * @param qc the quantum circuit
+ * @return CircuitProfile the profile
+ */
+CircuitProfile profileCircuit(QCircuit& qc);
+
+/**
+ * @brief Estimate each simulation method for a circuit and output, and pick the cheapest that fits
+ *
+ * @param qc the quantum circuit
+ * @param output the requested output
+ * @param memoryBudget the memory budget in bytes, 0 means half of the physical memory
+ * @param numAmplitudes the number of amplitudes, for OUTPUT_AMPLITUDES
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return SimPlan the estimates and the choice
+ */
+SimPlan planSimulation(QCircuit& qc, SimOutput output, ll memoryBudget = 0, ll numAmplitudes = 1, int numThreads = 0);
+
+/**
+ * @brief Conduct state vector simulation with the method chosen by planSimulation
+ *
+ * Exits with an error instead of running out of memory if no method fits.
+ *
+ * @param sv the state vector, mat.row = 2^numQubits
+ * @param qc the quantum circuit
+ * @param memoryBudget the memory budget in bytes, 0 means half of the physical memory
+ * @return SimPlan the plan that was run
+ */
+SimPlan SVSimAuto(Matrix<DTYPE>& sv, QCircuit& qc, ll memoryBudget = 0);
+
+/**
+ * @brief Compute a few amplitudes <x|U|0...0> with the method chosen by planSimulation
+ *
+ * Exits with an error instead of running out of memory if no method fits.
+ *
+ * @param qc the quantum circuit
+ * @param bitstrings the bitstrings x, bit q of x is the value of qubit q
+ * @param memoryBudget the memory budget in bytes, 0 means half of the physical memory
+ * @param plan optional, the plan that was run
+ * @return vector<DTYPE> the amplitudes, in the order of bitstrings
+ */
+vector<DTYPE> amplitudesAuto(QCircuit& qc, const vector<ll>& bitstrings, ll memoryBudget = 0, SimPlan* plan = nullptr);
+
+/**
+ * @brief Return half of the physical memory in bytes, the default memory budget
+ */
+ll defaultMemoryBudget();
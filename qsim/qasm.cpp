@@ -0,0 +1,766 @@
+#include "qasm.h"
+#include "parallel.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define QASM_MAX_QUBITS 62 // the qubits of all qregs, so that amplitude indices fit in ll
+
+//
+// Tokens
+//
+
+enum TokenType { TOK_END, TOK_IDENT, TOK_NUMBER, TOK_STRING, TOK_ARROW, TOK_EQ, TOK_SYMBOL };
+
+struct Token {
+    TokenType type;
+    const char* p; // points into the source buffer
+    int len;
+    int line;
+    double num; // the value of a TOK_NUMBER
+
+    bool is(char c) const { return type == TOK_SYMBOL && *p == c; }
+    bool is(const char* word) const { return type == TOK_IDENT && (int)strlen(word) == len && strncmp(p, word, len) == 0; }
+    string str() const { return string(p, len); }
+};
+
+// A source of tokens: the lexer over the whole file, or the stored body of a gate definition
+class TokenStream {
+public:
+    virtual Token next() = 0;
+    virtual Token peek() = 0;
+    virtual ~TokenStream() {}
+};
+
+// The lexer, scanning the source buffer without copying it
+class Lexer : public TokenStream {
+private:
+    const char* cur;
+    const char* end;
+    int line;
+    Token ahead;
+    bool hasAhead;
+
+    Token scan() {
+        // skip whitespaces and comments
+        while (cur < end) {
+            if (*cur == '\n') {
+                ++ line;
+                ++ cur;
+            } else if (isspace((unsigned char)*cur)) {
+                ++ cur;
+            } else if (cur + 1 < end && cur[0] == '/' && cur[1] == '/') {
+                while (cur < end && *cur != '\n') ++ cur;
+            } else if (cur + 1 < end && cur[0] == '/' && cur[1] == '*') {
+                cur += 2;
+                while (cur + 1 < end && ! (cur[0] == '*' && cur[1] == '/')) {
+                    if (*cur == '\n') ++ line;
+                    ++ cur;
+                }
+                cur = min(cur + 2, end);
+            } else {
+                break;
+            }
+        }
+        Token tok;
+        tok.p = cur;
+        tok.len = 0;
+        tok.line = line;
+        tok.num = 0;
+        if (cur >= end) {
+            tok.type = TOK_END;
+            return tok;
+        }
+        char c = *cur;
+        if (isalpha((unsigned char)c) || c == '_') {
+            while (cur < end && (isalnum((unsigned char)*cur) || *cur == '_')) ++ cur;
+            tok.type = TOK_IDENT;
+        } else if (isdigit((unsigned char)c) || (c == '.' && cur + 1 < end && isdigit((unsigned char)cur[1]))) {
+            // the buffer is not null-terminated, so find the end of the number before strtod
+            const char* q = cur;
+            while (q < end && (isdigit((unsigned char)*q) || *q == '.')) ++ q;
+            if (q < end && (*q == 'e' || *q == 'E')) {
+                const char* e = q + 1;
+                if (e < end && (*e == '+' || *e == '-')) ++ e;
+                if (e < end && isdigit((unsigned char)*e)) {
+                    q = e;
+                    while (q < end && isdigit((unsigned char)*q)) ++ q;
+                }
+            }
+            string digits(cur, q);
+            tok.num = strtod(digits.c_str(), nullptr);
+            cur = q;
+            tok.type = TOK_NUMBER;
+        } else if (c == '"') {
+            ++ cur;
+            while (cur < end && *cur != '"') ++ cur;
+            cur = min(cur + 1, end);
+            tok.type = TOK_STRING;
+        } else if (c == '-' && cur + 1 < end && cur[1] == '>') {
+            cur += 2;
+            tok.type = TOK_ARROW;
+        } else if (c == '=' && cur + 1 < end && cur[1] == '=') {
+            cur += 2;
+            tok.type = TOK_EQ;
+        } else {
+            ++ cur;
+            tok.type = TOK_SYMBOL;
+        }
+        tok.len = cur - tok.p;
+        return tok;
+    }
+
+public:
+    Lexer(const char* src, size_t len) : cur(src), end(src + len), line(1), hasAhead(false) {}
+
+    Token next() {
+        if (hasAhead) {
+            hasAhead = false;
+            return ahead;
+        }
+        return scan();
+    }
+
+    Token peek() {
+        if (! hasAhead) {
+            ahead = scan();
+            hasAhead = true;
+        }
+        return ahead;
+    }
+};
+
+// A stream over stored tokens
+class VectorStream : public TokenStream {
+private:
+    const vector<Token>& toks;
+    size_t pos;
+    Token endTok;
+
+public:
+    VectorStream(const vector<Token>& toks_, int line) : toks(toks_), pos(0) {
+        endTok.type = TOK_END;
+        endTok.p = "";
+        endTok.len = 0;
+        endTok.line = line;
+        endTok.num = 0;
+    }
+
+    Token next() { return pos < toks.size() ? toks[pos++] : endTok; }
+    Token peek() { return pos < toks.size() ? toks[pos] : endTok; }
+};
+
+//
+// Parser
+//
+
+// The built-in gates, i.e., the gates supported by MatrixDict and the rotations
+enum GateKind { G_H, G_X, G_Y, G_Z, G_RX, G_RY, G_RZ, G_CX, G_CY, G_CZ, G_CH, G_SWAP, G_ID };
+
+struct GateDef {
+    vector<string> params;
+    vector<string> args;
+    vector<Token> body;
+    int line;
+};
+
+static const string gateNames[] = {"H", "X", "Y", "Z", "RX", "RY", "RZ", "CX", "CY", "CZ", "CH", "SWAP", "IDE"};
+
+// A parse error, thrown by QASMParser::fail and caught only by tryParseQASM
+struct QASMError {
+    int line;
+    string msg;
+};
+
+// A gate placed at a level
+struct PlacedGate {
+    int level;
+    GateKind kind;
+    int q0; // target, or the control of a controlled gate, or the first qubit of a SWAP
+    int q1; // the target of a controlled gate, or the second qubit of a SWAP
+    int mat; // the index of the gate matrix in QASMParser::mats
+};
+
+class QASMParser {
+private:
+    map<string, pair<int, int>> qregs; // name -> (offset, size)
+    map<string, GateDef> defs;
+    vector<int> nextFree; // qubit -> the earliest level at which it is free
+    vector<PlacedGate> placed;
+    vector<shared_ptr<Matrix<DTYPE>>> mats; // the distinct gate matrices used by the placed gates
+    map<pair<int, double>, int> matIndex; // (gate kind, theta) -> index in mats
+    int depth;
+    int expandDepth;
+
+    // Abort the parse, tryParseQASM turns the error into a message
+    void fail(int line, const string& msg) {
+        throw QASMError{line, msg};
+    }
+
+    Token expect(TokenStream& ts, char c) {
+        Token tok = ts.next();
+        if (! tok.is(c)) {
+            fail(tok.line, string("expected '") + c + "' but got '" + tok.str() + "'");
+        }
+        return tok;
+    }
+
+    Token expectIdent(TokenStream& ts) {
+        Token tok = ts.next();
+        if (tok.type != TOK_IDENT) {
+            fail(tok.line, "expected an identifier but got '" + tok.str() + "'");
+        }
+        return tok;
+    }
+
+    void skipStatement(TokenStream& ts) {
+        Token tok = ts.next();
+        while (tok.type != TOK_END && ! tok.is(';')) {
+            tok = ts.next();
+        }
+    }
+
+    //
+    // Expressions
+    //
+
+    double parseExpr(TokenStream& ts, map<string, double>& env) {
+        double v = parseTerm(ts, env);
+        while (ts.peek().is('+') || ts.peek().is('-')) {
+            bool plus = ts.next().is('+');
+            double rhs = parseTerm(ts, env);
+            v = plus ? v + rhs : v - rhs;
+        }
+        return v;
+    }
+
+    double parseTerm(TokenStream& ts, map<string, double>& env) {
+        double v = parseFactor(ts, env);
+        while (ts.peek().is('*') || ts.peek().is('/')) {
+            bool mul = ts.next().is('*');
+            double rhs = parseFactor(ts, env);
+            v = mul ? v * rhs : v / rhs;
+        }
+        return v;
+    }
+
+    double parseFactor(TokenStream& ts, map<string, double>& env) {
+        double v = parseUnary(ts, env);
+        if (ts.peek().is('^')) {
+            ts.next();
+            v = pow(v, parseFactor(ts, env)); // right associative
+        }
+        return v;
+    }
+
+    double parseUnary(TokenStream& ts, map<string, double>& env) {
+        if (ts.peek().is('-')) {
+            ts.next();
+            return -parseUnary(ts, env);
+        }
+        if (ts.peek().is('+')) {
+            ts.next();
+            return parseUnary(ts, env);
+        }
+        return parsePrimary(ts, env);
+    }
+
+    double parsePrimary(TokenStream& ts, map<string, double>& env) {
+        Token tok = ts.next();
+        if (tok.type == TOK_NUMBER) {
+            return tok.num;
+        }
+        if (tok.is('(')) {
+            double v = parseExpr(ts, env);
+            expect(ts, ')');
+            return v;
+        }
+        if (tok.type != TOK_IDENT) {
+            fail(tok.line, "unexpected '" + tok.str() + "' in an expression");
+        }
+        if (tok.is("pi")) {
+            return acos(-1.0);
+        }
+        string name = tok.str();
+        if (ts.peek().is('(')) {
+            ts.next();
+            double arg = parseExpr(ts, env);
+            expect(ts, ')');
+            if (name == "sin") return sin(arg);
+            if (name == "cos") return cos(arg);
+            if (name == "tan") return tan(arg);
+            if (name == "exp") return exp(arg);
+            if (name == "ln") return log(arg);
+            if (name == "sqrt") return sqrt(arg);
+            fail(tok.line, "unknown function " + name);
+        }
+        auto it = env.find(name);
+        if (it == env.end()) {
+            fail(tok.line, "unknown parameter " + name);
+        }
+        return it->second;
+    }
+
+    //
+    // Gate calls
+    //
+
+    // Parse a top-level argument: q[i] or a whole register q
+    vector<int> parseRegArg(TokenStream& ts) {
+        Token tok = expectIdent(ts);
+        auto it = qregs.find(tok.str());
+        if (it == qregs.end()) {
+            fail(tok.line, "unknown qreg " + tok.str());
+        }
+        vector<int> qubits;
+        if (ts.peek().is('[')) {
+            ts.next();
+            Token idx = ts.next();
+            if (idx.type != TOK_NUMBER || idx.num < 0 || idx.num >= it->second.second) {
+                fail(idx.line, "invalid index of qreg " + tok.str());
+            }
+            expect(ts, ']');
+            qubits.push_back(it->second.first + (int)idx.num);
+        } else {
+            for (int k = 0; k < it->second.second; ++ k) {
+                qubits.push_back(it->second.first + k);
+            }
+        }
+        return qubits;
+    }
+
+    // Parse "name(params) args;" and apply it, broadcasting registers
+    void parseCall(TokenStream& ts, Token name, map<string, double>& env, map<string, int>* bindings) {
+        vector<double> params;
+        if (ts.peek().is('(')) {
+            ts.next();
+            if (! ts.peek().is(')')) {
+                params.push_back(parseExpr(ts, env));
+                while (ts.peek().is(',')) {
+                    ts.next();
+                    params.push_back(parseExpr(ts, env));
+                }
+            }
+            expect(ts, ')');
+        }
+        vector<vector<int>> args;
+        do {
+            if (! args.empty()) {
+                ts.next(); // ','
+            }
+            if (bindings == nullptr) {
+                args.push_back(parseRegArg(ts));
+            } else {
+                Token arg = expectIdent(ts);
+                auto it = bindings->find(arg.str());
+                if (it == bindings->end()) {
+                    fail(arg.line, "unknown qubit argument " + arg.str());
+                }
+                args.push_back(vector<int>(1, it->second));
+            }
+        } while (ts.peek().is(','));
+        expect(ts, ';');
+
+        size_t width = 1;
+        for (auto& a : args) {
+            if (a.size() != 1) {
+                if (width != 1 && width != a.size()) {
+                    fail(name.line, "registers of different sizes in " + name.str());
+                }
+                width = a.size();
+            }
+        }
+        vector<int> qubits(args.size());
+        for (size_t k = 0; k < width; ++ k) {
+            for (size_t a = 0; a < args.size(); ++ a) {
+                qubits[a] = args[a].size() == 1 ? args[a][0] : args[a][k];
+            }
+            applyGate(name, params, qubits);
+        }
+    }
+
+    void applyGate(Token name, vector<double>& params, vector<int>& qubits) {
+        auto def = defs.find(name.str());
+        if (def != defs.end()) {
+            expand(name, def->second, params, qubits);
+            return;
+        }
+        static const map<string, GateKind> builtins = {
+            {"h", G_H}, {"x", G_X}, {"y", G_Y}, {"z", G_Z}, {"rx", G_RX}, {"ry", G_RY}, {"rz", G_RZ},
+            {"cx", G_CX}, {"CX", G_CX}, {"cy", G_CY}, {"cz", G_CZ}, {"ch", G_CH}, {"swap", G_SWAP}, {"id", G_ID}
+        };
+        auto it = builtins.find(name.str());
+        if (it == builtins.end()) {
+            fail(name.line, "unsupported gate " + name.str());
+        }
+        GateKind kind = it->second;
+        bool rotation = kind == G_RX || kind == G_RY || kind == G_RZ;
+        bool twoQubit = kind >= G_CX && kind <= G_SWAP;
+        if (params.size() != (rotation ? 1u : 0u) || qubits.size() != (twoQubit ? 2u : 1u)) {
+            fail(name.line, "wrong number of parameters or qubits for " + name.str());
+        }
+        if (twoQubit && qubits[0] == qubits[1]) {
+            fail(name.line, "repeated qubit in " + name.str());
+        }
+        if (kind == G_ID) {
+            return;
+        }
+        place(kind, qubits[0], twoQubit ? qubits[1] : -1, rotation ? params[0] : 0.0);
+    }
+
+    void expand(Token name, GateDef& def, vector<double>& params, vector<int>& qubits) {
+        if (params.size() != def.params.size() || qubits.size() != def.args.size()) {
+            fail(name.line, "wrong number of parameters or qubits for " + name.str());
+        }
+        if (++ expandDepth > 64) {
+            fail(name.line, "gate definitions nested too deeply at " + name.str());
+        }
+        map<string, double> env;
+        for (size_t k = 0; k < params.size(); ++ k) {
+            env[def.params[k]] = params[k];
+        }
+        map<string, int> bindings;
+        for (size_t k = 0; k < qubits.size(); ++ k) {
+            bindings[def.args[k]] = qubits[k];
+        }
+        VectorStream body(def.body, def.line);
+        while (body.peek().type != TOK_END) {
+            Token tok = expectIdent(body);
+            if (tok.is("barrier")) {
+                vector<int> bq;
+                do {
+                    if (! bq.empty()) body.next();
+                    Token arg = expectIdent(body);
+                    auto it = bindings.find(arg.str());
+                    if (it == bindings.end()) {
+                        fail(arg.line, "unknown qubit argument " + arg.str());
+                    }
+                    bq.push_back(it->second);
+                } while (body.peek().is(','));
+                expect(body, ';');
+                barrier(bq);
+                continue;
+            }
+            parseCall(body, tok, env, &bindings);
+        }
+        -- expandDepth;
+    }
+
+    //
+    // Level assignment
+    //
+
+    void place(GateKind kind, int q0, int q1, double theta) {
+        int lo = q1 < 0 ? q0 : min(q0, q1);
+        int hi = q1 < 0 ? q0 : max(q0, q1);
+        int level = 0;
+        for (int q = lo; q <= hi; ++ q) {
+            level = max(level, nextFree[q]);
+        }
+        for (int q = lo; q <= hi; ++ q) {
+            nextFree[q] = level + 1;
+        }
+        depth = max(depth, level + 1);
+        PlacedGate g = {level, kind, q0, q1, matrixOf(kind, theta)};
+        placed.push_back(g);
+    }
+
+    // Return the index of the gate matrix in mats, registering rotation matrices in MatrixDict
+    int matrixOf(GateKind kind, double theta) {
+        bool rotation = kind == G_RX || kind == G_RY || kind == G_RZ;
+        pair<int, double> key(kind, rotation ? theta : 0.0);
+        auto it = matIndex.find(key);
+        if (it != matIndex.end()) {
+            return it->second;
+        }
+        shared_ptr<Matrix<DTYPE>> mat;
+        if (rotation) {
+            mat = Matrix<DTYPE>::findMatrix(rotationKey(gateNames[kind], theta));
+            if (mat == nullptr) {
+                mat = QGate(gateNames[kind], {}, {0}, theta).gmat; // registers the matrix in MatrixDict
+            }
+        } else {
+            mat = Matrix<DTYPE>::findMatrix(gateNames[kind]);
+        }
+        mats.push_back(mat);
+        matIndex[key] = mats.size() - 1;
+        return mats.size() - 1;
+    }
+
+    void barrier(vector<int>& qubits) {
+        int level = 0;
+        for (int q : qubits) {
+            level = max(level, nextFree[q]);
+        }
+        for (int q : qubits) {
+            nextFree[q] = level;
+        }
+    }
+
+    //
+    // Statements
+    //
+
+    void parseGateDef(TokenStream& ts) {
+        Token name = expectIdent(ts);
+        GateDef def;
+        def.line = name.line;
+        if (ts.peek().is('(')) {
+            ts.next();
+            while (! ts.peek().is(')')) {
+                def.params.push_back(expectIdent(ts).str());
+                if (ts.peek().is(',')) ts.next();
+            }
+            expect(ts, ')');
+        }
+        while (! ts.peek().is('{')) {
+            def.args.push_back(expectIdent(ts).str());
+            if (ts.peek().is(',')) ts.next();
+        }
+        expect(ts, '{');
+        Token tok = ts.next();
+        while (! tok.is('}')) {
+            if (tok.type == TOK_END) {
+                fail(name.line, "unterminated definition of gate " + name.str());
+            }
+            def.body.push_back(tok);
+            tok = ts.next();
+        }
+        defs[name.str()] = def;
+    }
+
+    void parseStatement(TokenStream& ts) {
+        Token tok = ts.next();
+        if (tok.type != TOK_IDENT) {
+            fail(tok.line, "unexpected '" + tok.str() + "'");
+        }
+        if (tok.is("OPENQASM") || tok.is("include") || tok.is("creg") || tok.is("measure")) {
+            skipStatement(ts); // no classical registers or measurements in this simulator
+        } else if (tok.is("qreg")) {
+            if (! placed.empty()) {
+                fail(tok.line, "qreg after the first gate is not supported");
+            }
+            Token name = expectIdent(ts);
+            expect(ts, '[');
+            Token size = ts.next();
+            if (size.type != TOK_NUMBER || size.num <= 0) {
+                fail(size.line, "invalid size of qreg " + name.str());
+            }
+            if (nextFree.size() + size.num > QASM_MAX_QUBITS) {
+                fail(size.line, "more than " + to_string(QASM_MAX_QUBITS) + " qubits in qreg " + name.str());
+            }
+            expect(ts, ']');
+            expect(ts, ';');
+            qregs[name.str()] = make_pair((int)nextFree.size(), (int)size.num);
+            nextFree.resize(nextFree.size() + (int)size.num, 0);
+        } else if (tok.is("gate")) {
+            parseGateDef(ts);
+        } else if (tok.is("barrier")) {
+            vector<int> qubits;
+            do {
+                if (! qubits.empty()) ts.next();
+                vector<int> arg = parseRegArg(ts);
+                qubits.insert(qubits.end(), arg.begin(), arg.end());
+            } while (ts.peek().is(','));
+            expect(ts, ';');
+            barrier(qubits);
+        } else if (tok.is("opaque") || tok.is("reset") || tok.is("if") || tok.is("U")) {
+            fail(tok.line, tok.str() + " is not supported");
+        } else {
+            map<string, double> env;
+            parseCall(ts, tok, env, nullptr);
+        }
+    }
+
+    //
+    // Materialization
+    //
+
+    QCircuit build(string name) {
+        int numQubits = nextFree.size();
+        QCircuit qc;
+        qc.numQubits = numQubits;
+        qc.numDepths = max(depth, 1);
+        qc.name = name;
+
+        // bucket the placed gates by level (counting sort)
+        vector<ll> start(qc.numDepths + 1, 0);
+        for (auto& g : placed) {
+            start[g.level + 1] ++;
+        }
+        for (int L = 0; L < qc.numDepths; ++ L) {
+            start[L + 1] += start[L];
+        }
+        vector<int> order(placed.size());
+        vector<ll> fill(start.begin(), start.end() - 1);
+        for (size_t k = 0; k < placed.size(); ++ k) {
+            order[fill[placed[k].level] ++] = k;
+        }
+
+        // one prototype level of IDE gates, copied instead of looked up per level
+        vector<QGate> ideLevel;
+        for (int i = 0; i < numQubits; ++ i) {
+            ideLevel.push_back(QGate("IDE", {}, {i}));
+        }
+        QGate placeholder;
+        placeholder.gname = "MARK";
+        placeholder.gmat = Matrix<DTYPE>::findMatrix("MARK");
+
+        // levels are independent, so they are materialized in parallel
+        qc.gates.resize(qc.numDepths);
+        parallelFor(0, qc.numDepths, 0, [&](ll lbegin, ll lend) {
+            for (ll L = lbegin; L < lend; ++ L) {
+                vector<QGate>& level = qc.gates[L];
+                level = ideLevel;
+                for (ll k = start[L]; k < start[L + 1]; ++ k) {
+                    placeGate(level, placed[order[k]], placeholder);
+                }
+            }
+        });
+        return qc;
+    }
+
+    // Write a placed gate and its MARK placeholders into a level, as the builder methods do
+    void placeGate(vector<QGate>& level, PlacedGate& g, QGate placeholder) {
+        QGate gate;
+        gate.gname = gateNames[g.kind];
+        gate.gmat = mats[g.mat];
+        if (g.q1 < 0) {
+            gate.targetQubits = {g.q0};
+            level[g.q0] = gate;
+            return;
+        }
+        int start = min(g.q0, g.q1);
+        int end = max(g.q0, g.q1);
+        if (g.kind == G_SWAP) {
+            gate.targetQubits = {start, end};
+            placeholder.targetQubits = {start, end};
+        } else {
+            gate.controlQubits = {g.q0};
+            gate.targetQubits = {g.q1};
+            placeholder.controlQubits = {g.q0};
+            placeholder.targetQubits = {g.q1};
+        }
+        for (int i = start; i <= end; ++ i) {
+            level[i] = placeholder;
+        }
+        level[g.kind == G_SWAP ? end : g.q1] = gate;
+    }
+
+public:
+    QASMParser() : depth(0), expandDepth(0) {}
+
+    QCircuit parse(const char* src, size_t len, string name) {
+        Lexer lexer(src, len);
+        while (lexer.peek().type != TOK_END) {
+            parseStatement(lexer);
+        }
+        if (nextFree.empty()) {
+            fail(1, "no qreg declared");
+        }
+        return build(name);
+    }
+};
+
+/**
+ * @brief Parse a quantum circuit from OpenQASM 2.0 source text without exiting on errors
+ *
+ * @param src the source text
+ * @param len the length of the source text
+ * @param qc the parsed circuit, unchanged on failure
+ * @param error the error message on failure
+ * @param name the circuit name
+ * @return bool whether the source was parsed
+ */
+bool tryParseQASM(const char* src, size_t len, QCircuit& qc, string& error, string name) {
+    QASMParser parser;
+    try {
+        qc = parser.parse(src, len, name);
+    } catch (const QASMError& e) {
+        error = "QASM line " + to_string(e.line) + ": " + e.msg;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parse a quantum circuit from OpenQASM 2.0 source text
+ *
+ * @param src the source text
+ * @param len the length of the source text
+ * @param name the circuit name
+ * @return QCircuit the circuit
+ */
+QCircuit parseQASM(const char* src, size_t len, string name) {
+    QCircuit qc;
+    string error;
+    if (! tryParseQASM(src, len, qc, error, name)) {
+        cout << "[ERROR] " << error << endl;
+        exit(1);
+    }
+    return qc;
+}
+
+/**
+ * @brief Load a quantum circuit from an OpenQASM 2.0 file without exiting on errors
+ *
+ * @param path the file path
+ * @param qc the loaded circuit, named after the file, unchanged on failure
+ * @param error the error message on failure
+ * @return bool whether the file was read and parsed
+ */
+bool tryLoadQASM(const string& path, QCircuit& qc, string& error) {
+    string name = path.substr(path.find_last_of("/\\") + 1);
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size_t len = st.st_size;
+    if (len == 0) {
+        close(fd);
+        return tryParseQASM("", 0, qc, error, name);
+    }
+    void* addr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        error = "cannot mmap " + path;
+        return false;
+    }
+    madvise(addr, len, MADV_SEQUENTIAL);
+    bool ok = tryParseQASM((const char*)addr, len, qc, error, name);
+    munmap(addr, len);
+    return ok;
+#else
+    ifstream fin(path, ios::binary);
+    if (! fin) {
+        error = "cannot open " + path;
+        return false;
+    }
+    string src((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+    return tryParseQASM(src.data(), src.size(), qc, error, name);
+#endif
+}
+
+/**
+ * @brief Load a quantum circuit from an OpenQASM 2.0 file, read through mmap
+ *
+ * @param path the file path
+ * @return QCircuit the circuit, named after the file
+ */
+QCircuit loadQASM(const string& path) {
+    QCircuit qc;
+    string error;
+    if (! tryLoadQASM(path, qc, error)) {
+        cout << "[ERROR] loadQASM: " << error << endl;
+        exit(1);
+    }
+    return qc;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "qcircuit.h"
+
+//
+// OpenQASM 2.0 loader
+//
+// Supported statements: OPENQASM, include (ignored, the qelib1 gates below are 
+// built in), qreg, creg and measure (ignored), barrier, gate definitions, and 
+// calls of id, h, x, y, z, rx, ry, rz, cx (CX), cy, cz, ch, swap and of defined 
+// gates, with register broadcasting. Parameters are expressions over numbers, pi, 
+// gate parameters, + - * / ^ and sin, cos, tan, exp, ln, sqrt. 
+//
+// The gates are not added through the builder methods. Every gate is placed at 
+// the earliest level where its qubit span is free (a barrier closes the levels 
+// of its qubits), and the levels are materialized once at the end. 
+//
+// loadQASM and parseQASM print the error and exit on malformed input, the
+// try* variants return false with the message instead, e.g., for the C API.
+//
+
+/**
+ * @brief Load a quantum circuit from an OpenQASM 2.0 file, read through mmap
+ * 
+ * @param path the file path
+ * @return QCircuit the circuit, named after the file
+ */
+QCircuit loadQASM(const string& path);
+
+/**
+ * @brief Parse a quantum circuit from OpenQASM 2.0 source text
+ * 
+ * @param src the source text
+ * @param len the length of the source text
+ * @param name the circuit name
+ * @return QCircuit the circuit
+ */
+QCircuit parseQASM(const char* src, size_t len, string name = "qasm");
+
+/**
+ * @brief Load a quantum circuit from an OpenQASM 2.0 file without exiting on errors
+ * 
+ * @param path the file path
+ * @param qc the loaded circuit, named after the file, unchanged on failure
+ * @param error the error message on failure
+ * @return bool whether the file was read and parsed
+ */
+bool tryLoadQASM(const string& path, QCircuit& qc, string& error);
+
+/**
+ * @brief Parse a quantum circuit from OpenQASM 2.0 source text without exiting on errors
+ * 
+ * @param src the source text
+ * @param len the length of the source text
+ * @param qc the parsed circuit, unchanged on failure
+ * @param error the error message on failure
+ * @param name the circuit name
+ * @return bool whether the source was parsed
+ */
+bool tryParseQASM(const char* src, size_t len, QCircuit& qc, string& error, string name = "qasm");
@@ -200,6 +200,109 @@ void QCircuit::barrier() {
     add_level();
 }
 
+/**
+ * @brief Append a sub-circuit repeated count times
+ * 
+ * The repeat occupies one level of its own. The simulators compute the 
+ * operation matrix of the body once instead of once per copy. 
+ * 
+ * @param body  the repeated sub-circuit with the same number of qubits
+ * @param count the number of repetitions
+ */
+void QCircuit::repeat(QCircuit& body, ll count) {
+    if (body.numQubits != numQubits) {
+        cout << "[ERROR] repeat: body.numQubits != numQubits. " << endl;
+        exit(1);
+    }
+    if (count < 0) {
+        cout << "[ERROR] repeat: count < 0. " << endl;
+        exit(1);
+    }
+    for (int i = 0; i < numQubits; ++ i) {
+        if (! gates[numDepths-1][i].isIDE()) {
+            add_level();
+            break;
+        }
+    }
+    QRepeat rep;
+    rep.body = make_shared<QCircuit>(body);
+    rep.count = count;
+    rep.powmat = nullptr;
+    repeats[numDepths-1] = rep;
+    add_level(); // close the repeat level so that later gates are not merged into it
+}
+
+/**
+ * @brief Check if level[level] is occupied by a repeated block
+ * 
+ * @param level the level id
+ */
+bool QCircuit::isRepeat(int level) {
+    return repeats.find(level) != repeats.end();
+}
+
+/**
+ * @brief Count the gates of the circuit (IDE and MARK excluded, repeats expanded)
+ */
+ll QCircuit::numGates() {
+    ll cnt = 0;
+    for (int j = 0; j < numDepths; ++ j) {
+        if (isRepeat(j)) {
+            cnt += repeats[j].count * repeats[j].body->numGates();
+            continue;
+        }
+        for (int i = 0; i < numQubits; ++ i) {
+            if (! gates[j][i].isIDE() && ! gates[j][i].isMARK()) {
+                cnt ++;
+            }
+        }
+    }
+    return cnt;
+}
+
+/**
+ * @brief Return a copy of the circuit with all repeated blocks expanded into plain levels
+ */
+QCircuit QCircuit::unrolled() {
+    QCircuit qc;
+    qc.numQubits = numQubits;
+    qc.name = name;
+    for (int j = 0; j < numDepths; ++ j) {
+        if (! isRepeat(j)) {
+            qc.gates.push_back(gates[j]);
+            continue;
+        }
+        QCircuit body = repeats[j].body->unrolled();
+        for (ll r = 0; r < repeats[j].count; ++ r) {
+            qc.gates.insert(qc.gates.end(), body.gates.begin(), body.gates.end());
+        }
+    }
+    qc.numDepths = qc.gates.size();
+    return qc;
+}
+
+/**
+ * @brief Return the gates in level order, with IDE and MARK gates dropped and repeats expanded
+ */
+vector<QGate> QCircuit::flatGates() {
+    vector<QGate> flat;
+    for (int j = 0; j < numDepths; ++ j) {
+        if (isRepeat(j)) {
+            vector<QGate> body = repeats[j].body->flatGates();
+            for (ll r = 0; r < repeats[j].count; ++ r) {
+                flat.insert(flat.end(), body.begin(), body.end());
+            }
+            continue;
+        }
+        for (int i = 0; i < numQubits; ++ i) {
+            if (! gates[j][i].isIDE() && ! gates[j][i].isMARK()) {
+                flat.push_back(gates[j][i]);
+            }
+        }
+    }
+    return flat;
+}
+
 /**
  * @brief Set the circuit depth to numDepths_
  * 
@@ -228,6 +331,10 @@ void QCircuit::print() {
                 cout << "...";
                 break;
             }
+            if (isRepeat(j)) {
+                cout << "R^" << repeats[j].count << "\t";
+                continue;
+            }
             if (gates[j][i].isControlQubit(i)) {
                 cout << "C";
             } else if (gates[j][i].isTargetQubit(i)) {
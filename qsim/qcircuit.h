@@ -2,12 +2,22 @@
 
 #include "qgate.h"
 
+class QCircuit;
+
+// A block of levels repeated count times, e.g., a Trotter step
+struct QRepeat {
+    shared_ptr<QCircuit> body; // the repeated sub-circuit
+    ll count; // the number of repetitions
+    shared_ptr<Matrix<DTYPE>> powmat; // cached operation matrix of the whole repeat, i.e., O_body^count
+};
+
 class QCircuit {
 public:
     int numQubits;
     int numDepths;
     vector<vector<QGate>> gates;
     string name;
+    map<int, QRepeat> repeats; // level id -> the repeated block occupying this level
 
     QCircuit();
     QCircuit(int numQubits_, string name_="qcircuit");
@@ -35,6 +45,11 @@ public:
     // Other operations on quantum circuits
     //
     void barrier();
+    void repeat(QCircuit& body, ll count);
+    bool isRepeat(int level);
+    ll numGates();
+    QCircuit unrolled();
+    vector<QGate> flatGates();
     void setDepths(int numDepths_);
     void print();
     void printInfo();
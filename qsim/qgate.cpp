@@ -18,7 +18,7 @@ QGate::QGate(string gname_, vector<int> controls_, vector<int> targets_) {
     gname = gname_;
     controlQubits = controls_;
     targetQubits = targets_;
-    gmat = Matrix<DTYPE>::MatrixDict[gname];
+    gmat = Matrix<DTYPE>::findMatrix(gname);
     if (gmat == nullptr) {
         cout << "[ERROR] Gate " << gname << " not found in MatrixDict" << endl;
         exit(1);
@@ -38,8 +38,8 @@ QGate::QGate(string gname_, vector<int> controls_, vector<int> targets_, double
     controlQubits = controls_;
     targetQubits = targets_;
     
-    string matkey = gname + to_string(theta);
-    gmat = Matrix<DTYPE>::MatrixDict[matkey];
+    string matkey = rotationKey(gname, theta);
+    gmat = Matrix<DTYPE>::findMatrix(matkey);
     if (gmat != nullptr) { // the gate matrix already exists
         cout << "[DEBUG] Matrix already exists: " << matkey << ", " << gmat << endl;
         return;
@@ -56,8 +56,7 @@ QGate::QGate(string gname_, vector<int> controls_, vector<int> targets_, double
         cout << "[ERROR] Gate " << gname << " not implemented" << endl;
         exit(1);
     }
-    Matrix<DTYPE>::MatrixDict[matkey] = make_shared<Matrix<DTYPE>>(move(mat));
-    gmat = Matrix<DTYPE>::MatrixDict[matkey];
+    gmat = Matrix<DTYPE>::internMatrix(matkey, make_shared<Matrix<DTYPE>>(move(mat))); // another thread may have added it meanwhile
 }
 
 /**
@@ -156,4 +155,12 @@ QGate::~QGate() {
 // Control qubits can be negative to denote 0-controlled
 bool compareByAbsoluteValue(int a, int b) {
     return std::abs(a) < std::abs(b);
-}
\ No newline at end of file
+}
+
+// The MatrixDict key of a rotation gate matrix, with theta at full precision
+// (to_string keeps 6 decimals, so close angles would share one matrix)
+string rotationKey(const string& gname, double theta) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.17g", theta);
+    return gname + buf;
+}
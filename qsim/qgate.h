@@ -39,4 +39,7 @@ public:
 
 // Compare two integers by their absolute values
 // Control qubits can be negative to denote 0-controlled
-bool compareByAbsoluteValue(int a, int b);
\ No newline at end of file
+bool compareByAbsoluteValue(int a, int b);
+
+// The MatrixDict key of a rotation gate matrix, with theta at full precision
+string rotationKey(const string& gname, double theta);
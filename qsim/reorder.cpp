@@ -0,0 +1,201 @@
+#include "reorder.h"
+
+/**
+ * @brief Get the qubits of a gate (controls and targets)
+ */
+static vector<int> gateQubits(QGate& gate) {
+    vector<int> qubits = gate.controlQubits;
+    qubits.insert(qubits.end(), gate.targetQubits.begin(), gate.targetQubits.end());
+    return qubits;
+}
+
+/**
+ * @brief Check if a gate only mixes amplitudes inside aligned blocks of 2^blockQubits rows
+ */
+static bool isBlockLocal(QGate& gate, vector<int>& phys, int blockQubits) {
+    for (int q : gateQubits(gate)) {
+        if (phys[q] >= blockQubits) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Count the bit swaps, i.e., the passes over the state, of permuteQubits(sv, perm): n minus the cycles of perm
+ */
+static int bitSwaps(vector<int>& perm) {
+    int n = perm.size();
+    int swaps = n;
+    vector<bool> seen(n, false);
+    for (int q = 0; q < n; ++ q) {
+        if (seen[q]) {
+            continue;
+        }
+        swaps --; // the cycle through q
+        for (int b = q; ! seen[b]; b = perm[b]) {
+            seen[b] = true;
+        }
+    }
+    return swaps;
+}
+
+/**
+ * @brief Conduct state vector simulation with qubit reordering and cache blocking
+ * 
+ * @param sv the state vector, a 2^n * 1 column
+ * @param qc a quantum circuit
+ * @param blockQubits log2 of the number of amplitudes in a cache block
+ * @param window the number of gates analysed per window
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return ReorderStats the statistics of the run
+ */
+ReorderStats SVSimReordered(Matrix<DTYPE>& sv, QCircuit& qc, int blockQubits, int window, int numThreads) {
+    int n = qc.numQubits;
+    if (sv.row != (1LL << n) || sv.col != 1) {
+        cout << "[ERROR] SVSimReordered: sv is not a 2^numQubits * 1 column. " << endl;
+        exit(1);
+    }
+    ReorderStats stats = {0, 0, 0, 0};
+    vector<QGate> ops = qc.flatGates();
+    int bq = max(1, min(blockQubits, n));
+    window = max(window, 1);
+
+    vector<int> phys(n); // logical qubit -> physical bit
+    for (int q = 0; q < n; ++ q) {
+        phys[q] = q;
+    }
+
+    for (size_t w = 0; w < ops.size(); w += window) {
+        size_t end = min(ops.size(), w + window);
+
+        // Step 1. Rank the qubits by usage in this window; ties keep the current order
+        vector<ll> usage(n, 0);
+        for (size_t g = w; g < end; ++ g) {
+            for (int q : gateQubits(ops[g])) {
+                usage[q] ++;
+            }
+        }
+        vector<int> order(n);
+        for (int q = 0; q < n; ++ q) {
+            order[q] = q;
+        }
+        stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return usage[a] != usage[b] ? usage[a] > usage[b] : phys[a] < phys[b];
+        });
+        vector<int> candidate(n);
+        for (int r = 0; r < n; ++ r) {
+            candidate[order[r]] = r;
+        }
+
+        // Step 2. Transpose if it saves more strided passes than the passes of its bit swaps
+        ll stridedNow = 0, stridedAfter = 0;
+        for (size_t g = w; g < end; ++ g) {
+            stridedNow += isBlockLocal(ops[g], phys, bq) ? 0 : 1;
+            stridedAfter += isBlockLocal(ops[g], candidate, bq) ? 0 : 1;
+        }
+        vector<int> perm(n); // physical bit -> new physical bit
+        for (int q = 0; q < n; ++ q) {
+            perm[phys[q]] = candidate[q];
+        }
+        if (stridedNow - stridedAfter > bitSwaps(perm)) {
+            permuteQubits(sv, perm, numThreads);
+            phys = candidate;
+            stats.numTransposes ++;
+        }
+
+        // Step 3. Apply the window: runs of block-local gates block by block, the others by strided passes
+        size_t g = w;
+        while (g < end) {
+            vector<QGate> run;
+            while (g < end && isBlockLocal(ops[g], phys, bq)) {
+                run.push_back(ops[g]);
+                ++ g;
+            }
+            if (! run.empty()) {
+                for (auto& gate : run) {
+                    for (auto& q : gate.controlQubits) q = phys[q];
+                    for (auto& q : gate.targetQubits) q = phys[q];
+                }
+                parallelFor(0, sv.row >> bq, numThreads, [&](ll bbegin, ll bend) {
+                    for (ll b = bbegin; b < bend; ++ b) {
+                        for (auto& gate : run) {
+                            applyGateRows(sv, gate, b << bq, (b + 1) << bq, 0, 1);
+                        }
+                    }
+                });
+                stats.numBlockedGates += run.size();
+                stats.numBlockedRuns ++;
+                continue;
+            }
+            QGate gate = ops[g];
+            for (auto& q : gate.controlQubits) q = phys[q];
+            for (auto& q : gate.targetQubits) q = phys[q];
+            parallelFor(0, sv.row >> 1, numThreads, [&](ll pbegin, ll pend) {
+                applyGateRows(sv, gate, pbegin << 1, pend << 1, 0, 1);
+            });
+            stats.numStridedGates ++;
+            ++ g;
+        }
+    }
+
+    // restore the original qubit order
+    bool identity = true;
+    for (int q = 0; q < n; ++ q) {
+        identity = identity && phys[q] == q;
+    }
+    if (! identity) {
+        vector<int> perm(n);
+        for (int q = 0; q < n; ++ q) {
+            perm[phys[q]] = q;
+        }
+        permuteQubits(sv, perm, numThreads);
+        stats.numTransposes ++;
+    }
+    return stats;
+}
+
+//
+// Utility functions
+//
+
+/**
+ * @brief Permute the qubits of a state vector in place: bit q of every index moves to bit perm[q]
+ * 
+ * @param sv the state vector, a 2^n * 1 column
+ * @param perm a permutation of 0 .. n-1
+ * @param numThreads the number of threads, 0 means all hardware threads
+ */
+void permuteQubits(Matrix<DTYPE>& sv, vector<int>& perm, int numThreads) {
+    int n = perm.size();
+    if (sv.row != (1LL << n) || sv.col != 1) {
+        cout << "[ERROR] permuteQubits: sv is not a 2^perm.size() * 1 column. " << endl;
+        exit(1);
+    }
+    // pos[q] is the current bit of qubit q, at[b] the qubit at bit b
+    vector<int> pos(n), at(n);
+    for (int q = 0; q < n; ++ q) {
+        pos[q] = q;
+        at[q] = q;
+    }
+    // move the qubits into place with at most n - 1 bit swaps, each one pass without a second copy of the state
+    for (int q = 0; q < n; ++ q) {
+        int a = min(pos[q], perm[q]), b = max(pos[q], perm[q]);
+        if (a == b) {
+            continue;
+        }
+        ll amask = 1LL << a, bmask = 1LL << b;
+        parallelFor(0, sv.row >> 2, numThreads, [&](ll begin, ll end) {
+            for (ll k = begin; k < end; ++ k) {
+                // the amplitudes with bit a = 1, bit b = 0 and with bit a = 0, bit b = 1
+                ll base = insertZeroBit(insertZeroBit(k, a), b);
+                std::swap(sv.data[base | amask][0], sv.data[base | bmask][0]);
+            }
+        });
+        int other = at[perm[q]];
+        at[pos[q]] = other;
+        pos[other] = pos[q];
+        at[perm[q]] = q;
+        pos[q] = perm[q];
+    }
+}
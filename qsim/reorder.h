@@ -0,0 +1,45 @@
+#pragma once
+
+#include "omsim.h"
+
+// Statistics of a reordered state vector simulation
+struct ReorderStats {
+    ll numTransposes; // the number of state transpositions
+    ll numBlockedGates; // gates applied inside cache-resident blocks
+    ll numStridedGates; // gates applied by a full strided pass
+    ll numBlockedRuns; // runs of consecutive blocked gates, one pass over the state each
+};
+
+/**
+ * @brief Conduct state vector simulation with qubit reordering and cache blocking
+ * 
+ * The gates are processed in windows. Before each window, the qubits are ranked 
+ * by how often the window uses them, and the state is transposed so that the 
+ * busiest qubits map to the low-order bits, if that saves more strided passes than 
+ * the transposition costs: one pass per bit swap of permuteQubits. 
+ * A gate whose (physical) qubits are all below blockQubits only mixes amplitudes 
+ * inside aligned blocks of 2^blockQubits rows, so a run of such gates is applied 
+ * block by block, with all gates of the run applied to a block while it is in cache. 
+ * The state is transposed back to the original qubit order at the end. 
+ * 
+ * @param sv the state vector, a 2^n * 1 column
+ * @param qc a quantum circuit
+ * @param blockQubits log2 of the number of amplitudes in a cache block
+ * @param window the number of gates analysed per window
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return ReorderStats the statistics of the run
+ */
+ReorderStats SVSimReordered(Matrix<DTYPE>& sv, QCircuit& qc, int blockQubits = 14, int window = 64, int numThreads = 0);
+
+//
+// Utility functions
+//
+
+/**
+ * @brief Permute the qubits of a state vector in place: bit q of every index moves to bit perm[q]
+ * 
+ * @param sv the state vector, a 2^n * 1 column
+ * @param perm a permutation of 0 .. n-1
+ * @param numThreads the number of threads, 0 means all hardware threads
+ */
+void permuteQubits(Matrix<DTYPE>& sv, vector<int>& perm, int numThreads = 0);
@@ -0,0 +1,243 @@
+#include "sampler.h"
+
+#define SAMPLE_TILE_HIST (1LL << 16) // the max entries of the per-tile marginal histograms
+
+/**
+ * @brief Check that sv is a 2^n * 1 column and return n
+ */
+static int checkStateVector(Matrix<DTYPE>& sv, const string& caller) {
+    int n = 0;
+    while ((1LL << n) < sv.row) {
+        ++ n;
+    }
+    if (sv.col != 1 || (1LL << n) != sv.row) {
+        cout << "[ERROR] " << caller << ": sv is not a 2^n * 1 column. " << endl;
+        exit(1);
+    }
+    return n;
+}
+
+/**
+ * @brief Sample measurement outcomes of all qubits from a state vector
+ * 
+ * @param sv the state vector, a 2^n * 1 column
+ * @param shots the number of shots
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return map<string, ll> bitstring -> count
+ */
+map<string, ll> sampleCounts(Matrix<DTYPE>& sv, ll shots, ll seed, int numThreads) {
+    int n = checkStateVector(sv, "sampleCounts");
+    vector<double> weights(sv.row);
+    parallelFor(0, sv.row, numThreads, [&](ll begin, ll end) {
+        for (ll i = begin; i < end; ++ i) {
+            weights[i] = norm(sv.data[i][0]);
+        }
+    });
+
+    map<string, ll> counts;
+    for (auto& p : sampleIndices(weights, shots, seed, numThreads)) {
+        counts[toBitstring(p.first, n)] = p.second;
+    }
+    return counts;
+}
+
+/**
+ * @brief Sample measurement outcomes of a subset of qubits from a state vector
+ * 
+ * @param sv the state vector, a 2^n * 1 column
+ * @param shots the number of shots
+ * @param qubits the measured qubits, qubits[k] is bit k of the outcome
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return map<string, ll> bitstring -> count
+ */
+map<string, ll> sampleCounts(Matrix<DTYPE>& sv, ll shots, vector<int> qubits, ll seed, int numThreads) {
+    int n = checkStateVector(sv, "sampleCounts");
+    int m = qubits.size();
+    vector<bool> measured(n, false);
+    for (int q : qubits) {
+        if (q < 0 || q >= n) {
+            cout << "[ERROR] sampleCounts: qubit " << q << " out of range. " << endl;
+            exit(1);
+        }
+        if (measured[q]) {
+            cout << "[ERROR] sampleCounts: qubit " << q << " measured twice. " << endl;
+            exit(1);
+        }
+        measured[q] = true;
+    }
+
+    vector<double> weights(1LL << m, 0.0);
+    if ((1LL << m) <= SAMPLE_TILE_HIST) {
+        // every tile accumulates its own 2^m marginal histogram, which are then reduced
+        vector<ll> bounds = tileBounds(0, sv.row, numThreads);
+        vector<vector<double>> partial(bounds.size() - 1, vector<double>(1LL << m, 0.0));
+        parallelForTiles(bounds, [&](int w, ll begin, ll end) {
+            vector<double>& hist = partial[w];
+            for (ll i = begin; i < end; ++ i) {
+                ll key = 0;
+                for (int k = 0; k < m; ++ k) {
+                    key |= ((i >> qubits[k]) & 1LL) << k;
+                }
+                hist[key] += norm(sv.data[i][0]);
+            }
+        });
+        for (auto& hist : partial) {
+            for (ll k = 0; k < (1LL << m); ++ k) {
+                weights[k] += hist[k];
+            }
+        }
+    } else {
+        // too large to copy per tile: the threads split the keys of one histogram,
+        // and key k gathers the 2^(n-m) amplitudes whose measured bits spell k
+        vector<int> rest;
+        for (int q = 0; q < n; ++ q) {
+            if (! measured[q]) {
+                rest.push_back(q);
+            }
+        }
+        parallelFor(0, 1LL << m, numThreads, [&](ll begin, ll end) {
+            for (ll key = begin; key < end; ++ key) {
+                ll base = 0;
+                for (int k = 0; k < m; ++ k) {
+                    base |= ((key >> k) & 1LL) << qubits[k];
+                }
+                double acc = 0;
+                for (ll r = 0; r < (1LL << (n - m)); ++ r) {
+                    ll i = base;
+                    for (size_t k = 0; k < rest.size(); ++ k) {
+                        i |= ((r >> k) & 1LL) << rest[k];
+                    }
+                    acc += norm(sv.data[i][0]);
+                }
+                weights[key] = acc;
+            }
+        });
+    }
+
+    map<string, ll> counts;
+    for (auto& p : sampleIndices(weights, shots, seed, numThreads)) {
+        counts[toBitstring(p.first, m)] = p.second;
+    }
+    return counts;
+}
+
+/**
+ * @brief Sample indices from unnormalized non-negative weights
+ * 
+ * @param weights the weights, overwritten with tile-local prefix sums
+ * @param shots the number of shots
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return vector<pair<ll, ll>> (index, count) pairs in ascending index order
+ */
+vector<pair<ll, ll>> sampleIndices(vector<double>& weights, ll shots, ll seed, int numThreads) {
+    vector<ll> bounds = tileBounds(0, weights.size(), numThreads);
+    int numTiles = bounds.size() - 1;
+    if (numTiles <= 0 || shots <= 0) {
+        return {};
+    }
+
+    // Step 1. Tile-local inclusive prefix sums, in parallel
+    vector<double> tileMass(numTiles, 0.0);
+    parallelForTiles(bounds, [&](int w, ll begin, ll end) {
+        double acc = 0;
+        for (ll i = begin; i < end; ++ i) {
+            acc += weights[i];
+            weights[i] = acc;
+        }
+        tileMass[w] = acc;
+    });
+    double total = 0;
+    for (int w = 0; w < numTiles; ++ w) {
+        total += tileMass[w];
+    }
+    if (total <= 0) {
+        cout << "[ERROR] sampleIndices: the total weight is not positive. " << endl;
+        exit(1);
+    }
+
+    // Step 2. Split the shots across the tiles: a multinomial draw as a chain of binomials
+    unsigned long long base = seed < 0 ? random_device()() : (unsigned long long)seed;
+    mt19937_64 rng(base);
+    vector<ll> tileShots(numTiles, 0);
+    ll remainShots = shots;
+    double remainMass = total;
+    for (int w = 0; w < numTiles && remainShots > 0; ++ w) {
+        if (w == numTiles - 1 || tileMass[w] >= remainMass) {
+            tileShots[w] = remainShots;
+        } else {
+            binomial_distribution<ll> binom(remainShots, max(0.0, tileMass[w] / remainMass));
+            tileShots[w] = binom(rng);
+        }
+        remainShots -= tileShots[w];
+        remainMass -= tileMass[w];
+    }
+
+    // Step 3. Each tile merges its sorted uniform draws against its local CDF
+    vector<vector<pair<ll, ll>>> tileCounts(numTiles);
+    parallelForTiles(bounds, [&](int w, ll begin, ll end) {
+        ll k = tileShots[w];
+        if (k == 0) {
+            return;
+        }
+        // sorted uniforms in [0, mass) from normalized partial sums of k + 1 exponential spacings
+        mt19937_64 local(base + 0x9E3779B97F4A7C15ULL * (w + 1));
+        exponential_distribution<double> expo(1.0);
+        vector<double> u(k);
+        double acc = 0;
+        for (ll s = 0; s < k; ++ s) {
+            acc += expo(local);
+            u[s] = acc;
+        }
+        double scale = tileMass[w] / (acc + expo(local));
+
+        ll last = begin;
+        for (ll i = begin; i < end; ++ i) {
+            if (weights[i] > (i == begin ? 0.0 : weights[i-1])) {
+                last = i; // the last index with a non-zero weight
+            }
+        }
+        ll i = begin;
+        vector<pair<ll, ll>>& out = tileCounts[w];
+        for (ll s = 0; s < k; ++ s) {
+            double x = u[s] * scale;
+            while (i < last && weights[i] <= x) {
+                ++ i;
+            }
+            if (! out.empty() && out.back().first == i) {
+                out.back().second ++;
+            } else {
+                out.push_back(make_pair(i, 1LL));
+            }
+        }
+    });
+
+    vector<pair<ll, ll>> result;
+    for (auto& tc : tileCounts) {
+        result.insert(result.end(), tc.begin(), tc.end());
+    }
+    return result;
+}
+
+//
+// Utility functions
+//
+
+/**
+ * @brief Convert an index to a bitstring of the given width, high-order bit first
+ * 
+ * @param idx the index
+ * @param width the number of bits
+ * @return string the bitstring
+ */
+string toBitstring(ll idx, int width) {
+    string bits(width, '0');
+    for (int k = 0; k < width; ++ k) {
+        if ((idx >> k) & 1) {
+            bits[width - 1 - k] = '1';
+        }
+    }
+    return bits;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "parallel.h"
+
+//
+// Measurement sampling
+//
+// Bitstrings are written from the high-order qubit to the low-order qubit, 
+// i.e., the last character is q_0 (or qubits[0] for marginal sampling). 
+//
+
+/**
+ * @brief Sample measurement outcomes of all qubits from a state vector
+ * 
+ * The probabilities are accumulated with a two-level parallel prefix sum. 
+ * The shots are split across the tiles by multinomial sampling, and each tile 
+ * merges sorted uniform draws against its local CDF. The cost is O(2^n + shots). 
+ * 
+ * @param sv the state vector, a 2^n * 1 column
+ * @param shots the number of shots
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return map<string, ll> bitstring -> count
+ */
+map<string, ll> sampleCounts(Matrix<DTYPE>& sv, ll shots, ll seed = -1, int numThreads = 0);
+
+/**
+ * @brief Sample measurement outcomes of a subset of qubits from a state vector
+ * 
+ * The 2^m marginal distribution is accumulated directly from the amplitudes, 
+ * so the full 2^n probability vector is never built. Small histograms are 
+ * accumulated per tile and reduced; above 2^16 entries the threads split the 
+ * outcomes of one shared histogram instead. Exits on repeated qubits. 
+ * 
+ * @param sv the state vector, a 2^n * 1 column
+ * @param shots the number of shots
+ * @param qubits the measured qubits, qubits[k] is bit k of the outcome
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return map<string, ll> bitstring -> count
+ */
+map<string, ll> sampleCounts(Matrix<DTYPE>& sv, ll shots, vector<int> qubits, ll seed = -1, int numThreads = 0);
+
+/**
+ * @brief Sample indices from unnormalized non-negative weights
+ * 
+ * @param weights the weights, overwritten with tile-local prefix sums
+ * @param shots the number of shots
+ * @param seed the random seed, -1 means a random seed
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return vector<pair<ll, ll>> (index, count) pairs in ascending index order
+ */
+vector<pair<ll, ll>> sampleIndices(vector<double>& weights, ll shots, ll seed = -1, int numThreads = 0);
+
+//
+// Utility functions
+//
+
+/**
+ * @brief Convert an index to a bitstring of the given width, high-order bit first
+ * 
+ * @param idx the index
+ * @param width the number of bits
+ * @return string the bitstring
+ */
+string toBitstring(ll idx, int width);
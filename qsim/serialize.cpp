@@ -0,0 +1,749 @@
+#include "serialize.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define QSIM_BYTE_ORDER 0x01020304u
+#define ZRLE_MAX_LITERALS (1LL << 16) // the max #literals buffered per zero-run block
+
+static const char QSIM_MAGIC[8] = {'Q', 'S', 'I', 'M', 'B', 'I', 'N', '\0'};
+
+//
+// Checksum
+//
+
+Checksum64::Checksum64(uint64_t seed) {
+    h = seed;
+}
+
+/**
+ * @brief Mix n bytes into the checksum, 8 bytes at a time
+ *
+ * @param p the data
+ * @param n the number of bytes
+ */
+void Checksum64::update(const void* p, size_t n) {
+    const char* c = (const char*)p;
+    uint64_t w;
+    for (; n >= 8; n -= 8, c += 8) {
+        memcpy(&w, c, 8);
+        h ^= w;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    if (n > 0) {
+        w = 0;
+        memcpy(&w, c, n);
+        h ^= w ^ ((uint64_t)n << 56);
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+}
+
+/**
+ * @brief Return the finalized checksum
+ *
+ * @return uint64_t the checksum
+ */
+uint64_t Checksum64::value() const {
+    uint64_t v = h;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ULL;
+    v ^= v >> 33;
+    return v;
+}
+
+//
+// File access
+//
+
+// A read-only view of a whole file, memory-mapped on POSIX systems
+class MappedFile {
+public:
+    const char* data;
+    size_t size;
+#ifndef _WIN32
+    void* addr;
+#else
+    string buf;
+#endif
+
+    MappedFile() : data(nullptr), size(0) {
+#ifndef _WIN32
+        addr = nullptr;
+#endif
+    }
+
+    // Map the file, return false if it cannot be opened
+    bool open(const string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return false;
+        }
+        size = st.st_size;
+        if (size > 0) {
+            addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                addr = nullptr;
+                close(fd);
+                return false;
+            }
+            madvise(addr, size, MADV_SEQUENTIAL);
+            data = (const char*)addr;
+        }
+        close(fd);
+        return true;
+#else
+        ifstream fin(path, ios::binary);
+        if (! fin) {
+            return false;
+        }
+        buf.assign((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+        data = buf.data();
+        size = buf.size();
+        return true;
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (addr != nullptr) {
+            munmap(addr, size);
+        }
+#endif
+    }
+};
+
+// Return the checksum of the header fields before headerChecksum
+static uint64_t headerChecksumOf(const FileHeader& hdr) {
+    Checksum64 cs;
+    cs.update(&hdr, offsetof(FileHeader, headerChecksum));
+    return cs.value();
+}
+
+// Return a header with the common fields set
+static FileHeader makeHeader(QSimFileKind kind) {
+    FileHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, QSIM_MAGIC, sizeof(QSIM_MAGIC));
+    hdr.version = QSIM_FORMAT_VERSION;
+    hdr.kind = kind;
+    hdr.byteOrder = QSIM_BYTE_ORDER;
+    return hdr;
+}
+
+/**
+ * @brief Check the header of a mapped file
+ *
+ * @param file the mapped file
+ * @param kind the expected file kind
+ * @param err the reason if the header is invalid
+ * @return const FileHeader* the header, or nullptr if it is invalid
+ */
+static const FileHeader* checkHeader(MappedFile& file, QSimFileKind kind, string& err) {
+    if (file.size < sizeof(FileHeader)) {
+        err = "truncated header";
+        return nullptr;
+    }
+    const FileHeader* hdr = (const FileHeader*)file.data;
+    if (memcmp(hdr->magic, QSIM_MAGIC, sizeof(QSIM_MAGIC)) != 0) {
+        err = "not a qsim binary file";
+        return nullptr;
+    }
+    if (hdr->byteOrder != QSIM_BYTE_ORDER) {
+        err = "written with a different byte order";
+        return nullptr;
+    }
+    if (hdr->headerChecksum != headerChecksumOf(*hdr)) {
+        err = "corrupted header";
+        return nullptr;
+    }
+    if (hdr->version != QSIM_FORMAT_VERSION) {
+        err = "unsupported format version " + to_string(hdr->version);
+        return nullptr;
+    }
+    if (hdr->kind != (uint32_t)kind) {
+        err = "unexpected file kind " + to_string(hdr->kind);
+        return nullptr;
+    }
+    if (hdr->storedBytes != file.size - sizeof(FileHeader)) {
+        err = "truncated payload";
+        return nullptr;
+    }
+    return hdr;
+}
+
+// Open a file for writing with a large buffer
+static FILE* openForWrite(const string& path, const char* caller) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == nullptr) {
+        cout << "[ERROR] " << caller << ": cannot open " << path << endl;
+        exit(1);
+    }
+    setvbuf(f, nullptr, _IOFBF, 1 << 20);
+    return f;
+}
+
+// Write n bytes or fail
+static void writeBytes(FILE* f, const void* p, size_t n, const char* caller) {
+    if (n > 0 && fwrite(p, 1, n, f) != n) {
+        cout << "[ERROR] " << caller << ": write failed" << endl;
+        exit(1);
+    }
+}
+
+// Finalize the header, rewrite it at the beginning of the file, and close the file
+static void finishFile(FILE* f, FileHeader& hdr, bool sync, const char* caller) {
+    hdr.headerChecksum = headerChecksumOf(hdr);
+    if (fseek(f, 0, SEEK_SET) != 0) {
+        cout << "[ERROR] " << caller << ": seek failed" << endl;
+        exit(1);
+    }
+    writeBytes(f, &hdr, sizeof(hdr), caller);
+    if (fflush(f) != 0) {
+        cout << "[ERROR] " << caller << ": write failed" << endl;
+        exit(1);
+    }
+#ifndef _WIN32
+    if (sync) {
+        fsync(fileno(f));
+    }
+#endif
+    fclose(f);
+}
+
+//
+// Matrix payload
+//
+
+// The zero-run encoder of a stream of matrix entries
+class ZrleWriter {
+private:
+    FILE* f;
+    uint64_t zeros; // the zeros before the buffered literals
+    vector<DTYPE> lits; // the buffered literals
+public:
+    uint64_t stored; // the bytes written so far
+
+    ZrleWriter(FILE* f_) : f(f_), zeros(0), stored(0) {}
+
+    void push(const DTYPE* p, ll n) {
+        static const DTYPE zero(0);
+        for (ll i = 0; i < n; ++ i) {
+            // bitwise, so -0.0 stays a literal and the checksum of the decoded bytes matches
+            if (memcmp(&p[i], &zero, sizeof(DTYPE)) == 0) {
+                if (! lits.empty()) {
+                    flush();
+                }
+                zeros ++;
+            } else {
+                lits.push_back(p[i]);
+                if ((ll)lits.size() == ZRLE_MAX_LITERALS) {
+                    flush();
+                }
+            }
+        }
+    }
+
+    void flush() {
+        if (zeros == 0 && lits.empty()) {
+            return;
+        }
+        uint64_t block[2] = {zeros, (uint64_t)lits.size()};
+        writeBytes(f, block, sizeof(block), "saveMatrix");
+        writeBytes(f, lits.data(), lits.size() * sizeof(DTYPE), "saveMatrix");
+        stored += sizeof(block) + lits.size() * sizeof(DTYPE);
+        zeros = 0;
+        lits.clear();
+    }
+};
+
+/**
+ * @brief Write a matrix file: the header with the given fields, then the entries
+ *
+ * @param f the file
+ * @param hdr the header with kind-specific fields set
+ * @param mat the matrix
+ * @param compress whether to zero-run encode the entries
+ * @param sync whether to fsync the file before closing it
+ */
+static void writeMatrixFile(FILE* f, FileHeader& hdr, const Matrix<DTYPE>& mat, bool compress, bool sync) {
+    hdr.flags = compress ? QSIM_FLAG_ZRLE : 0;
+    hdr.rows = mat.row;
+    hdr.cols = mat.col;
+    hdr.rawBytes = (uint64_t)mat.row * mat.col * sizeof(DTYPE);
+    writeBytes(f, &hdr, sizeof(hdr), "saveMatrix"); // placeholder, rewritten by finishFile
+
+    Checksum64 cs;
+    ZrleWriter zw(f);
+    for (ll i = 0; i < mat.row; ++ i) {
+        cs.update(mat.data[i], mat.col * sizeof(DTYPE));
+        if (compress) {
+            zw.push(mat.data[i], mat.col);
+        } else {
+            writeBytes(f, mat.data[i], mat.col * sizeof(DTYPE), "saveMatrix");
+        }
+    }
+    zw.flush();
+    hdr.storedBytes = compress ? zw.stored : hdr.rawBytes;
+    hdr.checksum = cs.value();
+    finishFile(f, hdr, sync, "saveMatrix");
+}
+
+/**
+ * @brief Read the entries of a matrix file into mat and verify the checksum
+ *
+ * @param hdr the checked header
+ * @param payload the payload following the header
+ * @param mat the matrix
+ * @param err the reason if the payload is invalid
+ * @return true if the payload is valid
+ */
+static bool readMatrixPayload(const FileHeader& hdr, const char* payload, Matrix<DTYPE>& mat, string& err) {
+    if (hdr.rows < 0 || hdr.cols < 0 || (hdr.cols > 0 && hdr.rows > (ll)(hdr.rawBytes / sizeof(DTYPE) / hdr.cols))
+        || hdr.rawBytes != (uint64_t)hdr.rows * hdr.cols * sizeof(DTYPE)) {
+        err = "invalid matrix shape";
+        return false;
+    }
+    if (! (hdr.flags & QSIM_FLAG_ZRLE) && hdr.storedBytes != hdr.rawBytes) {
+        err = "invalid payload size";
+        return false;
+    }
+    mat = Matrix<DTYPE>(hdr.rows, hdr.cols);
+    if (! (hdr.flags & QSIM_FLAG_ZRLE)) {
+        for (ll i = 0; i < mat.row; ++ i) {
+            memcpy(mat.data[i], payload + i * mat.col * sizeof(DTYPE), mat.col * sizeof(DTYPE));
+        }
+    } else {
+        // decode the blocks into the zero-initialized matrix
+        const char* p = payload;
+        const char* end = payload + hdr.storedBytes;
+        ll total = mat.row * mat.col;
+        ll pos = 0; // the flat index of the next entry
+        while (p < end) {
+            uint64_t block[2];
+            if (end - p < (ptrdiff_t)sizeof(block)) {
+                err = "truncated zero-run block";
+                return false;
+            }
+            memcpy(block, p, sizeof(block));
+            p += sizeof(block);
+            if (block[0] > (uint64_t)(total - pos) || block[1] > (uint64_t)(total - pos - block[0])
+                || block[1] > (uint64_t)(end - p) / sizeof(DTYPE)) {
+                err = "invalid zero-run block";
+                return false;
+            }
+            pos += block[0];
+            for (uint64_t k = 0; k < block[1]; ++ k, ++ pos, p += sizeof(DTYPE)) {
+                memcpy(&mat.data[pos / mat.col][pos % mat.col], p, sizeof(DTYPE));
+            }
+        }
+    }
+    if (matrixChecksum(mat) != hdr.checksum) {
+        err = "checksum mismatch";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Write a matrix to a binary file
+ *
+ * @param path the file path
+ * @param mat the matrix
+ * @param compress whether to zero-run encode the entries
+ */
+void saveMatrix(const string& path, const Matrix<DTYPE>& mat, bool compress) {
+    FileHeader hdr = makeHeader(QSIM_FILE_MATRIX);
+    writeMatrixFile(openForWrite(path, "saveMatrix"), hdr, mat, compress, false);
+}
+
+/**
+ * @brief Read a matrix from a binary file through mmap, verifying its checksum
+ *
+ * @param path the file path
+ * @return Matrix<DTYPE> the matrix
+ */
+Matrix<DTYPE> loadMatrix(const string& path) {
+    MappedFile file;
+    if (! file.open(path)) {
+        cout << "[ERROR] loadMatrix: cannot open " << path << endl;
+        exit(1);
+    }
+    string err;
+    const FileHeader* hdr = checkHeader(file, QSIM_FILE_MATRIX, err);
+    Matrix<DTYPE> mat;
+    if (hdr == nullptr || ! readMatrixPayload(*hdr, file.data + sizeof(FileHeader), mat, err)) {
+        cout << "[ERROR] loadMatrix: " << path << ": " << err << endl;
+        exit(1);
+    }
+    return mat;
+}
+
+//
+// Circuit payload
+//
+
+// Append plain values to a byte buffer
+class ByteWriter {
+public:
+    string buf;
+
+    template <typename V>
+    void put(V v) {
+        buf.append((const char*)&v, sizeof(V));
+    }
+
+    void putString(const string& s) {
+        put<uint32_t>(s.size());
+        buf.append(s);
+    }
+};
+
+// Read plain values from a byte buffer
+class ByteReader {
+public:
+    const char* p;
+    const char* end;
+
+    ByteReader(const char* p_, const char* end_) : p(p_), end(end_) {}
+
+    void need(size_t n) {
+        if ((size_t)(end - p) < n) {
+            cout << "[ERROR] loadCircuit: truncated circuit payload" << endl;
+            exit(1);
+        }
+    }
+
+    template <typename V>
+    V get() {
+        need(sizeof(V));
+        V v;
+        memcpy(&v, p, sizeof(V));
+        p += sizeof(V);
+        return v;
+    }
+
+    string getString() {
+        uint32_t n = get<uint32_t>();
+        need(n);
+        string s(p, n);
+        p += n;
+        return s;
+    }
+};
+
+/**
+ * @brief Serialize a quantum circuit (recursively for repeated blocks)
+ *
+ * Layout: numQubits, numDepths, name, the gate name table, the gate matrix table
+ * (MatrixDict key, shape, entries), then per level and qubit (name id, controls,
+ * targets, matrix id), then the repeated blocks (level, count, body).
+ *
+ * @param w the output buffer
+ * @param qc the quantum circuit
+ * @param dictKeys the MatrixDict key of each shared gate matrix
+ */
+static void writeCircuit(ByteWriter& w, QCircuit& qc, map<const Matrix<DTYPE>*, string>& dictKeys) {
+    map<string, uint32_t> nameIds;
+    vector<string> names;
+    map<const Matrix<DTYPE>*, int32_t> matIds;
+    vector<const Matrix<DTYPE>*> mats;
+    for (auto& level : qc.gates) {
+        for (auto& gate : level) {
+            if (nameIds.insert({gate.gname, names.size()}).second) {
+                names.push_back(gate.gname);
+            }
+            const Matrix<DTYPE>* m = gate.gmat.get();
+            if (m != nullptr && matIds.insert({m, mats.size()}).second) {
+                mats.push_back(m);
+            }
+        }
+    }
+
+    w.put<int32_t>(qc.numQubits);
+    w.put<int32_t>(qc.numDepths);
+    w.putString(qc.name);
+    w.put<uint32_t>(names.size());
+    for (auto& s : names) {
+        w.putString(s);
+    }
+    w.put<uint32_t>(mats.size());
+    for (auto m : mats) {
+        auto it = dictKeys.find(m);
+        w.putString(it == dictKeys.end() ? "" : it->second);
+        w.put<int64_t>(m->row);
+        w.put<int64_t>(m->col);
+        for (ll i = 0; i < m->row; ++ i) {
+            w.buf.append((const char*)m->data[i], m->col * sizeof(DTYPE));
+        }
+    }
+    for (auto& level : qc.gates) {
+        for (auto& gate : level) {
+            w.put<uint32_t>(nameIds[gate.gname]);
+            w.put<uint32_t>(gate.controlQubits.size());
+            for (int q : gate.controlQubits) {
+                w.put<int32_t>(q);
+            }
+            w.put<uint32_t>(gate.targetQubits.size());
+            for (int q : gate.targetQubits) {
+                w.put<int32_t>(q);
+            }
+            w.put<int32_t>(gate.gmat == nullptr ? -1 : matIds[gate.gmat.get()]);
+        }
+    }
+    w.put<uint32_t>(qc.repeats.size());
+    for (auto& it : qc.repeats) {
+        w.put<int32_t>(it.first);
+        w.put<int64_t>(it.second.count);
+        writeCircuit(w, *it.second.body, dictKeys);
+    }
+}
+
+/**
+ * @brief Deserialize a quantum circuit written by writeCircuit
+ *
+ * @param r the input buffer
+ * @return QCircuit the quantum circuit
+ */
+static QCircuit readCircuit(ByteReader& r) {
+    QCircuit qc;
+    qc.numQubits = r.get<int32_t>();
+    qc.numDepths = r.get<int32_t>();
+    qc.name = r.getString();
+    if (qc.numQubits < 0 || qc.numDepths < 0) {
+        cout << "[ERROR] loadCircuit: invalid circuit shape" << endl;
+        exit(1);
+    }
+    vector<string> names(r.get<uint32_t>());
+    for (auto& s : names) {
+        s = r.getString();
+    }
+    vector<shared_ptr<Matrix<DTYPE>>> mats(r.get<uint32_t>());
+    for (auto& m : mats) {
+        string key = r.getString();
+        ll rows = r.get<int64_t>();
+        ll cols = r.get<int64_t>();
+        if (rows < 0 || cols < 0 || (cols > 0 && rows > (ll)((r.end - r.p) / sizeof(DTYPE) / cols))) {
+            cout << "[ERROR] loadCircuit: invalid gate matrix shape" << endl;
+            exit(1);
+        }
+        Matrix<DTYPE> mat(rows, cols);
+        for (ll i = 0; i < rows; ++ i) {
+            r.need(cols * sizeof(DTYPE));
+            memcpy(mat.data[i], r.p, cols * sizeof(DTYPE));
+            r.p += cols * sizeof(DTYPE);
+        }
+        if (key.empty()) {
+            m = make_shared<Matrix<DTYPE>>(move(mat));
+            continue;
+        }
+        // share the MatrixDict entry if it holds the same matrix
+        auto own = make_shared<Matrix<DTYPE>>(move(mat));
+        shared_ptr<Matrix<DTYPE>> slot = Matrix<DTYPE>::internMatrix(key, own);
+        bool same = slot->row == rows && slot->col == cols;
+        for (ll i = 0; same && i < rows; ++ i) {
+            same = memcmp(slot->data[i], own->data[i], cols * sizeof(DTYPE)) == 0;
+        }
+        m = same ? slot : own;
+    }
+    qc.gates.assign(qc.numDepths, vector<QGate>(qc.numQubits));
+    for (auto& level : qc.gates) {
+        for (auto& gate : level) {
+            uint32_t nameId = r.get<uint32_t>();
+            if (nameId >= names.size()) {
+                cout << "[ERROR] loadCircuit: invalid gate name id" << endl;
+                exit(1);
+            }
+            gate.gname = names[nameId];
+            gate.controlQubits.resize(r.get<uint32_t>());
+            for (int& q : gate.controlQubits) {
+                q = r.get<int32_t>();
+            }
+            gate.targetQubits.resize(r.get<uint32_t>());
+            for (int& q : gate.targetQubits) {
+                q = r.get<int32_t>();
+            }
+            int32_t matId = r.get<int32_t>();
+            if (matId >= (int32_t)mats.size()) {
+                cout << "[ERROR] loadCircuit: invalid gate matrix id" << endl;
+                exit(1);
+            }
+            gate.gmat = matId < 0 ? nullptr : mats[matId];
+        }
+    }
+    uint32_t numRepeats = r.get<uint32_t>();
+    for (uint32_t k = 0; k < numRepeats; ++ k) {
+        int level = r.get<int32_t>();
+        QRepeat rep;
+        rep.count = r.get<int64_t>();
+        rep.body = make_shared<QCircuit>(readCircuit(r));
+        rep.powmat = nullptr;
+        qc.repeats[level] = rep;
+    }
+    return qc;
+}
+
+// Serialize a quantum circuit into a buffer
+static string circuitPayload(QCircuit& qc) {
+    map<const Matrix<DTYPE>*, string> dictKeys;
+    for (auto& it : Matrix<DTYPE>::snapshotMatrixDict()) {
+        if (it.second != nullptr) {
+            dictKeys.insert({it.second.get(), it.first}); // keeps the first key of a shared matrix
+        }
+    }
+    ByteWriter w;
+    writeCircuit(w, qc, dictKeys);
+    return w.buf;
+}
+
+/**
+ * @brief Write a quantum circuit to a binary file
+ *
+ * @param path the file path
+ * @param qc the quantum circuit
+ */
+void saveCircuit(const string& path, QCircuit& qc) {
+    string payload = circuitPayload(qc);
+    FileHeader hdr = makeHeader(QSIM_FILE_CIRCUIT);
+    hdr.rawBytes = payload.size();
+    hdr.storedBytes = payload.size();
+    Checksum64 cs;
+    cs.update(payload.data(), payload.size());
+    hdr.checksum = cs.value();
+
+    FILE* f = openForWrite(path, "saveCircuit");
+    writeBytes(f, &hdr, sizeof(hdr), "saveCircuit");
+    writeBytes(f, payload.data(), payload.size(), "saveCircuit");
+    finishFile(f, hdr, false, "saveCircuit");
+}
+
+/**
+ * @brief Read a quantum circuit from a binary file
+ *
+ * @param path the file path
+ * @return QCircuit the quantum circuit
+ */
+QCircuit loadCircuit(const string& path) {
+    MappedFile file;
+    if (! file.open(path)) {
+        cout << "[ERROR] loadCircuit: cannot open " << path << endl;
+        exit(1);
+    }
+    string err;
+    const FileHeader* hdr = checkHeader(file, QSIM_FILE_CIRCUIT, err);
+    if (hdr == nullptr) {
+        cout << "[ERROR] loadCircuit: " << path << ": " << err << endl;
+        exit(1);
+    }
+    const char* payload = file.data + sizeof(FileHeader);
+    Checksum64 cs;
+    cs.update(payload, hdr->storedBytes);
+    if (hdr->rawBytes != hdr->storedBytes || cs.value() != hdr->checksum) {
+        cout << "[ERROR] loadCircuit: " << path << ": checksum mismatch" << endl;
+        exit(1);
+    }
+    ByteReader r(payload, payload + hdr->storedBytes);
+    return readCircuit(r);
+}
+
+/**
+ * @brief Compute a fingerprint of a quantum circuit from its serialized form
+ *
+ * @param qc the quantum circuit
+ * @return uint64_t the fingerprint
+ */
+uint64_t circuitFingerprint(QCircuit& qc) {
+    string payload = circuitPayload(qc);
+    Checksum64 cs;
+    cs.update(payload.data(), payload.size());
+    return cs.value();
+}
+
+//
+// Checkpoints
+//
+
+/**
+ * @brief Atomically write a simulation checkpoint
+ *
+ * @param path the file path
+ * @param state the state vector or (partial) operation matrix
+ * @param nextLevel the first level not yet applied to state
+ * @param fingerprint the fingerprint of the simulated circuit and input
+ * @param compress whether to zero-run encode the entries
+ */
+void saveCheckpoint(const string& path, const Matrix<DTYPE>& state, int nextLevel, uint64_t fingerprint, bool compress) {
+    string tmp = path + ".tmp";
+    FileHeader hdr = makeHeader(QSIM_FILE_CHECKPOINT);
+    hdr.fingerprint = fingerprint;
+    hdr.nextLevel = nextLevel;
+    writeMatrixFile(openForWrite(tmp, "saveCheckpoint"), hdr, state, compress, true);
+#ifdef _WIN32
+    remove(path.c_str()); // rename does not replace an existing file on Windows
+#endif
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        cout << "[ERROR] saveCheckpoint: cannot rename " << tmp << " to " << path << endl;
+        exit(1);
+    }
+}
+
+/**
+ * @brief Read a simulation checkpoint if it exists and matches the fingerprint
+ *
+ * A checkpoint that is corrupted or belongs to another simulation is ignored.
+ *
+ * @param path the file path
+ * @param fingerprint the fingerprint of the simulated circuit and input
+ * @param state the restored state vector or (partial) operation matrix
+ * @param nextLevel the first level not yet applied to state
+ * @return true if the checkpoint was restored
+ */
+bool loadCheckpoint(const string& path, uint64_t fingerprint, Matrix<DTYPE>& state, int& nextLevel) {
+    MappedFile file;
+    if (! file.open(path)) {
+        return false;
+    }
+    string err;
+    const FileHeader* hdr = checkHeader(file, QSIM_FILE_CHECKPOINT, err);
+    if (hdr != nullptr && hdr->fingerprint != fingerprint) {
+        err = "fingerprint mismatch, written for another circuit or input";
+        hdr = nullptr;
+    }
+    Matrix<DTYPE> restored;
+    if (hdr == nullptr || ! readMatrixPayload(*hdr, file.data + sizeof(FileHeader), restored, err)) {
+        cout << "[INFO] [Checkpoint] ignored " << path << ": " << err << endl;
+        return false;
+    }
+    state = move(restored);
+    nextLevel = hdr->nextLevel;
+    return true;
+}
+
+//
+// Utility functions
+//
+
+/**
+ * @brief Compute the checksum of the entries of a matrix
+ *
+ * @param mat the matrix
+ * @return uint64_t the checksum
+ */
+uint64_t matrixChecksum(const Matrix<DTYPE>& mat) {
+    Checksum64 cs;
+    for (ll i = 0; i < mat.row; ++ i) {
+        cs.update(mat.data[i], mat.col * sizeof(DTYPE));
+    }
+    return cs.value();
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "qcircuit.h"
+
+//
+// Binary file format (version QSIM_FORMAT_VERSION)
+//
+// Every file is a FileHeader followed by one payload:
+//  - QSIM_FILE_MATRIX: the matrix entries in row-major order, raw interleaved
+//    complex<double> (real, imag), or zero-run encoded if QSIM_FLAG_ZRLE is set
+//  - QSIM_FILE_CIRCUIT: a serialized QCircuit, see saveCircuit
+//  - QSIM_FILE_CHECKPOINT: a matrix payload, plus the circuit fingerprint and
+//    the next level to simulate in the header
+//
+// The zero-run encoding is a sequence of blocks (uint64 #zeros, uint64 #literals,
+// literals), which pays off for sparse state vectors and operation matrices.
+// The checksum covers the decoded payload, and the header has its own checksum.
+// Values are stored in the byte order of the writer, which is recorded in the
+// header and checked on load.
+//
+
+#define QSIM_FORMAT_VERSION 1
+#define QSIM_FLAG_ZRLE 1u
+
+enum QSimFileKind { QSIM_FILE_MATRIX = 1, QSIM_FILE_CIRCUIT = 2, QSIM_FILE_CHECKPOINT = 3 };
+
+struct FileHeader {
+    char magic[8]; // "QSIMBIN\0"
+    uint32_t version;
+    uint32_t kind; // QSimFileKind
+    uint32_t flags; // QSIM_FLAG_*
+    uint32_t byteOrder; // 0x01020304 as written by the writer
+    uint64_t fingerprint; // checkpoint: the fingerprint of the simulated circuit and input
+    int64_t nextLevel; // checkpoint: the first level not yet applied
+    int64_t rows; // the matrix shape, 0 for a circuit
+    int64_t cols;
+    uint64_t rawBytes; // the size of the decoded payload
+    uint64_t storedBytes; // the size of the payload in the file
+    uint64_t checksum; // the checksum of the decoded payload
+    uint64_t headerChecksum; // the checksum of all fields above
+};
+
+/**
+ * @brief A streaming 64-bit checksum over 8-byte words
+ *
+ * Updates of lengths that are multiples of 8 compose, i.e., update(a) then
+ * update(b) equals update(a + b).
+ */
+class Checksum64 {
+public:
+    uint64_t h;
+
+    Checksum64(uint64_t seed = 0x9e3779b97f4a7c15ULL);
+    void update(const void* p, size_t n);
+    uint64_t value() const;
+};
+
+//
+// Matrices
+//
+
+/**
+ * @brief Write a matrix to a binary file
+ *
+ * @param path the file path
+ * @param mat the matrix
+ * @param compress whether to zero-run encode the entries
+ */
+void saveMatrix(const string& path, const Matrix<DTYPE>& mat, bool compress = false);
+
+/**
+ * @brief Read a matrix from a binary file through mmap, verifying its checksum
+ *
+ * @param path the file path
+ * @return Matrix<DTYPE> the matrix
+ */
+Matrix<DTYPE> loadMatrix(const string& path);
+
+//
+// Circuits
+//
+
+/**
+ * @brief Write a quantum circuit to a binary file
+ *
+ * Each distinct gate matrix is stored once, with its MatrixDict key if any,
+ * and repeated blocks are stored recursively (without their cached powmat).
+ *
+ * @param path the file path
+ * @param qc the quantum circuit
+ */
+void saveCircuit(const string& path, QCircuit& qc);
+
+/**
+ * @brief Read a quantum circuit from a binary file
+ *
+ * Gate matrices with a MatrixDict key are shared with (or registered in) MatrixDict.
+ *
+ * @param path the file path
+ * @return QCircuit the quantum circuit
+ */
+QCircuit loadCircuit(const string& path);
+
+/**
+ * @brief Compute a fingerprint of a quantum circuit from its serialized form
+ *
+ * @param qc the quantum circuit
+ * @return uint64_t the fingerprint
+ */
+uint64_t circuitFingerprint(QCircuit& qc);
+
+//
+// Checkpoints
+//
+
+/**
+ * @brief Atomically write a simulation checkpoint
+ *
+ * The checkpoint is written to path.tmp and renamed to path, so a job killed
+ * while writing leaves the previous checkpoint intact.
+ *
+ * @param path the file path
+ * @param state the state vector or (partial) operation matrix
+ * @param nextLevel the first level not yet applied to state
+ * @param fingerprint the fingerprint of the simulated circuit and input
+ * @param compress whether to zero-run encode the entries
+ */
+void saveCheckpoint(const string& path, const Matrix<DTYPE>& state, int nextLevel, uint64_t fingerprint, bool compress = false);
+
+/**
+ * @brief Read a simulation checkpoint if it exists and matches the fingerprint
+ *
+ * @param path the file path
+ * @param fingerprint the fingerprint of the simulated circuit and input
+ * @param state the restored state vector or (partial) operation matrix
+ * @param nextLevel the first level not yet applied to state
+ * @return true if the checkpoint was restored
+ */
+bool loadCheckpoint(const string& path, uint64_t fingerprint, Matrix<DTYPE>& state, int& nextLevel);
+
+//
+// Utility functions
+//
+
+/**
+ * @brief Compute the checksum of the entries of a matrix
+ *
+ * @param mat the matrix
+ * @return uint64_t the checksum
+ */
+uint64_t matrixChecksum(const Matrix<DTYPE>& mat);
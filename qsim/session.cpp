@@ -0,0 +1,391 @@
+#include "session.h"
+
+#define CLEAN INT_MAX // dirtyFrom of a session without pending edits
+
+/**
+ * @brief Construct a session simulating the state vector(s) sv
+ *
+ * @param qc_ the quantum circuit
+ * @param sv the input state vector(s)
+ * @param memoryBudget_ the memory cap of the cached states in bytes
+ * @param numThreads_ the number of threads, 0 means all hardware threads
+ */
+SimSession::SimSession(QCircuit& qc_, Matrix<DTYPE>& sv, ll memoryBudget_, int numThreads_) {
+    if (sv.row != (1LL << qc_.numQubits)) {
+        cout << "[ERROR] SimSession: sv.row != 2^numQubits. " << endl;
+        exit(1);
+    }
+    qc = qc_;
+    input = sv;
+    operationMatrix = false;
+    memoryBudget = memoryBudget_;
+    numThreads = numThreads_;
+    suffix = nullptr;
+    suffixBegin = -1;
+    dirtyFrom = 0;
+    replaced = -1;
+    lastReplaced = -1;
+    runs = 0;
+    levelsApplied = 0;
+    suffixHits = 0;
+}
+
+/**
+ * @brief Construct a session simulating the operation matrix
+ *
+ * @param qc_ the quantum circuit
+ * @param memoryBudget_ the memory cap of the cached states in bytes
+ * @param numThreads_ the number of threads, 0 means all hardware threads
+ */
+SimSession::SimSession(QCircuit& qc_, ll memoryBudget_, int numThreads_) {
+    Matrix<DTYPE> ide;
+    ide.identity(1LL << qc_.numQubits);
+    *this = SimSession(qc_, ide, memoryBudget_, numThreads_);
+    operationMatrix = true;
+}
+
+//
+// Edits
+//
+
+/**
+ * @brief Replace all gates of a level
+ *
+ * @param level the level id
+ * @param gates the new gates, one per qubit as in QCircuit::gates
+ */
+void SimSession::replaceLevel(int level, vector<QGate>& gates) {
+    if (level < 0 || level >= qc.numDepths || (int)gates.size() != qc.numQubits) {
+        cout << "[ERROR] replaceLevel: invalid level " << level << " or gates.size() != numQubits. " << endl;
+        exit(1);
+    }
+    qc.gates[level] = gates;
+    qc.repeats.erase(level);
+    invalidate(level, 0);
+}
+
+/**
+ * @brief Replace a single-qubit gate, e.g., to change a rotation angle
+ *
+ * The replaced position must hold an IDE or another single-qubit gate.
+ *
+ * @param level the level id
+ * @param gate the new single-qubit gate
+ */
+void SimSession::replaceGate(int level, QGate& gate) {
+    if (level < 0 || level >= qc.numDepths || qc.isRepeat(level)) {
+        cout << "[ERROR] replaceGate: invalid level " << level << ". " << endl;
+        exit(1);
+    }
+    if (! gate.isSingle() && ! gate.isIDE()) {
+        cout << "[ERROR] replaceGate: " << gate.gname << " is not a single-qubit gate. " << endl;
+        exit(1);
+    }
+    int qid = gate.targetQubits[0];
+    QGate& old = qc.gates[level][qid];
+    if (! old.isSingle() && ! old.isIDE()) {
+        cout << "[ERROR] replaceGate: qubit " << qid << " of level " << level << " is occupied by " << old.gname << ". " << endl;
+        exit(1);
+    }
+    old = gate;
+    invalidate(level, 0);
+}
+
+/**
+ * @brief Insert a level before level, level = numDepths appends it
+ *
+ * @param level the level id of the new level
+ * @param gates the new gates, one per qubit as in QCircuit::gates
+ */
+void SimSession::insertLevel(int level, vector<QGate>& gates) {
+    if (level < 0 || level > qc.numDepths || (int)gates.size() != qc.numQubits) {
+        cout << "[ERROR] insertLevel: invalid level " << level << " or gates.size() != numQubits. " << endl;
+        exit(1);
+    }
+    qc.gates.insert(qc.gates.begin() + level, gates);
+    qc.numDepths ++;
+    map<int, QRepeat> shifted;
+    for (auto& it : qc.repeats) {
+        shifted[it.first < level ? it.first : it.first + 1] = it.second;
+    }
+    qc.repeats = shifted;
+    invalidate(level, 1);
+}
+
+/**
+ * @brief Remove a level
+ *
+ * @param level the level id
+ */
+void SimSession::removeLevel(int level) {
+    if (level < 0 || level >= qc.numDepths) {
+        cout << "[ERROR] removeLevel: invalid level " << level << ". " << endl;
+        exit(1);
+    }
+    qc.gates.erase(qc.gates.begin() + level);
+    qc.numDepths --;
+    map<int, QRepeat> shifted;
+    for (auto& it : qc.repeats) {
+        if (it.first != level) {
+            shifted[it.first < level ? it.first : it.first - 1] = it.second;
+        }
+    }
+    qc.repeats = shifted;
+    invalidate(level, -1);
+}
+
+/**
+ * @brief Declare that qc.gates[level] (or its repeated block) was modified in place
+ *
+ * @param level the level id
+ */
+void SimSession::touch(int level) {
+    if (level < 0 || level >= qc.numDepths) {
+        cout << "[ERROR] touch: invalid level " << level << ". " << endl;
+        exit(1);
+    }
+    if (qc.isRepeat(level)) {
+        // O_body^count is recomputed from the edited body by cacheRepeatMatrices
+        qc.repeats[level].powmat = nullptr;
+    }
+    invalidate(level, 0);
+}
+
+/**
+ * @brief Drop the cached states that depend on level
+ *
+ * The checkpoints after level are dropped, and the suffix product is dropped
+ * if it covers level, otherwise its begin is shifted.
+ *
+ * @param level the edited level
+ * @param shift 0 for a replacement, 1 for an insertion and -1 for a removal
+ */
+void SimSession::invalidate(int level, int shift) {
+    checkpoints.erase(checkpoints.upper_bound(level), checkpoints.end());
+    if (suffix != nullptr) {
+        bool covered = shift > 0 ? level > suffixBegin : level >= suffixBegin;
+        if (covered) {
+            suffix = nullptr;
+            suffixBegin = -1;
+        } else {
+            suffixBegin += shift;
+        }
+    }
+    // only a run of replacements of the same level can use the suffix product
+    if (shift == 0 && (dirtyFrom == CLEAN || replaced == level)) {
+        replaced = level;
+    } else {
+        replaced = -2;
+    }
+    dirtyFrom = min(dirtyFrom, level);
+}
+
+//
+// Simulation
+//
+
+/**
+ * @brief Return the final state vector(s), or the operation matrix
+ *
+ * @return Matrix<DTYPE>& the result, valid until the next edit
+ */
+Matrix<DTYPE>& SimSession::result() {
+    if (dirtyFrom == CLEAN) {
+        return output;
+    }
+    cacheRepeatMatrices(qc, input.col, numThreads);
+
+    // U = S_(k+1) * L_k * P_k if the same level k is replaced again and the product is cheaper
+    int k = replaced;
+    ll stateBytes = matrixBytes(input);
+    if (operationMatrix && k >= 0) {
+        bool cached = suffix != nullptr && suffixBegin == k + 1;
+        bool worth = 2 * suffixGates(k + 1) > input.row && memoryBudget >= 2 * stateBytes;
+        if (cached || (k == lastReplaced && worth)) {
+            runSuffixProduct(k);
+            lastReplaced = k;
+            replaced = -1;
+            dirtyFrom = CLEAN;
+            runs ++;
+            return output;
+        }
+    }
+
+    // re-run from the nearest checkpoint at or before the first edited level
+    auto it = checkpoints.upper_bound(dirtyFrom);
+    int start = 0;
+    Matrix<DTYPE> cur;
+    if (it != checkpoints.begin()) {
+        -- it;
+        start = it->first;
+        cur = it->second;
+    } else {
+        cur = input;
+    }
+    int stride = gridStride();
+    for (int lbegin = start; lbegin < qc.numDepths; ) {
+        int lend = stride == INT_MAX ? qc.numDepths : min(qc.numDepths, (lbegin / stride + 1) * stride);
+        parallelFor(0, cur.col, numThreads, [&](ll cbegin, ll cend) {
+            applyLevels(cur, qc, lbegin, lend, cbegin, cend);
+        });
+        levelsApplied += lend - lbegin;
+        lbegin = lend;
+        if (lbegin < qc.numDepths) {
+            storeCheckpoint(lbegin, cur, suffix == nullptr ? -1 : suffixBegin - 1);
+        }
+    }
+    output = move(cur);
+
+    lastReplaced = k >= 0 ? k : -1;
+    replaced = -1;
+    dirtyFrom = CLEAN;
+    runs ++;
+    return output;
+}
+
+/**
+ * @brief Compute the operation matrix as U = S_(k+1) * L_k * P_k
+ *
+ * The prefix product P_k is kept as a pinned checkpoint, and the suffix product
+ * S_(k+1) is computed if it is not cached.
+ *
+ * @param k the replaced level
+ */
+void SimSession::runSuffixProduct(int k) {
+    if (suffix == nullptr || suffixBegin != k + 1) {
+        suffix = nullptr; // release the old suffix product before computing the new one
+        Matrix<DTYPE> s;
+        s.identity(input.row);
+        parallelFor(0, s.col, numThreads, [&](ll cbegin, ll cend) {
+            applyLevels(s, qc, k + 1, qc.numDepths, cbegin, cend);
+        });
+        levelsApplied += qc.numDepths - k - 1;
+        suffix = make_shared<Matrix<DTYPE>>(move(s));
+        suffixBegin = k + 1;
+    } else {
+        suffixHits ++;
+    }
+
+    // the prefix product P_k, computed from the nearest checkpoint if it is not cached
+    auto it = checkpoints.upper_bound(k);
+    int start = 0;
+    if (it != checkpoints.begin()) {
+        -- it;
+        start = it->first;
+        output = it->second;
+    } else {
+        output = input;
+    }
+    if (start < k) {
+        parallelFor(0, output.col, numThreads, [&](ll cbegin, ll cend) {
+            applyLevels(output, qc, start, k, cbegin, cend);
+        });
+        levelsApplied += k - start;
+        storeCheckpoint(k, output, k);
+    }
+
+    parallelFor(0, output.col, numThreads, [&](ll cbegin, ll cend) {
+        applyLevels(output, qc, k, k + 1, cbegin, cend);
+        applyDense(output, *suffix, cbegin, cend);
+    });
+    levelsApplied ++;
+}
+
+/**
+ * @brief Store a copy of the state after levels [0, level) if the budget allows
+ *
+ * Checkpoints off the current grid are evicted first to make room.
+ *
+ * @param level the level id
+ * @param state the state after levels [0, level)
+ * @param pinned a checkpoint that is never evicted, -1 if none
+ */
+void SimSession::storeCheckpoint(int level, Matrix<DTYPE>& state, int pinned) {
+    if (level <= 0 || level >= qc.numDepths || checkpoints.count(level)) {
+        return;
+    }
+    ll stateBytes = matrixBytes(state);
+    int stride = gridStride();
+    auto evict = [&](bool gridToo) {
+        for (auto it = checkpoints.begin(); it != checkpoints.end() && checkpointBytes() + stateBytes > memoryBudget; ) {
+            bool onGrid = stride != INT_MAX && it->first % stride == 0;
+            if (it->first != pinned && (gridToo || ! onGrid)) {
+                it = checkpoints.erase(it);
+            } else {
+                ++ it;
+            }
+        }
+    };
+    evict(false);
+    if (level == pinned) {
+        evict(true); // the prefix product of the suffix path takes precedence over the grid
+    }
+    if (checkpointBytes() + stateBytes <= memoryBudget) {
+        checkpoints[level] = state;
+    }
+}
+
+/**
+ * @brief Return the distance between two grid checkpoints
+ *
+ * The grid holds as many evenly spaced levels as the budget left by the suffix
+ * product allows.
+ *
+ * @return int the stride, INT_MAX if no checkpoint fits
+ */
+int SimSession::gridStride() {
+    ll stateBytes = matrixBytes(input);
+    ll capacity = (memoryBudget - (suffix == nullptr ? 0 : stateBytes)) / stateBytes;
+    if (capacity <= 0) {
+        return INT_MAX;
+    }
+    return max(1LL, (qc.numDepths + capacity) / (capacity + 1));
+}
+
+/**
+ * @brief Return the bytes held by the checkpoints and the suffix product
+ *
+ * @return ll the bytes
+ */
+ll SimSession::checkpointBytes() {
+    ll bytes = suffix == nullptr ? 0 : matrixBytes(*suffix);
+    for (auto& it : checkpoints) {
+        bytes += matrixBytes(it.second);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Return the number of gates in levels [level, numDepths)
+ *
+ * @param level the first level
+ * @return ll the number of gates, with repeated blocks expanded
+ */
+ll SimSession::suffixGates(int level) {
+    ll cnt = 0;
+    for (int j = max(level, 0); j < qc.numDepths; ++ j) {
+        if (qc.isRepeat(j)) {
+            cnt += qc.repeats[j].count * qc.repeats[j].body->numGates();
+            continue;
+        }
+        for (int i = 0; i < qc.numQubits; ++ i) {
+            if (! qc.gates[j][i].isIDE() && ! qc.gates[j][i].isMARK()) {
+                cnt ++;
+            }
+        }
+    }
+    return cnt;
+}
+
+//
+// Utility functions
+//
+
+ll SimSession::numCheckpoints() {
+    return checkpoints.size();
+}
+
+void SimSession::printStats() {
+    cout << "[INFO] [SimSession] runs: [" << runs << "] levelsApplied: [" << levelsApplied << "] suffixHits: [" << suffixHits
+         << "] checkpoints: [" << checkpoints.size() << "] bytes held: [" << checkpointBytes() << " / " << memoryBudget << "]" << endl;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "omsim.h"
+
+/**
+ * @brief An incremental simulation of a circuit that is edited level by level
+ *
+ * The session keeps prefix checkpoints, i.e., the state after levels [0, L), on
+ * an evenly spaced grid of levels that fits in the memory budget. After an edit
+ * at level k, result() re-runs only from the nearest checkpoint at or before k,
+ * so the cost of an edit is about O(depth - k) levels instead of O(depth).
+ *
+ * A session without an input state simulates the operation matrix U. When the
+ * same level k is replaced repeatedly, it also caches the prefix product P_k and
+ * the suffix product S_(k+1) of the levels after k, so that U = S_(k+1) * L_k * P_k
+ * costs one level and one dense product per edit. This is used only when the
+ * dense product is cheaper than re-applying the suffix levels.
+ */
+class SimSession {
+private:
+    Matrix<DTYPE> input; // the input state vector(s), or the identity for an operation matrix
+    Matrix<DTYPE> output; // the state after all levels
+    map<int, Matrix<DTYPE>> checkpoints; // level L -> the state after levels [0, L)
+    shared_ptr<Matrix<DTYPE>> suffix; // the product of levels [suffixBegin, numDepths)
+    int suffixBegin;
+    int dirtyFrom; // the first level that changed since the last run, CLEAN (INT_MAX) if none
+    int replaced; // the single level replaced since the last run, -1 if none, -2 if the edits were not a single replacement
+    int lastReplaced; // the level replaced before the last run, -1 if none
+
+    void invalidate(int level, int shift); // Drop the cached states that depend on level
+    ll checkpointBytes(); // the bytes held by checkpoints and the suffix product
+    int gridStride(); // the distance between two grid checkpoints
+    void storeCheckpoint(int level, Matrix<DTYPE>& state, int pinned); // Store a checkpoint if the budget allows
+    ll suffixGates(int level); // the number of gates in levels [level, numDepths)
+    void runSuffixProduct(int k); // Compute U = S_(k+1) * L_k * P_k
+public:
+    QCircuit qc; // the simulated circuit, edited through the session
+    bool operationMatrix; // whether the session simulates the operation matrix
+    ll memoryBudget; // the memory cap of the checkpoints and the suffix product in bytes
+    int numThreads; // 0 means all hardware threads
+
+    ll runs; // the number of re-simulations
+    ll levelsApplied; // the number of levels applied by all runs
+    ll suffixHits; // the number of runs served by the cached suffix product
+
+    SimSession(QCircuit& qc_, Matrix<DTYPE>& sv, ll memoryBudget_ = 1LL << 30, int numThreads_ = 0);
+    SimSession(QCircuit& qc_, ll memoryBudget_ = 1LL << 30, int numThreads_ = 0);
+
+    //
+    // Edits
+    //
+    void replaceLevel(int level, vector<QGate>& gates); // Replace all gates of a level
+    void replaceGate(int level, QGate& gate); // Replace a single-qubit gate
+    void insertLevel(int level, vector<QGate>& gates); // Insert a level before level
+    void removeLevel(int level); // Remove a level
+    void touch(int level); // Declare that qc.gates[level] or its repeated block was modified in place
+
+    Matrix<DTYPE>& result(); // the final state vector(s), or the operation matrix
+    ll numCheckpoints();
+    void printStats();
+};
@@ -0,0 +1,504 @@
+#include "soa.h"
+#include "memory.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SOA_X86 1
+#include <immintrin.h>
+#endif
+
+#define SOA_ALIGN 64 // the alignment of the arrays, one cache line
+#define SOA_MIN_RUN 8 // runs shorter than this are updated by the scalar loop in place
+
+//
+// Kernels
+//
+// A 2x2 gate u is passed as 8 doubles: re/im of u00, u01, u10, u11. rotate
+// updates the pairs (a[k], b[k]) to (u00 a + u01 b, u10 a + u11 b), and axpy
+// computes y[k] += alpha * x[k], both over len entries.
+//
+
+typedef void (*RotateKernel)(double* ar, double* ai, double* br, double* bi, ll len, const double* u);
+typedef void (*AxpyKernel)(double* yr, double* yi, const double* xr, const double* xi, ll len, double alr, double ali);
+
+struct SoAKernels {
+    const char* name;
+    RotateKernel rotate;
+    AxpyKernel axpy;
+};
+
+static void rotateScalar(double* ar, double* ai, double* br, double* bi, ll len, const double* u) {
+    for (ll k = 0; k < len; ++ k) {
+        double xr = ar[k], xi = ai[k];
+        double yr = br[k], yi = bi[k];
+        ar[k] = u[0] * xr - u[1] * xi + u[2] * yr - u[3] * yi;
+        ai[k] = u[0] * xi + u[1] * xr + u[2] * yi + u[3] * yr;
+        br[k] = u[4] * xr - u[5] * xi + u[6] * yr - u[7] * yi;
+        bi[k] = u[4] * xi + u[5] * xr + u[6] * yi + u[7] * yr;
+    }
+}
+
+static void axpyScalar(double* yr, double* yi, const double* xr, const double* xi, ll len, double alr, double ali) {
+    for (ll k = 0; k < len; ++ k) {
+        yr[k] += alr * xr[k] - ali * xi[k];
+        yi[k] += alr * xi[k] + ali * xr[k];
+    }
+}
+
+#ifdef SOA_X86
+
+__attribute__((target("avx2,fma")))
+static void rotateAVX2(double* ar, double* ai, double* br, double* bi, ll len, const double* u) {
+    __m256d u00r = _mm256_set1_pd(u[0]), u00i = _mm256_set1_pd(u[1]);
+    __m256d u01r = _mm256_set1_pd(u[2]), u01i = _mm256_set1_pd(u[3]);
+    __m256d u10r = _mm256_set1_pd(u[4]), u10i = _mm256_set1_pd(u[5]);
+    __m256d u11r = _mm256_set1_pd(u[6]), u11i = _mm256_set1_pd(u[7]);
+    ll k = 0;
+    for (; k + 4 <= len; k += 4) {
+        __m256d xr = _mm256_loadu_pd(ar + k), xi = _mm256_loadu_pd(ai + k);
+        __m256d yr = _mm256_loadu_pd(br + k), yi = _mm256_loadu_pd(bi + k);
+        __m256d nr = _mm256_mul_pd(u00r, xr);
+        nr = _mm256_fnmadd_pd(u00i, xi, nr);
+        nr = _mm256_fmadd_pd(u01r, yr, nr);
+        nr = _mm256_fnmadd_pd(u01i, yi, nr);
+        __m256d ni = _mm256_mul_pd(u00r, xi);
+        ni = _mm256_fmadd_pd(u00i, xr, ni);
+        ni = _mm256_fmadd_pd(u01r, yi, ni);
+        ni = _mm256_fmadd_pd(u01i, yr, ni);
+        __m256d mr = _mm256_mul_pd(u10r, xr);
+        mr = _mm256_fnmadd_pd(u10i, xi, mr);
+        mr = _mm256_fmadd_pd(u11r, yr, mr);
+        mr = _mm256_fnmadd_pd(u11i, yi, mr);
+        __m256d mi = _mm256_mul_pd(u10r, xi);
+        mi = _mm256_fmadd_pd(u10i, xr, mi);
+        mi = _mm256_fmadd_pd(u11r, yi, mi);
+        mi = _mm256_fmadd_pd(u11i, yr, mi);
+        _mm256_storeu_pd(ar + k, nr);
+        _mm256_storeu_pd(ai + k, ni);
+        _mm256_storeu_pd(br + k, mr);
+        _mm256_storeu_pd(bi + k, mi);
+    }
+    rotateScalar(ar + k, ai + k, br + k, bi + k, len - k, u);
+}
+
+__attribute__((target("avx2,fma")))
+static void axpyAVX2(double* yr, double* yi, const double* xr, const double* xi, ll len, double alr, double ali) {
+    __m256d vr = _mm256_set1_pd(alr), vi = _mm256_set1_pd(ali);
+    ll k = 0;
+    for (; k + 4 <= len; k += 4) {
+        __m256d pr = _mm256_loadu_pd(xr + k), pi = _mm256_loadu_pd(xi + k);
+        __m256d sr = _mm256_fmadd_pd(vr, pr, _mm256_loadu_pd(yr + k));
+        __m256d si = _mm256_fmadd_pd(vr, pi, _mm256_loadu_pd(yi + k));
+        _mm256_storeu_pd(yr + k, _mm256_fnmadd_pd(vi, pi, sr));
+        _mm256_storeu_pd(yi + k, _mm256_fmadd_pd(vi, pr, si));
+    }
+    axpyScalar(yr + k, yi + k, xr + k, xi + k, len - k, alr, ali);
+}
+
+__attribute__((target("avx512f")))
+static void rotateAVX512(double* ar, double* ai, double* br, double* bi, ll len, const double* u) {
+    __m512d u00r = _mm512_set1_pd(u[0]), u00i = _mm512_set1_pd(u[1]);
+    __m512d u01r = _mm512_set1_pd(u[2]), u01i = _mm512_set1_pd(u[3]);
+    __m512d u10r = _mm512_set1_pd(u[4]), u10i = _mm512_set1_pd(u[5]);
+    __m512d u11r = _mm512_set1_pd(u[6]), u11i = _mm512_set1_pd(u[7]);
+    ll k = 0;
+    for (; k + 8 <= len; k += 8) {
+        __m512d xr = _mm512_loadu_pd(ar + k), xi = _mm512_loadu_pd(ai + k);
+        __m512d yr = _mm512_loadu_pd(br + k), yi = _mm512_loadu_pd(bi + k);
+        __m512d nr = _mm512_mul_pd(u00r, xr);
+        nr = _mm512_fnmadd_pd(u00i, xi, nr);
+        nr = _mm512_fmadd_pd(u01r, yr, nr);
+        nr = _mm512_fnmadd_pd(u01i, yi, nr);
+        __m512d ni = _mm512_mul_pd(u00r, xi);
+        ni = _mm512_fmadd_pd(u00i, xr, ni);
+        ni = _mm512_fmadd_pd(u01r, yi, ni);
+        ni = _mm512_fmadd_pd(u01i, yr, ni);
+        __m512d mr = _mm512_mul_pd(u10r, xr);
+        mr = _mm512_fnmadd_pd(u10i, xi, mr);
+        mr = _mm512_fmadd_pd(u11r, yr, mr);
+        mr = _mm512_fnmadd_pd(u11i, yi, mr);
+        __m512d mi = _mm512_mul_pd(u10r, xi);
+        mi = _mm512_fmadd_pd(u10i, xr, mi);
+        mi = _mm512_fmadd_pd(u11r, yi, mi);
+        mi = _mm512_fmadd_pd(u11i, yr, mi);
+        _mm512_storeu_pd(ar + k, nr);
+        _mm512_storeu_pd(ai + k, ni);
+        _mm512_storeu_pd(br + k, mr);
+        _mm512_storeu_pd(bi + k, mi);
+    }
+    rotateScalar(ar + k, ai + k, br + k, bi + k, len - k, u);
+}
+
+__attribute__((target("avx512f")))
+static void axpyAVX512(double* yr, double* yi, const double* xr, const double* xi, ll len, double alr, double ali) {
+    __m512d vr = _mm512_set1_pd(alr), vi = _mm512_set1_pd(ali);
+    ll k = 0;
+    for (; k + 8 <= len; k += 8) {
+        __m512d pr = _mm512_loadu_pd(xr + k), pi = _mm512_loadu_pd(xi + k);
+        __m512d sr = _mm512_fmadd_pd(vr, pr, _mm512_loadu_pd(yr + k));
+        __m512d si = _mm512_fmadd_pd(vr, pi, _mm512_loadu_pd(yi + k));
+        _mm512_storeu_pd(yr + k, _mm512_fnmadd_pd(vi, pi, sr));
+        _mm512_storeu_pd(yi + k, _mm512_fmadd_pd(vi, pr, si));
+    }
+    axpyScalar(yr + k, yi + k, xr + k, xi + k, len - k, alr, ali);
+}
+
+#endif
+
+static const SoAKernels SCALAR_KERNELS = {"scalar", rotateScalar, axpyScalar};
+#ifdef SOA_X86
+static const SoAKernels AVX2_KERNELS = {"avx2", rotateAVX2, axpyAVX2};
+static const SoAKernels AVX512_KERNELS = {"avx512", rotateAVX512, axpyAVX512};
+#endif
+
+// Check if the CPU supports the named kernels
+static const SoAKernels* supportedKernels(const string& name) {
+#ifdef SOA_X86
+    __builtin_cpu_init();
+    if (name == "avx512" && __builtin_cpu_supports("avx512f")) {
+        return &AVX512_KERNELS;
+    }
+    if (name == "avx2" && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return &AVX2_KERNELS;
+    }
+#endif
+    return name == "scalar" ? &SCALAR_KERNELS : nullptr;
+}
+
+// Pick the widest kernels the CPU supports
+static const SoAKernels* chooseKernels() {
+    for (const char* name : {"avx512", "avx2"}) {
+        if (supportedKernels(name) != nullptr) {
+            return supportedKernels(name);
+        }
+    }
+    return &SCALAR_KERNELS;
+}
+
+static atomic<const SoAKernels*> ActiveKernels(nullptr);
+
+static const SoAKernels& kernels() {
+    const SoAKernels* k = ActiveKernels.load();
+    if (k == nullptr) {
+        k = chooseKernels();
+        ActiveKernels.store(k);
+    }
+    return *k;
+}
+
+/**
+ * @brief Return the name of the kernels chosen at run time
+ *
+ * @return const char* "avx512", "avx2" or "scalar"
+ */
+const char* soaKernelName() {
+    return kernels().name;
+}
+
+/**
+ * @brief Force the named kernels, e.g., to compare them in benchmarks
+ *
+ * @param name "avx512", "avx2" or "scalar"
+ * @return true if the CPU supports them
+ */
+bool soaUseKernels(const string& name) {
+    const SoAKernels* k = supportedKernels(name);
+    if (k == nullptr) {
+        return false;
+    }
+    ActiveKernels.store(k);
+    return true;
+}
+
+//
+// SoAMatrix
+//
+
+// Default constructor
+SoAMatrix::SoAMatrix() {
+    row = 0;
+    col = 0;
+    re = nullptr;
+    im = nullptr;
+}
+
+// Initialize a all-zero matrix
+SoAMatrix::SoAMatrix(ll r, ll c) {
+    allocate(r, c);
+}
+
+// Convert from the interleaved layout
+SoAMatrix::SoAMatrix(const Matrix<DTYPE>& mat) {
+    allocate(mat.row, mat.col);
+    for (ll i = 0; i < row; ++ i) {
+        const DTYPE* src = mat.data[i];
+        double* dr = re + i * col;
+        double* di = im + i * col;
+        for (ll j = 0; j < col; ++ j) {
+            dr[j] = src[j].real();
+            di[j] = src[j].imag();
+        }
+    }
+}
+
+// Copy constructor
+SoAMatrix::SoAMatrix(const SoAMatrix& matrx) {
+    allocate(matrx.row, matrx.col);
+    memcpy(re, matrx.re, row * col * sizeof(double));
+    memcpy(im, matrx.im, row * col * sizeof(double));
+}
+
+// Move constructor
+SoAMatrix::SoAMatrix(SoAMatrix&& matrx) {
+    row = matrx.row;
+    col = matrx.col;
+    re = matrx.re;
+    im = matrx.im;
+    matrx.row = 0;
+    matrx.col = 0;
+    matrx.re = nullptr;
+    matrx.im = nullptr;
+}
+
+// Copy assignment
+SoAMatrix& SoAMatrix::operator=(const SoAMatrix& matrx) {
+    if (this != &matrx) {
+        clear();
+        allocate(matrx.row, matrx.col);
+        memcpy(re, matrx.re, row * col * sizeof(double));
+        memcpy(im, matrx.im, row * col * sizeof(double));
+    }
+    return *this;
+}
+
+// Move assignment
+SoAMatrix& SoAMatrix::operator=(SoAMatrix&& matrx) {
+    if (this != &matrx) {
+        clear();
+        row = matrx.row;
+        col = matrx.col;
+        re = matrx.re;
+        im = matrx.im;
+        matrx.row = 0;
+        matrx.col = 0;
+        matrx.re = nullptr;
+        matrx.im = nullptr;
+    }
+    return *this;
+}
+
+// Matrix multiplication C = A * B, row i of C accumulates A(i,k) * row k of B
+SoAMatrix SoAMatrix::operator*(const SoAMatrix& matrx) const {
+    if (col != matrx.row) {
+        cout << "[ERROR] SoAMatrix *: col != matrx.row. " << endl;
+        exit(1);
+    }
+    AxpyKernel axpy = kernels().axpy;
+    SoAMatrix temp(row, matrx.col);
+    for (ll i = 0; i < row; ++ i) {
+        double* cr = temp.re + i * temp.col;
+        double* ci = temp.im + i * temp.col;
+        for (ll k = 0; k < col; ++ k) {
+            double ar = re[i * col + k], ai = im[i * col + k];
+            if (ar == 0.0 && ai == 0.0) {
+                continue;
+            }
+            axpy(cr, ci, matrx.re + k * matrx.col, matrx.im + k * matrx.col, matrx.col, ar, ai);
+        }
+    }
+    return temp;
+}
+
+// Tensor product C = A tensorProduct B
+SoAMatrix SoAMatrix::tensorProduct(const SoAMatrix& matrx) const {
+    AxpyKernel axpy = kernels().axpy;
+    SoAMatrix temp(row * matrx.row, col * matrx.col);
+    for (ll ar = 0; ar < row; ++ ar) {
+        for (ll ac = 0; ac < col; ++ ac) {
+            double vr = re[ar * col + ac], vi = im[ar * col + ac];
+            if (vr == 0.0 && vi == 0.0) {
+                continue;
+            }
+            for (ll br = 0; br < matrx.row; ++ br) {
+                ll offset = (ar * matrx.row + br) * temp.col + ac * matrx.col;
+                axpy(temp.re + offset, temp.im + offset, matrx.re + br * matrx.col, matrx.im + br * matrx.col, matrx.col, vr, vi);
+            }
+        }
+    }
+    return temp;
+}
+
+// Set the matrix to be an identity matrix
+void SoAMatrix::identity(ll r) {
+    clear();
+    allocate(r, r);
+    for (ll i = 0; i < r; ++ i) {
+        re[i * r + i] = 1;
+    }
+}
+
+// Convert to the interleaved layout
+Matrix<DTYPE> SoAMatrix::toMatrix() const {
+    Matrix<DTYPE> mat(row, col);
+    for (ll i = 0; i < row; ++ i) {
+        DTYPE* dst = mat.data[i];
+        const double* sr = re + i * col;
+        const double* si = im + i * col;
+        for (ll j = 0; j < col; ++ j) {
+            dst[j] = DTYPE(sr[j], si[j]);
+        }
+    }
+    return mat;
+}
+
+// Allocate zeroed arrays, see memory.h for the placement of large ones
+void SoAMatrix::allocate(ll r, ll c) {
+    row = r;
+    col = c;
+    bool empty = r * c == 0;
+    re = (double*)allocBlock(empty ? 1 : r, empty ? SOA_ALIGN : c * sizeof(double));
+    im = (double*)allocBlock(empty ? 1 : r, empty ? SOA_ALIGN : c * sizeof(double));
+}
+
+// Free the arrays
+void SoAMatrix::clear() {
+    freeBlock(re);
+    freeBlock(im);
+    row = 0;
+    col = 0;
+    re = nullptr;
+    im = nullptr;
+}
+
+// Destructor
+SoAMatrix::~SoAMatrix() {
+    clear();
+}
+
+//
+// Gate application
+//
+
+/**
+ * @brief Apply a 2x2 matrix to the amplitude pairs (i, i|2^targ), where all bits in cmask are 1
+ *
+ * The rows are visited in runs of 2^m rows, where m is the lowest bit of the
+ * target and the controls. Inside a run only the free low bits change, so each
+ * run and its partner are contiguous in both arrays.
+ *
+ * @param mat the state vector(s)
+ * @param u the 2x2 matrix, 8 doubles
+ * @param targ the target qubit
+ * @param cmask the mask of control qubits, 0 for an uncontrolled gate
+ */
+static void soaApply2x2(SoAMatrix& mat, const double* u, int targ, ll cmask) {
+    int m = targ;
+    for (int q = 0; q < targ; ++ q) {
+        if (cmask & (1LL << q)) {
+            m = q;
+            break;
+        }
+    }
+    ll tmask = 1LL << targ;
+    ll step = 1LL << m;
+    ll run = step * mat.col;
+    ll offset = tmask * mat.col;
+    RotateKernel rotate = run >= SOA_MIN_RUN ? kernels().rotate : rotateScalar;
+    for (ll base = 0; base < mat.row; base += step) {
+        if ((base & tmask) != 0 || (base & cmask) != cmask) {
+            continue;
+        }
+        ll s = base * mat.col;
+        rotate(mat.re + s, mat.im + s, mat.re + s + offset, mat.im + s + offset, run, u);
+    }
+}
+
+/**
+ * @brief Apply a gate in place to all columns of mat
+ *
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param gate the processing gate
+ */
+void soaApplyGate(SoAMatrix& mat, QGate& gate) {
+    if (gate.isIDE() || gate.isMARK()) {
+        return;
+    }
+    if (gate.isSingle() || gate.is2QubitControlled()) {
+        Matrix<DTYPE>& g = *gate.gmat;
+        double u[8] = {g.data[0][0].real(), g.data[0][0].imag(), g.data[0][1].real(), g.data[0][1].imag(),
+                       g.data[1][0].real(), g.data[1][0].imag(), g.data[1][1].real(), g.data[1][1].imag()};
+        ll cmask = gate.controlQubits.empty() ? 0 : 1LL << gate.controlQubits[0];
+        soaApply2x2(mat, u, gate.targetQubits[0], cmask);
+        return;
+    }
+    if (gate.gname == "SWAP") {
+        // rows with bit q0 = 1 and bit q1 = 0 trade places with their partners in runs of 2^min(q0, q1) rows
+        int q0 = gate.targetQubits[0], q1 = gate.targetQubits[1];
+        ll mask0 = 1LL << q0;
+        ll mask1 = 1LL << q1;
+        ll step = 1LL << min(q0, q1);
+        ll run = step * mat.col;
+        ll offset = (mask1 - mask0) * mat.col; // the partner of row i is i - 2^q0 + 2^q1
+        for (ll base = 0; base < mat.row; base += step) {
+            if ((base & mask0) == mask0 && (base & mask1) == 0) {
+                ll s = base * mat.col;
+                swap_ranges(mat.re + s, mat.re + s + run, mat.re + s + offset);
+                swap_ranges(mat.im + s, mat.im + s + run, mat.im + s + offset);
+            }
+        }
+        return;
+    }
+    cout << "[ERROR] soaApplyGate: " << gate.gname << " not implemented" << endl;
+    exit(1);
+}
+
+/**
+ * @brief Apply all levels of a quantum circuit in place, repeated blocks included
+ *
+ * @param mat the state vector(s), mat.row = 2^numQubits
+ * @param qc the quantum circuit
+ */
+void soaApplyCircuit(SoAMatrix& mat, QCircuit& qc) {
+    if (mat.row != (1LL << qc.numQubits)) {
+        cout << "[ERROR] soaApplyCircuit: mat.row != 2^numQubits. " << endl;
+        exit(1);
+    }
+    for (int j = 0; j < qc.numDepths; ++ j) {
+        if (qc.isRepeat(j)) {
+            QRepeat& rep = qc.repeats.find(j)->second;
+            for (ll r = 0; r < rep.count; ++ r) {
+                soaApplyCircuit(mat, *rep.body);
+            }
+            continue;
+        }
+        for (auto& gate : qc.gates[j]) {
+            soaApplyGate(mat, gate);
+        }
+    }
+}
+
+/**
+ * @brief Conduct state vector simulation in the SoA layout
+ *
+ * @param sv the state vector(s), converted in and out
+ * @param qc the quantum circuit
+ */
+void SVSimSoA(Matrix<DTYPE>& sv, QCircuit& qc) {
+    SoAMatrix mat(sv);
+    soaApplyCircuit(mat, qc);
+    sv = mat.toMatrix();
+}
+
+/**
+ * @brief Conduct operation matrix simulation in the SoA layout
+ *
+ * @param sv the state vector, updated to opmat * sv
+ * @param qc the quantum circuit
+ * @return Matrix<DTYPE> the operation matrix
+ */
+Matrix<DTYPE> OMSimSoA(Matrix<DTYPE>& sv, QCircuit& qc) {
+    SoAMatrix opmat;
+    opmat.identity(1LL << qc.numQubits);
+    soaApplyCircuit(opmat, qc);
+    sv = (opmat * SoAMatrix(sv)).toMatrix();
+    return opmat.toMatrix();
+}
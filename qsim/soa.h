@@ -0,0 +1,98 @@
+#pragma once
+
+#include "qcircuit.h"
+
+//
+// Split real/imaginary (SoA) layout
+//
+// SoAMatrix keeps the real and the imaginary parts of a matrix in two separate
+// 64-byte aligned arrays, both row-major. A 2x2 gate on target t then updates
+// two contiguous runs of 2^t * col amplitudes, and every SIMD lane holds a useful
+// double instead of half a complex number. The kernels are chosen once at run
+// time: AVX-512F, AVX2+FMA, or portable scalar code. Convert from and to
+// Matrix<DTYPE> at API boundaries.
+//
+
+class SoAMatrix {
+private:
+    void allocate(ll r, ll c); // Allocate zeroed arrays
+    void clear(); // Free the arrays
+public:
+    ll row, col;
+    double* re; // the real parts, re[i * col + j]
+    double* im; // the imaginary parts
+
+    //
+    // Constructors
+    //
+    SoAMatrix(); // Default constructor
+    SoAMatrix(ll r, ll c); // Initialize a all-zero matrix
+    SoAMatrix(const Matrix<DTYPE>& mat); // Convert from the interleaved layout
+    SoAMatrix(const SoAMatrix& matrx); // Copy constructor
+    SoAMatrix(SoAMatrix&& matrx); // Move constructor
+
+    //
+    // Operations
+    //
+    SoAMatrix& operator=(const SoAMatrix& matrx); // Copy assignment
+    SoAMatrix& operator=(SoAMatrix&& matrx); // Move assignment
+
+    SoAMatrix operator*(const SoAMatrix& matrx) const; // Matrix multiplication
+    SoAMatrix tensorProduct(const SoAMatrix& matrx) const; // Tensor product
+
+    void identity(ll r); // Set the matrix to be an identity matrix
+    Matrix<DTYPE> toMatrix() const; // Convert to the interleaved layout
+
+    //
+    // Destructor
+    //
+    ~SoAMatrix();
+};
+
+/**
+ * @brief Return the name of the kernels chosen at run time
+ *
+ * @return const char* "avx512", "avx2" or "scalar"
+ */
+const char* soaKernelName();
+
+/**
+ * @brief Force the named kernels, e.g., to compare them in benchmarks
+ *
+ * @param name "avx512", "avx2" or "scalar"
+ * @return true if the CPU supports them
+ */
+bool soaUseKernels(const string& name);
+
+/**
+ * @brief Apply a gate in place to all columns of mat
+ *
+ * @param mat the state vector(s), mat.row = 2^n
+ * @param gate the processing gate
+ */
+void soaApplyGate(SoAMatrix& mat, QGate& gate);
+
+/**
+ * @brief Apply all levels of a quantum circuit in place, repeated blocks included
+ *
+ * @param mat the state vector(s), mat.row = 2^numQubits
+ * @param qc the quantum circuit
+ */
+void soaApplyCircuit(SoAMatrix& mat, QCircuit& qc);
+
+/**
+ * @brief Conduct state vector simulation in the SoA layout
+ *
+ * @param sv the state vector(s), converted in and out
+ * @param qc the quantum circuit
+ */
+void SVSimSoA(Matrix<DTYPE>& sv, QCircuit& qc);
+
+/**
+ * @brief Conduct operation matrix simulation in the SoA layout
+ *
+ * @param sv the state vector, updated to opmat * sv
+ * @param qc the quantum circuit
+ * @return Matrix<DTYPE> the operation matrix
+ */
+Matrix<DTYPE> OMSimSoA(Matrix<DTYPE>& sv, QCircuit& qc);
@@ -0,0 +1,350 @@
+#include "sparse.h"
+
+//
+// Constructors of SparseMatrix
+//
+
+// Default constructor
+template<typename T>
+SparseMatrix<T>::SparseMatrix() {
+    row = 0;
+    col = 0;
+    rowPtr.assign(1, 0);
+}
+
+// Initialize an all-zero matrix
+template<typename T>
+SparseMatrix<T>::SparseMatrix(ll r, ll c) {
+    row = r;
+    col = c;
+    rowPtr.assign(row + 1, 0);
+}
+
+// Convert a dense matrix, dropping zeros
+template<typename T>
+SparseMatrix<T>::SparseMatrix(const Matrix<T>& matrx) {
+    row = matrx.row;
+    col = matrx.col;
+    rowPtr.assign(1, 0);
+    for (ll i = 0; i < row; i++) {
+        for (ll j = 0; j < col; j++) {
+            if (matrx.data[i][j] != T{0}) {
+                colIdx.push_back(j);
+                vals.push_back(matrx.data[i][j]);
+            }
+        }
+        rowPtr.push_back(colIdx.size());
+    }
+}
+
+// Build from (row, col, val) triplets; duplicates are summed
+template<typename T>
+SparseMatrix<T>::SparseMatrix(ll r, ll c, vector<tuple<ll, ll, T>> triplets) {
+    row = r;
+    col = c;
+    sort(triplets.begin(), triplets.end(), [](const tuple<ll, ll, T>& a, const tuple<ll, ll, T>& b) {
+        return get<0>(a) != get<0>(b) ? get<0>(a) < get<0>(b) : get<1>(a) < get<1>(b);
+    });
+    rowPtr.assign(row + 1, 0);
+    for (auto& t : triplets) {
+        if (get<0>(t) < 0 || get<0>(t) >= row || get<1>(t) < 0 || get<1>(t) >= col) {
+            cout << "[ERROR] SparseMatrix: triplet out of range. " << endl;
+            exit(1);
+        }
+        if (! colIdx.empty() && rowPtr[get<0>(t) + 1] > 0 && colIdx.back() == get<1>(t)) {
+            vals.back() += get<2>(t);
+            continue;
+        }
+        colIdx.push_back(get<1>(t));
+        vals.push_back(get<2>(t));
+        rowPtr[get<0>(t) + 1] ++;
+    }
+    for (ll i = 0; i < row; i++) {
+        rowPtr[i + 1] += rowPtr[i];
+    }
+}
+
+//
+// Operations
+//
+
+// Sparse multiplication C = A * B (Gustavson's row-by-row algorithm)
+template<typename T>
+SparseMatrix<T> SparseMatrix<T>::operator*(const SparseMatrix<T>& matrx) const {
+    if (col != matrx.row) {
+        cout << "[ERROR] SparseMatrix *: col != matrx.row. " << endl;
+        exit(1);
+    }
+    SparseMatrix<T> temp(row, matrx.col);
+    vector<T> acc(matrx.col, T{0});
+    vector<ll> mark(matrx.col, -1);
+    vector<ll> touched;
+    for (ll i = 0; i < row; i++) {
+        touched.clear();
+        for (ll a = rowPtr[i]; a < rowPtr[i + 1]; a++) {
+            ll k = colIdx[a];
+            for (ll b = matrx.rowPtr[k]; b < matrx.rowPtr[k + 1]; b++) {
+                ll j = matrx.colIdx[b];
+                if (mark[j] != i) {
+                    mark[j] = i;
+                    acc[j] = T{0};
+                    touched.push_back(j);
+                }
+                acc[j] += vals[a] * matrx.vals[b];
+            }
+        }
+        sort(touched.begin(), touched.end());
+        for (ll j : touched) {
+            if (abs(acc[j]) > SPARSE_EPS) {
+                temp.colIdx.push_back(j);
+                temp.vals.push_back(acc[j]);
+            }
+        }
+        temp.rowPtr[i + 1] = temp.colIdx.size();
+    }
+    return temp;
+}
+
+// Sparse * dense multiplication C = A * B, O(nnz(A) * B.col)
+template<typename T>
+Matrix<T> SparseMatrix<T>::operator*(const Matrix<T>& matrx) const {
+    if (col != matrx.row) {
+        cout << "[ERROR] SparseMatrix *: col != matrx.row. " << endl;
+        exit(1);
+    }
+    Matrix<T> temp(row, matrx.col);
+    for (ll i = 0; i < row; i++) {
+        T* out = temp.data[i];
+        for (ll a = rowPtr[i]; a < rowPtr[i + 1]; a++) {
+            const T* in = matrx.data[colIdx[a]];
+            T v = vals[a];
+            for (ll j = 0; j < matrx.col; j++) {
+                out[j] += v * in[j];
+            }
+        }
+    }
+    return temp;
+}
+
+// Tensor product C = A tensorProduct B
+template<typename T>
+SparseMatrix<T> SparseMatrix<T>::tensorProduct(const SparseMatrix<T>& matrx) const {
+    SparseMatrix<T> temp(row * matrx.row, col * matrx.col);
+    temp.colIdx.reserve(nnz() * matrx.nnz());
+    temp.vals.reserve(nnz() * matrx.nnz());
+    for (ll ar = 0; ar < row; ar++) {
+        for (ll br = 0; br < matrx.row; br++) {
+            for (ll a = rowPtr[ar]; a < rowPtr[ar + 1]; a++) {
+                for (ll b = matrx.rowPtr[br]; b < matrx.rowPtr[br + 1]; b++) {
+                    temp.colIdx.push_back(colIdx[a] * matrx.col + matrx.colIdx[b]);
+                    temp.vals.push_back(vals[a] * matrx.vals[b]);
+                }
+            }
+            temp.rowPtr[ar * matrx.row + br + 1] = temp.colIdx.size();
+        }
+    }
+    return temp;
+}
+
+// Set the matrix to be an identity matrix
+template<typename T>
+void SparseMatrix<T>::identity(ll r) {
+    row = r;
+    col = r;
+    rowPtr.resize(r + 1);
+    colIdx.resize(r);
+    vals.assign(r, T{1});
+    for (ll i = 0; i < r; i++) {
+        rowPtr[i] = i;
+        colIdx[i] = i;
+    }
+    rowPtr[r] = r;
+}
+
+// Return the number of non-zeros
+template<typename T>
+ll SparseMatrix<T>::nnz() const {
+    return vals.size();
+}
+
+// Return nnz / (row * col)
+template<typename T>
+double SparseMatrix<T>::density() const {
+    return row * col == 0 ? 0.0 : (double)nnz() / ((double)row * col);
+}
+
+// Check if the matrix is a zero matrix
+template<typename T>
+bool SparseMatrix<T>::isZero() const {
+    for (auto& v : vals) {
+        if (v != T{0}) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check if every row and every column has exactly one non-zero
+template<typename T>
+bool SparseMatrix<T>::isMonomial() const {
+    if (row != col || nnz() != row) {
+        return false;
+    }
+    vector<bool> seen(col, false);
+    for (ll i = 0; i < row; i++) {
+        if (rowPtr[i + 1] - rowPtr[i] != 1 || seen[colIdx[rowPtr[i]]]) {
+            return false;
+        }
+        seen[colIdx[rowPtr[i]]] = true;
+    }
+    return true;
+}
+
+//
+// Conversions
+//
+
+template<typename T>
+Matrix<T> SparseMatrix<T>::toDense() const {
+    Matrix<T> temp(row, col);
+    for (ll i = 0; i < row; i++) {
+        for (ll a = rowPtr[i]; a < rowPtr[i + 1]; a++) {
+            temp.data[i][colIdx[a]] = vals[a];
+        }
+    }
+    return temp;
+}
+
+template<typename T>
+MonomialMatrix<T> SparseMatrix<T>::toMonomial() const {
+    if (! isMonomial()) {
+        cout << "[ERROR] SparseMatrix toMonomial: the matrix is not monomial. " << endl;
+        exit(1);
+    }
+    MonomialMatrix<T> temp;
+    temp.dim = row;
+    temp.perm.resize(row);
+    temp.phase.resize(row);
+    for (ll i = 0; i < row; i++) {
+        ll j = colIdx[rowPtr[i]];
+        temp.perm[j] = i;
+        temp.phase[j] = vals[rowPtr[i]];
+    }
+    return temp;
+}
+
+//
+// Utility functions
+//
+
+// Print the non-zeros
+template<typename T>
+void SparseMatrix<T>::print() const {
+    cout << "----- SparseMatrix: [" << row << "] * [" << col << "] nnz: [" << nnz() << "] -----" << endl;
+    for (ll i = 0; i < row; i++) {
+        for (ll a = rowPtr[i]; a < rowPtr[i + 1]; a++) {
+            cout << "(" << i << ", " << colIdx[a] << ")\t" << fixed << setprecision(2) << vals[a] << endl;
+        }
+    }
+}
+
+//
+// MonomialMatrix
+//
+
+// Default constructor
+template<typename T>
+MonomialMatrix<T>::MonomialMatrix() {
+    dim = 0;
+}
+
+// Monomial multiplication C = A * B: column j of B goes to row pB[j], then to row pA[pB[j]]
+template<typename T>
+MonomialMatrix<T> MonomialMatrix<T>::operator*(const MonomialMatrix<T>& matrx) const {
+    if (dim != matrx.dim) {
+        cout << "[ERROR] MonomialMatrix *: dim != matrx.dim. " << endl;
+        exit(1);
+    }
+    MonomialMatrix<T> temp;
+    temp.dim = dim;
+    temp.perm.resize(dim);
+    temp.phase.resize(dim);
+    for (ll j = 0; j < dim; j++) {
+        ll k = matrx.perm[j];
+        temp.perm[j] = perm[k];
+        temp.phase[j] = phase[k] * matrx.phase[j];
+    }
+    return temp;
+}
+
+// Monomial * dense multiplication C = A * B: row perm[k] of C is phase[k] * row k of B
+template<typename T>
+Matrix<T> MonomialMatrix<T>::operator*(const Matrix<T>& matrx) const {
+    if (dim != matrx.row) {
+        cout << "[ERROR] MonomialMatrix *: dim != matrx.row. " << endl;
+        exit(1);
+    }
+    Matrix<T> temp(dim, matrx.col);
+    for (ll k = 0; k < dim; k++) {
+        T* out = temp.data[perm[k]];
+        const T* in = matrx.data[k];
+        for (ll j = 0; j < matrx.col; j++) {
+            out[j] = phase[k] * in[j];
+        }
+    }
+    return temp;
+}
+
+// Tensor product C = A tensorProduct B
+template<typename T>
+MonomialMatrix<T> MonomialMatrix<T>::tensorProduct(const MonomialMatrix<T>& matrx) const {
+    MonomialMatrix<T> temp;
+    temp.dim = dim * matrx.dim;
+    temp.perm.resize(temp.dim);
+    temp.phase.resize(temp.dim);
+    for (ll a = 0; a < dim; a++) {
+        for (ll b = 0; b < matrx.dim; b++) {
+            temp.perm[a * matrx.dim + b] = perm[a] * matrx.dim + matrx.perm[b];
+            temp.phase[a * matrx.dim + b] = phase[a] * matrx.phase[b];
+        }
+    }
+    return temp;
+}
+
+// Set the matrix to be an identity matrix
+template<typename T>
+void MonomialMatrix<T>::identity(ll r) {
+    dim = r;
+    perm.resize(r);
+    phase.assign(r, T{1});
+    for (ll j = 0; j < r; j++) {
+        perm[j] = j;
+    }
+}
+
+template<typename T>
+SparseMatrix<T> MonomialMatrix<T>::toSparse() const {
+    SparseMatrix<T> temp(dim, dim);
+    temp.colIdx.resize(dim);
+    temp.vals.resize(dim);
+    for (ll j = 0; j < dim; j++) {
+        temp.colIdx[perm[j]] = j;
+        temp.vals[perm[j]] = phase[j];
+    }
+    for (ll i = 0; i <= dim; i++) {
+        temp.rowPtr[i] = i;
+    }
+    return temp;
+}
+
+template<typename T>
+Matrix<T> MonomialMatrix<T>::toDense() const {
+    Matrix<T> temp(dim, dim);
+    for (ll j = 0; j < dim; j++) {
+        temp.data[perm[j]][j] = phase[j];
+    }
+    return temp;
+}
+
+template class SparseMatrix<DTYPE>;
+template class MonomialMatrix<DTYPE>;
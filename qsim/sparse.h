@@ -0,0 +1,81 @@
+#pragma once
+
+#include "matrix.h"
+
+#define SPARSE_EPS 1e-14 // entries with a smaller magnitude are dropped from sparse products
+
+template <typename T>
+class MonomialMatrix;
+
+/**
+ * @brief A sparse matrix in the CSR (compressed sparse row) format
+ * 
+ * The non-zeros of row i are vals[rowPtr[i] .. rowPtr[i+1]) at columns 
+ * colIdx[rowPtr[i] .. rowPtr[i+1]), sorted by column. 
+ */
+template <typename T>
+class SparseMatrix {
+public:
+    ll row, col;
+    vector<ll> rowPtr; // row + 1 offsets
+    vector<ll> colIdx; // the column of each non-zero
+    vector<T> vals; // the value of each non-zero
+
+    //
+    // Constructors
+    //
+    SparseMatrix(); // Default constructor
+    SparseMatrix(ll r, ll c); // Initialize an all-zero matrix
+    explicit SparseMatrix(const Matrix<T>& matrx); // Convert a dense matrix, dropping zeros
+    SparseMatrix(ll r, ll c, vector<tuple<ll, ll, T>> triplets); // Build from (row, col, val) triplets
+
+    //
+    // Operations
+    //
+    SparseMatrix operator*(const SparseMatrix& matrx) const; // Sparse * sparse
+    Matrix<T> operator*(const Matrix<T>& matrx) const; // Sparse * dense
+    SparseMatrix tensorProduct(const SparseMatrix& matrx) const; // Tensor product
+
+    void identity(ll r); // Set the matrix to be an identity matrix
+
+    ll nnz() const; // the number of non-zeros
+    double density() const; // nnz / (row * col)
+    bool isZero() const; // Check if the matrix is a zero matrix, O(nnz)
+    bool isMonomial() const; // Check if every row and every column has exactly one non-zero
+
+    //
+    // Conversions
+    //
+    Matrix<T> toDense() const;
+    MonomialMatrix<T> toMonomial() const;
+
+    //
+    // Utility functions
+    //
+    void print() const; // Print the non-zeros
+};
+
+/**
+ * @brief A monomial matrix, i.e., a permutation matrix times a diagonal phase matrix
+ * 
+ * Column j has its only non-zero phase[j] at row perm[j]. Products of X, Y, Z, 
+ * CX, CY, CZ, SWAP and RZ gates stay monomial and take O(2^n) memory. 
+ */
+template <typename T>
+class MonomialMatrix {
+public:
+    ll dim;
+    vector<ll> perm; // column j -> the row of its non-zero
+    vector<T> phase; // column j -> the value of its non-zero
+
+    MonomialMatrix(); // Default constructor
+
+    MonomialMatrix operator*(const MonomialMatrix& matrx) const; // Monomial * monomial, O(dim)
+    Matrix<T> operator*(const Matrix<T>& matrx) const; // Monomial * dense, O(dim * matrx.col)
+    MonomialMatrix tensorProduct(const MonomialMatrix& matrx) const; // Tensor product
+
+    void identity(ll r); // Set the matrix to be an identity matrix
+
+    SparseMatrix<T> toSparse() const;
+    Matrix<T> toDense() const;
+};
@@ -0,0 +1,557 @@
+#include "tensornet.h"
+#include "parallel.h"
+
+#define TN_MAX_QUBITS 62
+#define TN_MAX_SLICED 40 // the max number of sliced edges
+#define TN_JOBS_PER_WORKER 64 // the slices are grouped into about this many jobs per worker
+
+// A tensor over edges of dimension 2, edges[k] is bit k of the offset into data
+struct Tensor {
+    vector<int> edges;
+    vector<DTYPE> data;
+};
+
+// The tensor network of a circuit
+struct Network {
+    vector<Tensor> leaves; // the input vectors, the gates and the output vectors
+    vector<int> outputs; // qubit -> the leaf id of its output vector <x_q|
+    int numEdges;
+};
+
+// A contraction order with sliced edges
+struct Plan {
+    vector<vector<int>> nodeEdges; // the edges of the leaves, then of the result of each step
+    vector<pair<int, int>> steps; // step k contracts two nodes into node #leaves + k
+    vector<int> sliced; // the sliced edges
+};
+
+// A planned network, sliced for the memory cap of each of its workers
+struct TNPlan {
+    int numQubits;
+    int workers;
+    bool fits; // whether the plan fits in the memory cap
+    Network net;
+    Plan plan;
+};
+
+/**
+ * @brief Turn a quantum circuit into a tensor network
+ *
+ * @param qc the quantum circuit
+ * @return Network the network, with the output vectors set to <0|
+ */
+static Network buildNetwork(QCircuit& qc) {
+    Network net;
+    net.numEdges = 0;
+    vector<int> open(qc.numQubits); // qubit -> the edge at the current end of its wire
+    for (int q = 0; q < qc.numQubits; ++ q) {
+        open[q] = net.numEdges ++;
+        net.leaves.push_back({{open[q]}, {1, 0}});
+    }
+    for (auto& gate : qc.flatGates()) {
+        if (gate.gname == "SWAP") {
+            std::swap(open[gate.targetQubits[0]], open[gate.targetQubits[1]]);
+            continue;
+        }
+        Matrix<DTYPE>& u = *gate.gmat;
+        int t = gate.targetQubits[0];
+        if (gate.isSingle()) {
+            // edges (out, in), T[out, in] = u[out][in]
+            Tensor tensor;
+            tensor.edges = {net.numEdges, open[t]};
+            tensor.data.assign(4, DTYPE(0));
+            for (int o = 0; o < 2; ++ o) {
+                for (int i = 0; i < 2; ++ i) {
+                    tensor.data[o | i << 1] = u.data[o][i];
+                }
+            }
+            open[t] = net.numEdges ++;
+            net.leaves.push_back(tensor);
+        } else if (gate.is2QubitControlled()) {
+            // edges (c_out, t_out, c_in, t_in), the control passes through and selects I or u
+            int c = gate.controlQubits[0];
+            Tensor tensor;
+            tensor.edges = {net.numEdges, net.numEdges + 1, open[c], open[t]};
+            tensor.data.assign(16, DTYPE(0));
+            for (int cv = 0; cv < 2; ++ cv) {
+                for (int o = 0; o < 2; ++ o) {
+                    for (int i = 0; i < 2; ++ i) {
+                        tensor.data[cv | o << 1 | cv << 2 | i << 3] = cv ? u.data[o][i] : DTYPE(o == i);
+                    }
+                }
+            }
+            open[c] = net.numEdges ++;
+            open[t] = net.numEdges ++;
+            net.leaves.push_back(tensor);
+        } else {
+            cout << "[ERROR] buildNetwork: " << gate.gname << " not implemented" << endl;
+            exit(1);
+        }
+    }
+    for (int q = 0; q < qc.numQubits; ++ q) {
+        net.outputs.push_back(net.leaves.size());
+        net.leaves.push_back({{open[q]}, {1, 0}});
+    }
+    return net;
+}
+
+// Return the edges of the contraction of a and b: the edges of a only, then the edges of b only
+static vector<int> mergedEdges(const vector<int>& a, const vector<int>& b) {
+    vector<int> merged;
+    for (int e : a) {
+        if (find(b.begin(), b.end(), e) == b.end()) {
+            merged.push_back(e);
+        }
+    }
+    for (int e : b) {
+        if (find(a.begin(), a.end(), e) == a.end()) {
+            merged.push_back(e);
+        }
+    }
+    return merged;
+}
+
+/**
+ * @brief Find a contraction order greedily
+ *
+ * Among the pairs of tensors that share an edge, the pair with the least
+ * size(result) - size(a) - size(b) is contracted first. Tensors of disconnected
+ * components end up as scalars and are multiplied at the end.
+ *
+ * @param plan the plan, with the edges of the leaves set
+ * @param numEdges the number of edges
+ */
+static void greedyOrder(Plan& plan, int numEdges) {
+    typedef tuple<double, int, int> Candidate; // (score, a, b)
+    priority_queue<Candidate, vector<Candidate>, greater<Candidate>> queue;
+    vector<array<int, 2>> owners(numEdges, array<int, 2>{{-1, -1}});
+    vector<bool> alive(plan.nodeEdges.size(), true);
+
+    auto push = [&](int a, int b) {
+        vector<int> merged = mergedEdges(plan.nodeEdges[a], plan.nodeEdges[b]);
+        double score = ldexp(1.0, merged.size()) - ldexp(1.0, plan.nodeEdges[a].size()) - ldexp(1.0, plan.nodeEdges[b].size());
+        queue.push(make_tuple(score, min(a, b), max(a, b)));
+    };
+    for (size_t i = 0; i < plan.nodeEdges.size(); ++ i) {
+        for (int e : plan.nodeEdges[i]) {
+            owners[e][owners[e][0] < 0 ? 0 : 1] = i;
+        }
+    }
+    for (int e = 0; e < numEdges; ++ e) {
+        push(owners[e][0], owners[e][1]);
+    }
+
+    while (! queue.empty()) {
+        int a = get<1>(queue.top());
+        int b = get<2>(queue.top());
+        queue.pop();
+        if (! alive[a] || ! alive[b]) {
+            continue;
+        }
+        int id = plan.nodeEdges.size();
+        plan.nodeEdges.push_back(mergedEdges(plan.nodeEdges[a], plan.nodeEdges[b]));
+        plan.steps.push_back(make_pair(a, b));
+        alive[a] = false;
+        alive[b] = false;
+        alive.push_back(true);
+        for (int e : plan.nodeEdges[id]) {
+            int k = (owners[e][0] == a || owners[e][0] == b) ? 0 : 1;
+            owners[e][k] = id;
+            push(id, owners[e][1 - k]);
+        }
+    }
+
+    // multiply the scalars of the disconnected components
+    vector<int> scalars;
+    for (size_t i = 0; i < alive.size(); ++ i) {
+        if (alive[i]) {
+            scalars.push_back(i);
+        }
+    }
+    for (size_t k = 1; k < scalars.size(); ++ k) {
+        int acc = k == 1 ? scalars[0] : (int)plan.nodeEdges.size() - 1;
+        plan.nodeEdges.push_back({});
+        plan.steps.push_back(make_pair(acc, scalars[k]));
+    }
+}
+
+// The cost of a plan with some sliced edges, in tensor entries
+struct PlanCost {
+    double peakLive; // the max entries alive at once, including the permuted operands
+    double flops; // the multiply-adds of one slice
+    int maxRank;
+    int peakStep; // the step at which peakLive is reached
+};
+
+static PlanCost planCost(Plan& plan, const vector<bool>& isSliced) {
+    vector<int> rank(plan.nodeEdges.size());
+    for (size_t i = 0; i < plan.nodeEdges.size(); ++ i) {
+        rank[i] = 0;
+        for (int e : plan.nodeEdges[i]) {
+            rank[i] += ! isSliced[e];
+        }
+    }
+    int numLeaves = plan.nodeEdges.size() - plan.steps.size();
+    PlanCost cost = {0, 0, 0, 0};
+    double live = 0;
+    for (int i = 0; i < numLeaves; ++ i) {
+        live += ldexp(1.0, rank[i]);
+        cost.maxRank = max(cost.maxRank, rank[i]);
+    }
+    cost.peakLive = live;
+    for (size_t k = 0; k < plan.steps.size(); ++ k) {
+        int a = plan.steps[k].first;
+        int b = plan.steps[k].second;
+        int r = numLeaves + k;
+        double sizes = ldexp(1.0, rank[a]) + ldexp(1.0, rank[b]);
+        if (live + ldexp(1.0, rank[r]) + sizes > cost.peakLive) {
+            cost.peakLive = live + ldexp(1.0, rank[r]) + sizes;
+            cost.peakStep = k;
+        }
+        live += ldexp(1.0, rank[r]) - sizes;
+        cost.flops += ldexp(1.0, (rank[a] + rank[b] + rank[r]) / 2);
+        cost.maxRank = max(cost.maxRank, rank[r]);
+    }
+    return cost;
+}
+
+/**
+ * @brief Slice edges until the live tensors of a slice fit in capEntries
+ *
+ * Each round tries the edges of the tensors involved at the peak step and
+ * slices the one that lowers the peak the most, then the total flops.
+ *
+ * @param plan the plan
+ * @param numEdges the number of edges
+ * @param capEntries the max tensor entries alive at once in a slice
+ * @return true if the plan fits, false if no slicing makes it fit
+ */
+static bool sliceEdges(Plan& plan, int numEdges, double capEntries) {
+    vector<bool> isSliced(numEdges, false);
+    PlanCost cost = planCost(plan, isSliced);
+    int numLeaves = plan.nodeEdges.size() - plan.steps.size();
+    while (cost.peakLive > capEntries) {
+        set<int> candidates;
+        if (! plan.steps.empty()) {
+            pair<int, int> step = plan.steps[cost.peakStep];
+            for (int node : {step.first, step.second, numLeaves + cost.peakStep}) {
+                for (int e : plan.nodeEdges[node]) {
+                    if (! isSliced[e]) {
+                        candidates.insert(e);
+                    }
+                }
+            }
+        }
+        int best = -1;
+        PlanCost bestCost = cost;
+        for (int e : candidates) {
+            isSliced[e] = true;
+            PlanCost c = planCost(plan, isSliced);
+            isSliced[e] = false;
+            double flops = c.flops * 2; // slicing doubles the number of slices
+            if (best < 0 || c.peakLive < bestCost.peakLive || (c.peakLive == bestCost.peakLive && flops < bestCost.flops * 2)) {
+                best = e;
+                bestCost = c;
+            }
+        }
+        if (best < 0 || bestCost.peakLive >= cost.peakLive || plan.sliced.size() >= TN_MAX_SLICED) {
+            return false;
+        }
+        isSliced[best] = true;
+        plan.sliced.push_back(best);
+        cost = bestCost;
+    }
+    return true;
+}
+
+/**
+ * @brief Reorder the edges of a tensor, fixing the edges with value[e] >= 0
+ *
+ * @param t the tensor
+ * @param order the remaining edges in their new order
+ * @param value the fixed value of each edge, -1 if not fixed
+ * @return vector<DTYPE> the entries in the new order
+ */
+static vector<DTYPE> permute(const Tensor& t, const vector<int>& order, const vector<int>& value) {
+    if (order == t.edges) {
+        return t.data;
+    }
+    ll fixed = 0;
+    vector<int> pos(order.size());
+    for (size_t k = 0; k < t.edges.size(); ++ k) {
+        int e = t.edges[k];
+        auto it = find(order.begin(), order.end(), e);
+        if (it != order.end()) {
+            pos[it - order.begin()] = k;
+        } else if (value[e] > 0) {
+            fixed |= 1LL << k;
+        }
+    }
+    vector<DTYPE> data(1LL << order.size());
+    for (ll n = 0; n < (ll)data.size(); ++ n) {
+        ll old = fixed;
+        for (size_t p = 0; p < order.size(); ++ p) {
+            old |= ((n >> p) & 1) << pos[p];
+        }
+        data[n] = t.data[old];
+    }
+    return data;
+}
+
+/**
+ * @brief Contract two tensors over their shared edges
+ *
+ * Both are permuted to matrices, a as (edges of a only) x (shared edges) and b
+ * as (shared edges) x (edges of b only), and multiplied.
+ *
+ * @param a the first tensor
+ * @param b the second tensor
+ * @return Tensor the result, with the edges of a only, then the edges of b only
+ */
+static Tensor contract(const Tensor& a, const Tensor& b) {
+    vector<int> onlyA, onlyB, shared;
+    for (int e : a.edges) {
+        (find(b.edges.begin(), b.edges.end(), e) == b.edges.end() ? onlyA : shared).push_back(e);
+    }
+    for (int e : b.edges) {
+        if (find(a.edges.begin(), a.edges.end(), e) == a.edges.end()) {
+            onlyB.push_back(e);
+        }
+    }
+    vector<int> orderA = onlyA, orderB = shared;
+    orderA.insert(orderA.end(), shared.begin(), shared.end());
+    orderB.insert(orderB.end(), onlyB.begin(), onlyB.end());
+    vector<int> none;
+    vector<DTYPE> ma = permute(a, orderA, none);
+    vector<DTYPE> mb = permute(b, orderB, none);
+
+    ll na = 1LL << onlyA.size();
+    ll ns = 1LL << shared.size();
+    ll nb = 1LL << onlyB.size();
+    Tensor c;
+    c.edges = onlyA;
+    c.edges.insert(c.edges.end(), onlyB.begin(), onlyB.end());
+    c.data.assign(na * nb, DTYPE(0));
+    // real arithmetic on the interleaved parts avoids the NaN checks of complex multiplication
+    double* cp = reinterpret_cast<double*>(c.data.data());
+    const double* ap = reinterpret_cast<const double*>(ma.data());
+    for (ll j = 0; j < nb; ++ j) {
+        double* cj = cp + 2 * j * na;
+        for (ll s = 0; s < ns; ++ s) {
+            DTYPE v = mb[s + j * ns];
+            if (v == DTYPE(0)) {
+                continue;
+            }
+            double vr = v.real(), vi = v.imag();
+            const double* as = ap + 2 * s * na;
+            for (ll i = 0; i < na; ++ i) {
+                cj[2 * i] += vr * as[2 * i] - vi * as[2 * i + 1];
+                cj[2 * i + 1] += vr * as[2 * i + 1] + vi * as[2 * i];
+            }
+        }
+    }
+    return c;
+}
+
+/**
+ * @brief Contract one slice of the network for one bitstring
+ *
+ * @param net the network
+ * @param plan the plan
+ * @param bitstring the output bitstring
+ * @param slice the values of the sliced edges, bit k for plan.sliced[k]
+ * @param value the scratch edge values, all -1
+ * @return DTYPE the partial amplitude
+ */
+static DTYPE contractSlice(Network& net, Plan& plan, ll bitstring, ll slice, vector<int>& value) {
+    for (size_t k = 0; k < plan.sliced.size(); ++ k) {
+        value[plan.sliced[k]] = (slice >> k) & 1;
+    }
+    int numLeaves = net.leaves.size();
+    vector<Tensor> nodes(plan.nodeEdges.size());
+    for (int i = 0; i < numLeaves; ++ i) {
+        nodes[i].edges.clear();
+        for (int e : net.leaves[i].edges) {
+            if (value[e] < 0) {
+                nodes[i].edges.push_back(e);
+            }
+        }
+        nodes[i].data = permute(net.leaves[i], nodes[i].edges, value);
+    }
+    for (size_t q = 0; q < net.outputs.size(); ++ q) {
+        Tensor& out = nodes[net.outputs[q]];
+        int bit = (bitstring >> q) & 1;
+        if (out.edges.empty()) { // the output edge is sliced
+            out.data[0] = DTYPE(value[net.leaves[net.outputs[q]].edges[0]] == bit);
+        } else {
+            out.data[0] = DTYPE(bit == 0);
+            out.data[1] = DTYPE(bit == 1);
+        }
+    }
+    for (size_t k = 0; k < plan.steps.size(); ++ k) {
+        Tensor& a = nodes[plan.steps[k].first];
+        Tensor& b = nodes[plan.steps[k].second];
+        nodes[numLeaves + k] = contract(a, b);
+        vector<DTYPE>().swap(a.data);
+        vector<DTYPE>().swap(b.data);
+    }
+    for (int e : plan.sliced) {
+        value[e] = -1;
+    }
+    return nodes.back().data[0];
+}
+
+/**
+ * @brief Build the network of a circuit and plan its contraction
+ *
+ * @param qc the quantum circuit
+ * @param memoryCap the max bytes of all live tensors, split evenly across the workers
+ * @param workers the number of workers
+ * @param net the network
+ * @param plan the plan
+ * @return true if the plan fits in the memory cap
+ */
+static bool planNetwork(QCircuit& qc, ll memoryCap, int workers, Network& net, Plan& plan) {
+    if (qc.numQubits > TN_MAX_QUBITS) {
+        cout << "[ERROR] planNetwork: numQubits > " << TN_MAX_QUBITS << ". " << endl;
+        exit(1);
+    }
+    net = buildNetwork(qc);
+    for (auto& leaf : net.leaves) {
+        plan.nodeEdges.push_back(leaf.edges);
+    }
+    greedyOrder(plan, net.numEdges);
+    return sliceEdges(plan, net.numEdges, (double)memoryCap / workers / sizeof(DTYPE));
+}
+
+// Fill the plan statistics
+static void planStats(Network& net, Plan& plan, int workers, TNStats& stats) {
+    vector<bool> isSliced(net.numEdges, false);
+    for (int e : plan.sliced) {
+        isSliced[e] = true;
+    }
+    PlanCost cost = planCost(plan, isSliced);
+    stats.numTensors = net.leaves.size();
+    stats.numSlicedEdges = plan.sliced.size();
+    stats.numSlices = 1LL << plan.sliced.size();
+    stats.maxRank = cost.maxRank;
+    stats.flops = cost.flops * stats.numSlices;
+    stats.peakBytes = cost.peakLive * sizeof(DTYPE) * workers;
+    stats.seconds = 0;
+}
+
+/**
+ * @brief Compute the amplitudes <x|U|0...0> of a planned circuit for a few bitstrings
+ *
+ * @param tp the plan from tnEstimate, which must fit in its memory cap
+ * @param bitstrings the bitstrings x, bit q of x is the value of qubit q
+ * @param stats optional plan and timing statistics
+ * @return vector<DTYPE> the amplitudes, in the order of bitstrings
+ */
+vector<DTYPE> tnAmplitudes(TNPlan& tp, const vector<ll>& bitstrings, TNStats* stats) {
+    for (ll x : bitstrings) {
+        if (x < 0 || (x >> tp.numQubits) != 0) {
+            cout << "[ERROR] tnAmplitudes: bitstring " << x << " out of range. " << endl;
+            exit(1);
+        }
+    }
+    if (! tp.fits) {
+        cout << "[ERROR] tnAmplitudes: the memory cap is too small for this network. " << endl;
+        exit(1);
+    }
+    auto start = chrono::steady_clock::now();
+    int workers = tp.workers;
+    Network& net = tp.net;
+    Plan& plan = tp.plan;
+    ll numSlices = 1LL << plan.sliced.size();
+
+    // job j contracts the slices [j * numSlices / chunks, (j + 1) * numSlices / chunks) of one bitstring
+    ll chunks = min(numSlices, (ll)workers * TN_JOBS_PER_WORKER);
+    vector<ll> jobs;
+    for (ll j = 0; j < (ll)bitstrings.size() * chunks; ++ j) {
+        jobs.push_back(j);
+    }
+    vector<vector<DTYPE>> partial(workers, vector<DTYPE>(bitstrings.size(), DTYPE(0)));
+    vector<vector<int>> values(workers, vector<int>(net.numEdges, -1));
+    parallelForStealing(jobs, workers, [&](int w, ll j) {
+        ll b = j / chunks;
+        ll c = j % chunks;
+        for (ll s = c * numSlices / chunks; s < (c + 1) * numSlices / chunks; ++ s) {
+            partial[w][b] += contractSlice(net, plan, bitstrings[b], s, values[w]);
+        }
+    });
+
+    vector<DTYPE> amps(bitstrings.size(), DTYPE(0));
+    for (int w = 0; w < workers; ++ w) {
+        for (size_t b = 0; b < amps.size(); ++ b) {
+            amps[b] += partial[w][b];
+        }
+    }
+    if (stats != nullptr) {
+        planStats(net, plan, workers, *stats);
+        stats->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    return amps;
+}
+
+/**
+ * @brief Compute the amplitudes <x|U|0...0> of a quantum circuit for a few bitstrings
+ *
+ * @param qc the quantum circuit, at most 62 qubits
+ * @param bitstrings the bitstrings x, bit q of x is the value of qubit q
+ * @param memoryCap the max bytes of all intermediate tensors, split evenly across the threads
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param stats optional plan and timing statistics
+ * @return vector<DTYPE> the amplitudes, in the order of bitstrings
+ */
+vector<DTYPE> tnAmplitudes(QCircuit& qc, const vector<ll>& bitstrings, ll memoryCap, int numThreads, TNStats* stats) {
+    auto start = chrono::steady_clock::now();
+    TNStats planned;
+    shared_ptr<TNPlan> tp;
+    tnEstimate(qc, memoryCap, numThreads, planned, &tp);
+    vector<DTYPE> amps = tnAmplitudes(*tp, bitstrings, stats);
+    if (stats != nullptr) {
+        stats->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    return amps;
+}
+
+/**
+ * @brief Compute the amplitude <x|U|0...0> of a quantum circuit
+ *
+ * @param qc the quantum circuit, at most 62 qubits
+ * @param bitstring the bitstring x, bit q of x is the value of qubit q
+ * @param memoryCap the max bytes of all intermediate tensors, split evenly across the threads
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return DTYPE the amplitude
+ */
+DTYPE tnAmplitude(QCircuit& qc, ll bitstring, ll memoryCap, int numThreads) {
+    return tnAmplitudes(qc, {bitstring}, memoryCap, numThreads)[0];
+}
+
+/**
+ * @brief Plan the contraction of a circuit without contracting it
+ *
+ * @param qc the quantum circuit, at most 62 qubits
+ * @param memoryCap the max bytes of all intermediate tensors, split evenly across the threads
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param stats the plan statistics for one amplitude
+ * @param plan optional, receives the plan for tnAmplitudes, so the circuit is not planned twice
+ * @return true if the plan fits in the memory cap
+ */
+bool tnEstimate(QCircuit& qc, ll memoryCap, int numThreads, TNStats& stats, shared_ptr<TNPlan>* plan) {
+    shared_ptr<TNPlan> tp = make_shared<TNPlan>();
+    tp->numQubits = qc.numQubits;
+    tp->workers = numWorkers(numThreads);
+    tp->fits = planNetwork(qc, memoryCap, tp->workers, tp->net, tp->plan);
+    planStats(tp->net, tp->plan, tp->workers, stats);
+    if (plan != nullptr) {
+        *plan = tp;
+    }
+    return tp->fits;
+}
+
+void TNStats::print() {
+    cout << "[INFO] [TensorNetwork] tensors: [" << numTensors << "] slicedEdges: [" << numSlicedEdges << "] slices: ["
+         << numSlices << "] maxRank: [" << maxRank << "] peakBytes: [" << peakBytes << "] flops: [" << flops << "] time: [" << seconds << "s]" << endl;
+}
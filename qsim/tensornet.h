@@ -0,0 +1,81 @@
+#pragma once
+
+#include "qcircuit.h"
+
+//
+// Tensor-network backend
+//
+// An amplitude <x|U|0...0> is the contraction of a network with one tensor per
+// gate, the input vectors |0> and the output vectors <x_q|. Each qubit wire
+// segment between two tensors is an edge of dimension 2. Single-qubit gates are
+// rank-2 tensors, 2-qubit controlled gates are rank-4 tensors built from gmat,
+// and SWAP gates only exchange the open edges of their qubits. Repeated blocks
+// are expanded.
+//
+// The contraction order is found greedily: the pair of tensors sharing an edge
+// whose contraction shrinks the network the most is contracted first. If the
+// largest intermediate tensor exceeds the memory cap, edges are sliced, i.e.,
+// fixed to 0 and 1 in turn and the partial amplitudes summed. Slices and
+// bitstrings run in parallel. The cost depends on the circuit's treewidth,
+// not on the number of qubits, so shallow circuits on 50+ qubits are feasible.
+//
+
+struct TNStats {
+    int numTensors; // the number of tensors in the network
+    int numSlicedEdges;
+    ll numSlices; // 2^numSlicedEdges
+    int maxRank; // the rank of the largest intermediate tensor in a slice
+    double flops; // the multiply-adds per amplitude, all slices included
+    double peakBytes; // the max bytes of live tensors, all threads included
+    double seconds;
+
+    void print();
+};
+
+// A planned contraction of a circuit, from tnEstimate, reusable for any bitstrings
+struct TNPlan;
+
+/**
+ * @brief Compute the amplitudes <x|U|0...0> of a quantum circuit for a few bitstrings
+ *
+ * @param qc the quantum circuit, at most 62 qubits
+ * @param bitstrings the bitstrings x, bit q of x is the value of qubit q
+ * @param memoryCap the max bytes of all intermediate tensors, split evenly across the threads
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param stats optional plan and timing statistics
+ * @return vector<DTYPE> the amplitudes, in the order of bitstrings
+ */
+vector<DTYPE> tnAmplitudes(QCircuit& qc, const vector<ll>& bitstrings, ll memoryCap = 1LL << 30, int numThreads = 0, TNStats* stats = nullptr);
+
+/**
+ * @brief Compute the amplitudes <x|U|0...0> of a planned circuit for a few bitstrings
+ *
+ * @param tp the plan from tnEstimate, which must fit in its memory cap
+ * @param bitstrings the bitstrings x, bit q of x is the value of qubit q
+ * @param stats optional plan and timing statistics
+ * @return vector<DTYPE> the amplitudes, in the order of bitstrings
+ */
+vector<DTYPE> tnAmplitudes(TNPlan& tp, const vector<ll>& bitstrings, TNStats* stats = nullptr);
+
+/**
+ * @brief Compute the amplitude <x|U|0...0> of a quantum circuit
+ *
+ * @param qc the quantum circuit, at most 62 qubits
+ * @param bitstring the bitstring x, bit q of x is the value of qubit q
+ * @param memoryCap the max bytes of all intermediate tensors, split evenly across the threads
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @return DTYPE the amplitude
+ */
+DTYPE tnAmplitude(QCircuit& qc, ll bitstring, ll memoryCap = 1LL << 30, int numThreads = 0);
+
+/**
+ * @brief Plan the contraction of a circuit without contracting it
+ *
+ * @param qc the quantum circuit, at most 62 qubits
+ * @param memoryCap the max bytes of all intermediate tensors, split evenly across the threads
+ * @param numThreads the number of threads, 0 means all hardware threads
+ * @param stats the plan statistics for one amplitude
+ * @param plan optional, receives the plan for tnAmplitudes, so the circuit is not planned twice
+ * @return true if the plan fits in the memory cap
+ */
+bool tnEstimate(QCircuit& qc, ll memoryCap, int numThreads, TNStats& stats, shared_ptr<TNPlan>* plan = nullptr);